@@ -2,10 +2,16 @@
  * Some timing tests for libdict
  * Copyright (C) 2001-2011 Farooq Mela */
 
+#ifdef __linux__
+/* For syscall() under -std=c11. */
+# define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
@@ -15,6 +21,13 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 
+#ifdef __linux__
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
 #include "dict.h"
 #include "dict_private.h"
 #include "tree_common.h"
@@ -33,9 +46,9 @@ void warn(const char *fmt, ...);
 void *xmalloc(size_t size);
 
 static size_t hash_count = 0, comp_count = 0;
-unsigned str_hash(const void *p);
+uint64_t str_hash(const void *p);
 int my_strcmp(const void *k1, const void *k2);
-unsigned ptr_hash(const void *p);
+uint64_t ptr_hash(const void *p);
 int my_ptrcmp(const void *k1, const void *k2);
 void shuffle(char **p, unsigned size);
 void key_str_free(void *key, void *datum);
@@ -51,30 +64,137 @@ dict *create_dictionary(char type, const char **container_name);
 
 static size_t malloced = 0;
 
-int
-main(int argc, char **argv)
+/* Hardware counters, read around each phase with perf_event_open where the
+ * kernel allows it. The callback counters above say how much work a
+ * structure does; these say how the machine copes with its memory layout,
+ * which is what actually decides hashtable-versus-tree on a given host. On
+ * other systems, or when access is denied, the counters just report as
+ * unavailable and only the rusage numbers are printed. */
+typedef struct {
+    uint64_t	cache_misses;
+    uint64_t	branch_misses;
+    uint64_t	dtlb_misses;
+} perf_sample;
+
+#define NUM_PERF_EVENTS 3
+
+#ifdef __linux__
+
+static int perf_fds[NUM_PERF_EVENTS] = { -1, -1, -1 };
+
+static int
+perf_open_event(uint32_t type, uint64_t config)
 {
-    if (argc != 3) {
-	fprintf(stderr, "usage: %s [type] [input]\n", appname);
-	fprintf(stderr, "type: specifies the dictionary type:\n");
-	fprintf(stderr, "   h: height-balanced tree\n");
-	fprintf(stderr, "   p: path-reduction tree\n");
-	fprintf(stderr, "   r: red-black tree\n");
-	fprintf(stderr, "   t: treap\n");
-	fprintf(stderr, "   s: splay tree\n");
-	fprintf(stderr, "   w: weight-balanced tree\n");
-	fprintf(stderr, "   S: skiplist\n");
-	fprintf(stderr, "   H: hashtable\n");
-	fprintf(stderr, "   2: hashtable 2\n");
-	fprintf(stderr, "input: text file consisting of newline-separated keys\n");
-	exit(EXIT_FAILURE);
-    }
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = type;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
 
-    srand(0xdeadbeef);
+static void
+perf_init(void)
+{
+    perf_fds[0] = perf_open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    perf_fds[1] = perf_open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    perf_fds[2] = perf_open_event(PERF_TYPE_HW_CACHE,
+				  PERF_COUNT_HW_CACHE_DTLB |
+				  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    if (perf_fds[0] < 0 && perf_fds[1] < 0 && perf_fds[2] < 0)
+	warn("hardware counters unavailable (perf_event_open: %s)",
+	     strerror(errno));
+}
 
-    dict_malloc_func = xmalloc;
+static void
+perf_phase_start(void)
+{
+    for (int i = 0; i < NUM_PERF_EVENTS; i++)
+	if (perf_fds[i] >= 0) {
+	    ioctl(perf_fds[i], PERF_EVENT_IOC_RESET, 0);
+	    ioctl(perf_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
 
-    const char type = argv[1][0];
+static void
+perf_phase_end(perf_sample *sample)
+{
+    uint64_t counts[NUM_PERF_EVENTS] = { 0, 0, 0 };
+    for (int i = 0; i < NUM_PERF_EVENTS; i++)
+	if (perf_fds[i] >= 0) {
+	    ioctl(perf_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	    if (read(perf_fds[i], &counts[i], sizeof(counts[i])) !=
+		sizeof(counts[i]))
+		counts[i] = 0;
+	}
+    sample->cache_misses = counts[0];
+    sample->branch_misses = counts[1];
+    sample->dtlb_misses = counts[2];
+}
+
+static bool
+perf_usable(void)
+{
+    for (int i = 0; i < NUM_PERF_EVENTS; i++)
+	if (perf_fds[i] >= 0)
+	    return true;
+    return false;
+}
+
+#else /* !__linux__ */
+
+static void perf_init(void) {}
+static void perf_phase_start(void) {}
+static void perf_phase_end(perf_sample *sample) { memset(sample, 0, sizeof(*sample)); }
+static bool perf_usable(void) { return false; }
+
+#endif /* !__linux__ */
+
+static void
+perf_accumulate(perf_sample *total, const perf_sample *sample)
+{
+    total->cache_misses += sample->cache_misses;
+    total->branch_misses += sample->branch_misses;
+    total->dtlb_misses += sample->dtlb_misses;
+}
+
+static void
+perf_print(const perf_sample *sample)
+{
+    if (perf_usable())
+	printf("%18s %10" PRIu64 " cachemiss %9" PRIu64 " branchmiss %9" PRIu64 " dtlbmiss\n",
+	       "", sample->cache_misses, sample->branch_misses,
+	       sample->dtlb_misses);
+}
+
+static long
+peak_rss_kb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/* Everything the comparison table needs from one container's run. */
+typedef struct {
+    const char*	name;
+    double	total_s;
+    size_t	comp;
+    size_t	hash;
+    size_t	rotations;
+    size_t	memory_bytes;
+    perf_sample	hw;
+    long	maxrss_kb;	/* Process peak; only grows across runs. */
+} bench_result;
+
+static void
+benchmark_dictionary(char type, char **words, size_t nwords,
+		     bench_result *result)
+{
     const char *container_name = NULL;
     dict *dct = create_dictionary(type, &container_name);
     if (!dct)
@@ -83,38 +203,14 @@ main(int argc, char **argv)
     ASSERT(dict_verify(dct));
 
     const size_t malloced_save = malloced;
-
-    FILE *fp = fopen(argv[2], "r");
-    if (fp == NULL)
-	quit("cant open file '%s': %s", argv[2], strerror(errno));
-
-    size_t nwords = 0;
-    char buf[512];
-    while (fgets(buf, sizeof(buf), fp))
-	++nwords;
-
-    if (!nwords)
-	quit("nothing read from file");
-
-    char **words = xmalloc(sizeof(*words) * nwords);
-    rewind(fp);
-    size_t words_read = 0;
-    while (words_read < nwords && fgets(buf, sizeof(buf), fp)) {
-	strtok(buf, "\n");
-	words[words_read++] = xstrdup(buf);
-    }
-    fclose(fp);
-    if (words_read < nwords)
-	quit("Only read %zu/%zu words!", words_read, nwords);
-    printf("Loaded %zu keys from %s.\n", nwords, argv[2]);
-
-    malloced = malloced_save;
     size_t total_comp = 0, total_hash = 0, total_rotations = 0;
+    perf_sample hw_total = { 0, 0, 0 }, hw;
 
     struct rusage start, end;
     struct timeval total = { 0, 0 };
 
     timer_start(&start);
+    perf_phase_start();
     for (unsigned i = 0; i < nwords; i++) {
 	dict_insert_result result = dict_insert(dct, words[i]);
 	if (!result.inserted)
@@ -123,9 +219,12 @@ main(int argc, char **argv)
 	ASSERT(*result.datum_ptr == NULL);
 	*result.datum_ptr = words[i];
     }
+    perf_phase_end(&hw);
     timer_end(&start, &end, &total);
+    perf_accumulate(&hw_total, &hw);
     printf("    %s container: %.02fkB\n", container_name, malloced_save * 1e-3);
-    printf("       %s memory: %.02fkB\n", container_name, malloced * 1e-3);
+    printf("       %s memory: %.02fkB (%.01fB/key)\n", container_name,
+	   malloced * 1e-3, malloced / (double) nwords);
     printf("       %s insert: %6.03fs %9zu cmp (%.02f/insert)",
 	   container_name,
 	   (end.ru_utime.tv_sec * 1000000 + end.ru_utime.tv_usec) * 1e-6,
@@ -133,9 +232,11 @@ main(int argc, char **argv)
     if (hash_count)
 	printf(" %9zu hash", hash_count);
     printf("\n");
+    perf_print(&hw);
     total_comp += comp_count; comp_count = 0;
     total_hash += hash_count; hash_count = 0;
-    if (type != 'H' && type != '2' && type != 'S') {
+    const size_t memory_bytes = malloced;
+    if (type != 'H' && type != '2' && type != '3' && type != 'S' && type != 'b') {
 	tree_base *tree = dict_private(dct);
 	printf("insert rotations: %zu\n", tree->rotation_count);
 	total_rotations += tree->rotation_count;
@@ -160,6 +261,7 @@ main(int argc, char **argv)
     dict_itor *itor = dict_itor_new(dct);
 
     timer_start(&start);
+    perf_phase_start();
     n = 0;
     ASSERT(dict_itor_first(itor));
     do {
@@ -167,14 +269,18 @@ main(int argc, char **argv)
 	ASSERT(dict_itor_key(itor) == *dict_itor_datum(itor));
 	++n;
     } while (dict_itor_next(itor));
+    perf_phase_end(&hw);
     timer_end(&start, &end, &total);
+    perf_accumulate(&hw_total, &hw);
     printf("  %s fwd iterate: %6.03fs\n",
 	   container_name,
 	   (end.ru_utime.tv_sec * 1000000 + end.ru_utime.tv_usec) * 1e-6);
+    perf_print(&hw);
     if (n != nwords)
 	warn("Fwd iteration returned %u items - should be %u", n, nwords);
 
     timer_start(&start);
+    perf_phase_start();
     n = 0;
     ASSERT(dict_itor_last(itor));
     do {
@@ -182,10 +288,13 @@ main(int argc, char **argv)
 	ASSERT(dict_itor_key(itor) == *dict_itor_datum(itor));
 	++n;
     } while (dict_itor_prev(itor));
+    perf_phase_end(&hw);
     timer_end(&start, &end, &total);
+    perf_accumulate(&hw_total, &hw);
     printf("  %s rev iterate: %6.03fs\n",
 	   container_name,
 	   (end.ru_utime.tv_sec * 1000000 + end.ru_utime.tv_usec) * 1e-6);
+    perf_print(&hw);
     if (n != nwords)
 	warn("Rev iteration returned %u items - should be %u", n, nwords);
 
@@ -194,14 +303,17 @@ main(int argc, char **argv)
     /* shuffle(words, nwords); */
 
     timer_start(&start);
+    perf_phase_start();
     for (unsigned i = 0; i < nwords; i++) {
 	void **p = dict_search(dct, words[i]);
 	if (!p)
-	    quit("lookup failed for '%s'", buf);
+	    quit("lookup failed for '%s'", words[i]);
 	if (*p != words[i])
 	    quit("bad data for '%s', got '%s' instead", words[i], *(char **)p);
     }
+    perf_phase_end(&hw);
     timer_end(&start, &end, &total);
+    perf_accumulate(&hw_total, &hw);
     printf("  %s good search: %6.03fs %9zu cmp (%.02f/search)",
 	   container_name,
 	   (end.ru_utime.tv_sec * 1000000 + end.ru_utime.tv_usec) * 1e-6,
@@ -209,9 +321,10 @@ main(int argc, char **argv)
     if (hash_count)
 	printf(" %9zu hash", hash_count);
     printf("\n");
+    perf_print(&hw);
     total_comp += comp_count; comp_count = 0;
     total_hash += hash_count; hash_count = 0;
-    if (type != 'H' && type != '2' && type != 'S') {
+    if (type != 'H' && type != '2' && type != '3' && type != 'S' && type != 'b') {
 	tree_base *tree = dict_private(dct);
 	printf("search rotations: %zu\n", tree->rotation_count);
 	total_rotations += tree->rotation_count;
@@ -219,13 +332,16 @@ main(int argc, char **argv)
     }
 
     timer_start(&start);
+    perf_phase_start();
     for (unsigned i = 0; i < nwords; i++) {
 	unsigned rv = dict_rand() % strlen(words[i]);
 	words[i][rv]++;
 	dict_search(dct, words[i]);
 	words[i][rv]--;
     }
+    perf_phase_end(&hw);
     timer_end(&start, &end, &total);
+    perf_accumulate(&hw_total, &hw);
     printf("   %s bad search: %6.03fs %9zu cmp (%.02f/search)",
 	   container_name,
 	   (end.ru_utime.tv_sec * 1000000 + end.ru_utime.tv_usec) * 1e-6,
@@ -233,12 +349,14 @@ main(int argc, char **argv)
     if (hash_count)
 	printf(" %9zu hash", hash_count);
     printf("\n");
+    perf_print(&hw);
     total_comp += comp_count; comp_count = 0;
     total_hash += hash_count; hash_count = 0;
 
     /* shuffle(words, nwords); */
 
     timer_start(&start);
+    perf_phase_start();
     for (unsigned i = 0; i < nwords; i++) {
 	dict_remove_result result = dict_remove(dct, words[i]);
 	if (!result.removed)
@@ -246,7 +364,9 @@ main(int argc, char **argv)
 	ASSERT(result.key == words[i]);
 	ASSERT(result.datum == words[i]);
     }
+    perf_phase_end(&hw);
     timer_end(&start, &end, &total);
+    perf_accumulate(&hw_total, &hw);
     printf("       %s remove: %6.03fs %9zu cmp (%.2f/remove)",
 	   container_name,
 	   (end.ru_utime.tv_sec * 1000000 + end.ru_utime.tv_usec) * 1e-6,
@@ -254,9 +374,10 @@ main(int argc, char **argv)
     if (hash_count)
 	printf(" %9zu hash", hash_count);
     printf("\n");
+    perf_print(&hw);
     total_comp += comp_count; comp_count = 0;
     total_hash += hash_count; hash_count = 0;
-    if (type != 'H' && type != '2' && type != 'S') {
+    if (type != 'H' && type != '2' && type != '3' && type != 'S' && type != 'b') {
 	tree_base *tree = dict_private(dct);
 	printf("remove rotations: %zu\n", tree->rotation_count);
 	total_rotations += tree->rotation_count;
@@ -277,11 +398,116 @@ main(int argc, char **argv)
     if (total_hash)
 	printf(" %9zu hash", total_hash);
     printf("\n");
+    perf_print(&hw_total);
 
-    if (type != 'H' && type != '2' && type != 'S') {
+    if (type != 'H' && type != '2' && type != '3' && type != 'S' && type != 'b') {
 	printf(" total rotations: %zu\n", total_rotations);
     }
+    printf("        peak RSS: %ldkB\n", peak_rss_kb());
+
+    result->name = container_name;
+    result->total_s = (total.tv_sec * 1000000 + total.tv_usec) * 1e-6;
+    result->comp = total_comp;
+    result->hash = total_hash;
+    result->rotations = total_rotations;
+    result->memory_bytes = memory_bytes;
+    result->hw = hw_total;
+    result->maxrss_kb = peak_rss_kb();
+}
 
+static void
+print_comparison_table(const bench_result *results, unsigned nresults,
+		       size_t nwords)
+{
+    printf("\n%4s %8s %11s %11s %8s", "", "total(s)", "cmp", "hash", "B/key");
+    if (perf_usable())
+	printf(" %11s %11s %11s", "cachemiss", "branchmiss", "dtlbmiss");
+    printf(" %9s\n", "maxrss kB");
+    for (unsigned i = 0; i < nresults; i++) {
+	const bench_result *r = &results[i];
+	printf("%4s %8.3f %11zu %11zu %8.1f",
+	       r->name, r->total_s, r->comp, r->hash,
+	       r->memory_bytes / (double) nwords);
+	if (perf_usable())
+	    printf(" %11" PRIu64 " %11" PRIu64 " %11" PRIu64,
+		   r->hw.cache_misses, r->hw.branch_misses,
+		   r->hw.dtlb_misses);
+	/* Process-wide high-water mark: meaningful per row only in single
+	 * container runs; in 'a' mode it just grows monotonically. */
+	printf(" %9ld\n", r->maxrss_kb);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc != 3) {
+	fprintf(stderr, "usage: %s [type] [input]\n", appname);
+	fprintf(stderr, "type: specifies the dictionary type:\n");
+	fprintf(stderr, "   b: B+ tree\n");
+	fprintf(stderr, "   h: height-balanced tree\n");
+	fprintf(stderr, "   p: path-reduction tree\n");
+	fprintf(stderr, "   r: red-black tree\n");
+	fprintf(stderr, "   t: treap\n");
+	fprintf(stderr, "   s: splay tree\n");
+	fprintf(stderr, "   w: weight-balanced tree\n");
+	fprintf(stderr, "   S: skiplist\n");
+	fprintf(stderr, "   H: hashtable\n");
+	fprintf(stderr, "   2: hashtable 2\n");
+	fprintf(stderr, "   a: benchmark every type and print a comparison table\n");
+	fprintf(stderr, "input: text file consisting of newline-separated keys\n");
+	exit(EXIT_FAILURE);
+    }
+
+    srand(0xdeadbeef);
+
+    dict_malloc_func = xmalloc;
+
+    perf_init();
+
+    const char type = argv[1][0];
+    static const char all_types[] = "bhprtswSH23";
+    const char *types = (type == 'a') ? all_types : argv[1];
+    const unsigned ntypes = (type == 'a') ? (unsigned)strlen(all_types) : 1;
+
+    FILE *fp = fopen(argv[2], "r");
+    if (fp == NULL)
+	quit("cant open file '%s': %s", argv[2], strerror(errno));
+
+    size_t nwords = 0;
+    char buf[512];
+    while (fgets(buf, sizeof(buf), fp))
+	++nwords;
+
+    if (!nwords)
+	quit("nothing read from file");
+
+    char **words = xmalloc(sizeof(*words) * nwords);
+    rewind(fp);
+    size_t words_read = 0;
+    while (words_read < nwords && fgets(buf, sizeof(buf), fp)) {
+	strtok(buf, "\n");
+	words[words_read++] = xstrdup(buf);
+    }
+    fclose(fp);
+    if (words_read < nwords)
+	quit("Only read %zu/%zu words!", words_read, nwords);
+    printf("Loaded %zu keys from %s.\n", nwords, argv[2]);
+
+    bench_result *results = xmalloc(sizeof(*results) * ntypes);
+    for (unsigned i = 0; i < ntypes; i++) {
+	if (ntypes > 1)
+	    printf("\n");
+	/* The remove phase leaves the container empty, so every type runs
+	 * against the same key set. */
+	malloced = 0;
+	benchmark_dictionary(types[i], words, nwords, &results[i]);
+    }
+    print_comparison_table(results, ntypes, nwords);
+
+    FREE(results);
+    for (unsigned i = 0; i < nwords; i++)
+	FREE(words[i]);
     FREE(words);
 
     exit(EXIT_SUCCESS);
@@ -330,8 +556,16 @@ create_dictionary(char type, const char **container_name)
 	    *container_name = "h2";
 	    return hashtable2_dict_new(cmp_func, hash_func, HASHTABLE_SIZE);
 
+	case '3':
+	    *container_name = "h3";
+	    return hashtable3_dict_new(cmp_func, hash_func, HASHTABLE_SIZE);
+
+	case 'b':
+	    *container_name = "bp";
+	    return bp_dict_new(cmp_func);
+
 	default:
-	    quit("type must be one of h, p, r, t, s, w or H");
+	    quit("type must be one of b, h, p, r, t, s, w, S, H, 2, 3 or a");
     }
 }
 
@@ -387,7 +621,7 @@ shuffle(char **p, unsigned size)
     }
 }
 
-unsigned
+uint64_t
 str_hash(const void *p)
 {
     ++hash_count;
@@ -401,11 +635,11 @@ my_strcmp(const void *k1, const void *k2)
     return strcmp(k1, k2);
 }
 
-unsigned
+uint64_t
 ptr_hash(const void *p)
 {
     ++hash_count;
-    return (unsigned) ((2166136261U ^ (uintptr_t)p) * 16777619U);
+    return (14695981039346656037ULL ^ (uintptr_t)p) * 1099511628211ULL;
 }
 
 int
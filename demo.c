@@ -77,8 +77,14 @@ main(int argc, char **argv)
 	case '2':
 	    dct = hashtable2_dict_new((dict_compare_func)strcmp, dict_str_hash, HSIZE);
 	    break;
+	case '3':
+	    dct = hashtable3_dict_new((dict_compare_func)strcmp, dict_str_hash, HSIZE);
+	    break;
+	case 'b':
+	    dct = bp_dict_new((dict_compare_func)strcmp);
+	    break;
 	default:
-	    quit("type must be one of h, p, r, t, s, w, S, H, or 2");
+	    quit("type must be one of b, h, p, r, t, s, w, S, H, 2, or 3");
     }
 
     if (!dct)
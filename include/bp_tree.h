@@ -0,0 +1,84 @@
+/*
+ * libdict -- B+-tree interface.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBDICT_BP_TREE_H__
+#define LIBDICT_BP_TREE_H__
+
+#include "dict.h"
+
+BEGIN_DECL
+
+typedef struct bp_tree bp_tree;
+
+bp_tree*	bp_tree_new(dict_compare_func cmp_func);
+dict*		bp_dict_new(dict_compare_func cmp_func);
+size_t		bp_tree_free(bp_tree* tree, dict_delete_func delete_func);
+
+dict_insert_result
+		bp_tree_insert(bp_tree* tree, void* key);
+void**		bp_tree_search(bp_tree* tree, const void* key);
+void**		bp_tree_search_le(bp_tree* tree, const void* key);
+void**		bp_tree_search_lt(bp_tree* tree, const void* key);
+void**		bp_tree_search_ge(bp_tree* tree, const void* key);
+void**		bp_tree_search_gt(bp_tree* tree, const void* key);
+dict_remove_result
+		bp_tree_remove(bp_tree* tree, const void* key);
+size_t		bp_tree_clear(bp_tree* tree, dict_delete_func delete_func);
+size_t		bp_tree_traverse(bp_tree* tree, dict_visit_func visit);
+size_t		bp_tree_traverse_range(bp_tree* tree, const void* lo, const void* hi, dict_visit_func visit);
+size_t		bp_tree_count(const bp_tree* tree);
+void		bp_tree_get_stats(bp_tree* tree, dict_stats* stats);
+const void*	bp_tree_min(const bp_tree* tree);
+const void*	bp_tree_max(const bp_tree* tree);
+bool		bp_tree_verify(const bp_tree* tree);
+
+typedef struct bp_itor bp_itor;
+
+bp_itor*	bp_itor_new(bp_tree* tree);
+dict_itor*	bp_dict_itor_new(bp_tree* tree);
+itor_vtable*	bp_itor_init(bp_tree* tree, bp_itor* itor);
+void		bp_itor_free(bp_itor* itor);
+
+bool		bp_itor_valid(const bp_itor* itor);
+void		bp_itor_invalidate(bp_itor* itor);
+bool		bp_itor_next(bp_itor* itor);
+bool		bp_itor_prev(bp_itor* itor);
+bool		bp_itor_nextn(bp_itor* itor, size_t count);
+bool		bp_itor_prevn(bp_itor* itor, size_t count);
+bool		bp_itor_first(bp_itor* itor);
+bool		bp_itor_last(bp_itor* itor);
+bool		bp_itor_search(bp_itor* itor, const void* key);
+bool		bp_itor_search_le(bp_itor* itor, const void* key);
+bool		bp_itor_search_lt(bp_itor* itor, const void* key);
+bool		bp_itor_search_ge(bp_itor* itor, const void* key);
+bool		bp_itor_search_gt(bp_itor* itor, const void* key);
+const void*	bp_itor_key(const bp_itor* itor);
+void**		bp_itor_datum(bp_itor* itor);
+
+END_DECL
+
+#endif /* !LIBDICT_BP_TREE_H__ */
@@ -57,8 +57,8 @@ typedef int	    (*dict_compare_func)(const void*, const void*);
 typedef void	    (*dict_delete_func)(void*, void*);
 /* A pointer to a function used for iterating over dictionary contents. */
 typedef bool	    (*dict_visit_func)(const void*, void*);
-/* A pointer to a function that returns the hash value of a key. */
-typedef unsigned    (*dict_hash_func)(const void*);
+/* A pointer to a function that returns the 64-bit hash value of a key. */
+typedef uint64_t    (*dict_hash_func)(const void*);
 /* A pointer to a function that returns the priority of a key. */
 typedef unsigned    (*dict_prio_func)(const void*);
 
@@ -69,6 +69,7 @@ extern void	    (*dict_free_func)(void*);
 
 /* Forward declarations for transparent type dict_itor. */
 typedef struct dict_itor dict_itor;
+typedef struct itor_vtable itor_vtable;
 
 typedef struct {
     void**  datum_ptr;
@@ -81,6 +82,32 @@ typedef struct {
     bool    removed;
 } dict_remove_result;
 
+/* The number of buckets in dict_stats.link_count. */
+#define DICT_STATS_LINKS    16
+
+/* A snapshot of a dictionary's internal shape, filled in by dict_get_stats().
+ * Structural fields are measured on demand and cost nothing between calls;
+ * fields which do not apply to a backend are zero. The operation counters are
+ * only maintained when libdict is compiled with -DDICT_STATS and read as zero
+ * otherwise. */
+typedef struct {
+    size_t  count;		/* Keys stored. */
+    size_t  insert_count;	/* Insertions, including failed ones. */
+    size_t  search_count;	/* Exact-match searches. */
+    size_t  remove_count;	/* Removals, including failed ones. */
+    /* Trees: */
+    size_t  rotation_count;	/* Rotations since creation (or last reset). */
+    size_t  min_leaf_depth;	/* Depth of the shallowest leaf. */
+    size_t  max_leaf_depth;	/* Depth of the deepest leaf. */
+    /* Hash tables: */
+    size_t  table_size;		/* Slots or buckets allocated. */
+    size_t  resize_count;	/* Table resizes since creation. */
+    size_t  max_probe_length;	/* Longest chain or probe sequence. */
+    double  mean_probe_length;	/* Mean probes to reach a stored key. */
+    /* Skip lists: */
+    size_t  link_count[DICT_STATS_LINKS];   /* Nodes with the given number of links. */
+} dict_stats;
+
 typedef dict_itor*  (*dict_inew_func)(void* obj);
 typedef size_t      (*dict_dfree_func)(void* obj, dict_delete_func delete_func);
 typedef dict_insert_result
@@ -89,9 +116,25 @@ typedef void**      (*dict_search_func)(void* obj, const void* key);
 typedef dict_remove_result
 		    (*dict_remove_func)(void* obj, const void* key);
 typedef size_t      (*dict_clear_func)(void* obj, dict_delete_func delete_func);
+typedef size_t      (*dict_clear_parallel_func)(void* obj,
+						dict_delete_func delete_func,
+						unsigned nthreads);
 typedef size_t      (*dict_traverse_func)(void* obj, dict_visit_func visit);
 typedef size_t      (*dict_count_func)(const void* obj);
 typedef bool	    (*dict_verify_func)(const void* obj);
+typedef size_t      (*dict_search_batch_func)(void* obj, const void* const* keys,
+					      size_t nkeys, void*** results);
+typedef size_t      (*dict_traverse_range_func)(void* obj, const void* lo,
+						const void* hi, dict_visit_func visit);
+typedef itor_vtable*
+		    (*dict_iinit_func)(void* obj, void* itor_state);
+typedef void	    (*dict_get_stats_func)(void* obj, dict_stats* stats);
+typedef void*	    (*dict_clone_func)(void* obj);
+typedef size_t	    (*dict_merge_func)(void* dst_obj, void* src_obj);
+/* Returned by a backend's merge function when the two objects cannot be
+ * merged natively (e.g. different hash functions), so that dict_merge falls
+ * back to reinserting the entries one at a time. */
+#define DICT_MERGE_INCOMPATIBLE ((size_t)-1)
 
 typedef struct {
     dict_inew_func      inew;
@@ -104,9 +147,19 @@ typedef struct {
     dict_search_func    search_gt;
     dict_remove_func    remove;
     dict_clear_func     clear;
+    dict_clear_parallel_func
+			clear_parallel;
     dict_traverse_func  traverse;
     dict_count_func     count;
     dict_verify_func	verify;
+    dict_search_batch_func
+			search_batch;
+    dict_traverse_range_func
+			traverse_range;
+    dict_iinit_func	iinit;
+    dict_get_stats_func	get_stats;
+    dict_clone_func	clone;
+    dict_merge_func	merge;
 } dict_vtable;
 
 typedef void	    (*dict_ifree_func)(void* itor);
@@ -124,7 +177,7 @@ typedef bool	    (*dict_isearch_func)(void* itor, const void* key);
 typedef bool	    (*dict_iremove_func)(void* itor);
 typedef int	    (*dict_icompare_func)(void* itor1, void* itor2);
 
-typedef struct {
+struct itor_vtable {
     dict_ifree_func	    ifree;
     dict_valid_func	    valid;
     dict_invalidate_func    invalid;
@@ -143,7 +196,7 @@ typedef struct {
     dict_isearch_func       search_gt;
     dict_iremove_func       remove;
     dict_icompare_func      compare;
-} itor_vtable;
+};
 
 typedef struct {
     void*	    _object;
@@ -160,17 +213,80 @@ typedef struct {
 #define dict_search_gt(dct,key)	    ((dct)->_vtable->search_gt((dct)->_object, (key)))
 #define dict_remove(dct,key)	    ((dct)->_vtable->remove((dct)->_object, (key)))
 #define dict_traverse(dct,func)	    ((dct)->_vtable->traverse((dct)->_object, (func)))
+#define dict_has_traverse_range(dct) ((dct)->_vtable->traverse_range != NULL)	/* Only for backends which keep keys in order. */
+/* Traverse the keys in [lo,hi] in order; a NULL bound leaves that end of the
+ * range open. Same visitation contract as dict_traverse. */
+#define dict_traverse_range(dct,lo,hi,func) \
+	((dct)->_vtable->traverse_range((dct)->_object, (lo), (hi), (func)))
 #define dict_count(dct)		    ((dct)->_vtable->count((dct)->_object))
+/* Fill |stats| with a snapshot of the dictionary's internal shape; see the
+ * dict_stats field comments for which fields each backend reports. */
+#define dict_get_stats(dct,stats)   ((dct)->_vtable->get_stats((dct)->_object, (stats)))
 #define dict_verify(dct)	    ((dct)->_vtable->verify((dct)->_object))
 #define dict_clear(dct,func)	    ((dct)->_vtable->clear((dct)->_object, (func)))
+#define dict_has_clone(dct)	    ((dct)->_vtable->clone != NULL)
 #define dict_itor_new(dct)	    (dct)->_vtable->inew((dct)->_object)
 size_t dict_free(dict* dct, dict_delete_func delete_func);
+/* Return an independent structural copy of the dictionary, or NULL if the
+ * backend does not support cloning or memory is exhausted. The clone shares
+ * the original's keys and data pointers but no internal state, so either may
+ * be mutated freely afterwards; take care not to free shared keys or data
+ * twice when both are destroyed. */
+dict* dict_clone(dict* dct);
+/* Move the entries of |src| into |dst| and return the number moved. Entries
+ * whose key is already stored in |dst| stay behind in |src|; when both
+ * dictionaries contain a key, which of the two entries ends up in |dst| is
+ * unspecified. Same-type backends with compatible comparison and hash
+ * functions take a native path: the treap and the chained hashtable splice
+ * src's existing nodes into dst without allocating, and the balanced trees
+ * merge the two sorted sequences and rebuild both sides in linear time; any
+ * other combination falls back to reinserting the entries one at a time,
+ * which allocates and can move nothing (returning 0) if memory is
+ * exhausted. */
+size_t dict_merge(dict* dst, dict* src);
+/* As dict_clear, but backends which support it partition the structure
+ * (subtrees for the trees, bucket ranges for the chained hashtable) across
+ * |nthreads| worker threads, which pays off when millions of nodes must be
+ * freed or visited. |delete_func|, when not NULL, is called concurrently
+ * from several threads and must be thread-safe. Backends without a parallel
+ * path, and any call with |nthreads| < 2, clear serially. Note that pooled
+ * tables already release all their nodes at once and gain nothing from extra
+ * threads. */
+size_t dict_clear_parallel(dict* dct, dict_delete_func delete_func,
+			   unsigned nthreads);
+/* Look up |nkeys| keys at once; results[i] receives the address of the datum
+ * associated with keys[i], or NULL if the key is absent. Backends with a
+ * batched implementation overlap the memory accesses of independent lookups;
+ * the others fall back to one search per key. Returns the number of keys
+ * found. */
+size_t dict_search_batch(dict* dct, const void* const* keys, size_t nkeys,
+			 void*** results);
 
 struct dict_itor {
     void*	    _itor;
     itor_vtable*    _vtable;
 };
 
+/* An upper bound on the size of any backend's iterator state; backends verify
+ * their iterators fit with a static assertion. */
+#define DICT_ITOR_STATE_MAX	    (4 * sizeof(void*))
+
+/* Caller-provided storage for an iterator initialized with dict_itor_init,
+ * e.g. on the stack. */
+typedef struct {
+    dict_itor	_itor;
+    union {
+	void*	_align;
+	char	_state[DICT_ITOR_STATE_MAX];
+    };
+} dict_itor_storage;
+
+/* Initialize |storage| as an iterator over |dct| without allocating. The
+ * returned iterator works with all dict_itor operations except
+ * dict_itor_free, which must not be called on it; the iterator simply ceases
+ * to exist with its storage. */
+dict_itor* dict_itor_init(dict* dct, dict_itor_storage* storage);
+
 #define dict_itor_private(i)	    ((i)->_itor)
 #define dict_itor_valid(i)	    ((i)->_vtable->valid((i)->_itor))
 #define dict_itor_invalidate(i)	    ((i)->_vtable->invalid((i)->_itor))
@@ -189,23 +305,46 @@ struct dict_itor {
 #define dict_itor_datum(i)	    ((i)->_vtable->datum((i)->_itor))
 #define dict_itor_remove(i)	    ((i)->_vtable->remove((i)->_itor))
 void dict_itor_free(dict_itor* itor);
+/* Read up to |n| entries starting at the iterator's current position,
+ * advancing past each: keys[i] and datums[i], when the arrays are not NULL,
+ * receive the i-th entry's key and the address of its datum. A single call
+ * pays the vtable dispatch once per batch instead of once per element.
+ * Returns the number of entries read, which is less than |n| only when the
+ * iterator ran off the end; the iterator is left on the entry after the last
+ * one read, or invalid. */
+size_t dict_itor_next_batch(dict_itor* itor, const void** keys, void*** datums,
+			    size_t n);
 
 int dict_int_cmp(const void* k1, const void* k2);
 int dict_uint_cmp(const void* k1, const void* k2);
 int dict_long_cmp(const void* k1, const void* k2);
 int dict_ulong_cmp(const void* k1, const void* k2);
+/* Orders the pointer values themselves, so any key no larger than a pointer
+ * can be stored in the key slot by value. The backends recognize this
+ * comparator and compare such keys inline, without the indirect call. */
 int dict_ptr_cmp(const void* k1, const void* k2);
 int dict_str_cmp(const void* k1, const void* k2);
-unsigned dict_str_hash(const void* str);
+uint64_t dict_str_hash(const void* str);
+/* As dict_str_hash, for callers that already know the key length: the scan
+ * for the terminator is skipped and |len| bytes are hashed directly, so the
+ * data need not be NUL-terminated. dict_str_hash(s) and
+ * dict_str_hash_len(s, strlen(s)) produce the same value. */
+uint64_t dict_str_hash_len(const void* str, size_t len);
 
 END_DECL
 
+#include "bp_tree.h"
+#include "dict_snapshot.h"
 #include "hashtable.h"
 #include "hashtable2.h"
+#include "hashtable3.h"
+#include "hashtable_mt.h"
 #include "hb_tree.h"
+#include "node_pool.h"
 #include "pr_tree.h"
 #include "rb_tree.h"
 #include "skiplist.h"
+#include "skiplist_mt.h"
 #include "sp_tree.h"
 #include "tr_tree.h"
 #include "wb_tree.h"
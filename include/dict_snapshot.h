@@ -0,0 +1,112 @@
+/*
+ * libdict -- memory-mapped snapshot interface.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * A snapshot is a relocatable, offset-based image of a dictionary's contents
+ * which can be written once and then served straight out of a read-only
+ * memory mapping, so a warm start costs an mmap instead of rebuilding the
+ * container one insert at a time.
+ *
+ * Keys and datums are opaque pointers to libdict, so the caller supplies
+ * dict_measure_func callbacks giving the byte length of each serialized key
+ * and datum; the bytes themselves are copied verbatim. After loading, keys
+ * point into the mapping, so the compare function passed to
+ * dict_snapshot_load must order keys by their serialized bytes the same way
+ * the original dictionary did (true of dict_str_cmp on strings saved with
+ * strlen(key) + 1, or dict_int_cmp on int keys saved with sizeof(int)).
+ *
+ * A loaded snapshot supports the whole read side of the dict interface,
+ * including near searches, range traversal, and iterators; insert and remove
+ * always fail, and clear removes nothing.
+ */
+
+#ifndef LIBDICT_DICT_SNAPSHOT_H__
+#define LIBDICT_DICT_SNAPSHOT_H__
+
+#include "dict.h"
+
+BEGIN_DECL
+
+typedef struct dict_snapshot dict_snapshot;
+
+/* A pointer to a function that returns the serialized length of a key or
+ * datum, in bytes. */
+typedef size_t	(*dict_measure_func)(const void* obj);
+
+/* Write a snapshot of |dct| to |fd|, sorting entries with |cmp_func|.
+ * |datum_len| may be NULL, or individual datums may measure zero bytes;
+ * either loads back as a NULL datum. */
+bool		dict_snapshot_save(dict* dct, int fd,
+				   dict_measure_func key_len,
+				   dict_measure_func datum_len,
+				   dict_compare_func cmp_func);
+
+dict_snapshot*	dict_snapshot_load(int fd, dict_compare_func cmp_func);
+dict*		dict_snapshot_dict_load(int fd, dict_compare_func cmp_func);
+size_t		dict_snapshot_free(dict_snapshot* snap, dict_delete_func delete_func);
+
+void**		dict_snapshot_search(dict_snapshot* snap, const void* key);
+void**		dict_snapshot_search_le(dict_snapshot* snap, const void* key);
+void**		dict_snapshot_search_lt(dict_snapshot* snap, const void* key);
+void**		dict_snapshot_search_ge(dict_snapshot* snap, const void* key);
+void**		dict_snapshot_search_gt(dict_snapshot* snap, const void* key);
+size_t		dict_snapshot_traverse(dict_snapshot* snap, dict_visit_func visit);
+size_t		dict_snapshot_traverse_range(dict_snapshot* snap, const void* lo,
+					     const void* hi, dict_visit_func visit);
+size_t		dict_snapshot_count(const dict_snapshot* snap);
+void		dict_snapshot_get_stats(dict_snapshot* snap, dict_stats* stats);
+const void*	dict_snapshot_min(const dict_snapshot* snap);
+const void*	dict_snapshot_max(const dict_snapshot* snap);
+bool		dict_snapshot_verify(const dict_snapshot* snap);
+
+typedef struct dict_snapshot_itor dict_snapshot_itor;
+
+dict_snapshot_itor*
+		dict_snapshot_itor_new(dict_snapshot* snap);
+dict_itor*	dict_snapshot_dict_itor_new(dict_snapshot* snap);
+itor_vtable*	dict_snapshot_itor_init(dict_snapshot* snap, dict_snapshot_itor* itor);
+void		dict_snapshot_itor_free(dict_snapshot_itor* itor);
+
+bool		dict_snapshot_itor_valid(const dict_snapshot_itor* itor);
+void		dict_snapshot_itor_invalidate(dict_snapshot_itor* itor);
+bool		dict_snapshot_itor_next(dict_snapshot_itor* itor);
+bool		dict_snapshot_itor_prev(dict_snapshot_itor* itor);
+bool		dict_snapshot_itor_nextn(dict_snapshot_itor* itor, size_t count);
+bool		dict_snapshot_itor_prevn(dict_snapshot_itor* itor, size_t count);
+bool		dict_snapshot_itor_first(dict_snapshot_itor* itor);
+bool		dict_snapshot_itor_last(dict_snapshot_itor* itor);
+bool		dict_snapshot_itor_search(dict_snapshot_itor* itor, const void* key);
+bool		dict_snapshot_itor_search_le(dict_snapshot_itor* itor, const void* key);
+bool		dict_snapshot_itor_search_lt(dict_snapshot_itor* itor, const void* key);
+bool		dict_snapshot_itor_search_ge(dict_snapshot_itor* itor, const void* key);
+bool		dict_snapshot_itor_search_gt(dict_snapshot_itor* itor, const void* key);
+const void*	dict_snapshot_itor_key(const dict_snapshot_itor* itor);
+void**		dict_snapshot_itor_datum(dict_snapshot_itor* itor);
+
+END_DECL
+
+#endif /* !LIBDICT_DICT_SNAPSHOT_H__ */
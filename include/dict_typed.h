@@ -0,0 +1,521 @@
+/*
+ * libdict -- compile-time specialized dictionary instantiations.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The generic containers dispatch every comparison through a function
+ * pointer and store keys as void*, which costs an indirect call and a
+ * pointer dereference per node visited. The instantiation macros below stamp
+ * out monomorphized containers for a concrete key and datum type: the
+ * comparison is a macro expanded inline, and keys and datums are stored by
+ * value in the node, so an integer-keyed tree never chases a key pointer.
+ *
+ * DICT_TYPED_TREE(name, key_type, datum_type, cmp) emits a height-balanced
+ * (AVL) tree; DICT_TYPED_HASHTABLE(name, key_type, datum_type, hash, cmp)
+ * emits a linear-probing open-addressing table. |cmp| must be a macro or
+ * function such that cmp(a, b) orders like strcmp, and |hash| must map a key
+ * to uint64_t. Instantiate in a translation unit, not a shared header; all
+ * emitted functions are static inline.
+ *
+ *     #define intcmp(a, b) (((a) > (b)) - ((a) < (b)))
+ *     DICT_TYPED_TREE(int_tree, int, int, intcmp)
+ *     ...
+ *     int_tree tree;
+ *     int_tree_init(&tree);
+ *     bool inserted;
+ *     *int_tree_insert(&tree, 13, &inserted) = 26;
+ *
+ * Unlike the generic containers, removal moves key and datum values between
+ * nodes, so datum pointers returned by search or insert are invalidated by
+ * the next removal.
+ */
+
+#ifndef LIBDICT_DICT_TYPED_H__
+#define LIBDICT_DICT_TYPED_H__
+
+#include <string.h>
+#include "dict.h"
+
+/* An AVL tree's height never exceeds 1.44 lg n, so 96 levels of path
+ * tracking suffice for any tree which fits in a 64-bit address space. */
+#define DICT_TYPED_TREE_MAX_PATH 96
+
+#define DICT_TYPED_TREE(name, key_type, datum_type, cmp)		\
+typedef struct name##_node {						\
+    struct name##_node* link[2];					\
+    signed char	    bal;						\
+    key_type	    key;						\
+    datum_type	    datum;						\
+} name##_node;								\
+									\
+typedef struct {							\
+    name##_node*    root;						\
+    size_t	    count;						\
+} name;									\
+									\
+static inline void							\
+name##_init(name* tree)							\
+{									\
+    tree->root = NULL;							\
+    tree->count = 0;							\
+}									\
+									\
+static inline datum_type*						\
+name##_search(name* tree, key_type key)					\
+{									\
+    name##_node* node = tree->root;					\
+    while (node) {							\
+	const int c = cmp(key, node->key);				\
+	if (c == 0)							\
+	    return &node->datum;					\
+	node = node->link[c > 0];					\
+    }									\
+    return NULL;							\
+}									\
+									\
+static inline datum_type*						\
+name##_insert(name* tree, key_type key, bool* inserted)			\
+{									\
+    /* |s| is the deepest node on the search path with nonzero balance	\
+     * (or the root); only balances below it change, and it is the only	\
+     * node where a rotation can be needed. |slot| holds |s|. */	\
+    name##_node** slot = &tree->root;					\
+    name##_node** where = &tree->root;					\
+    name##_node* s = tree->root;					\
+    name##_node* p = tree->root;					\
+    while (p) {								\
+	const int c = cmp(key, p->key);					\
+	if (c == 0) {							\
+	    if (inserted)						\
+		*inserted = false;					\
+	    return &p->datum;						\
+	}								\
+	const int dir = c > 0;						\
+	if (p->link[dir] && p->link[dir]->bal != 0) {			\
+	    slot = &p->link[dir];					\
+	    s = p->link[dir];						\
+	}								\
+	where = &p->link[dir];						\
+	p = p->link[dir];						\
+    }									\
+    name##_node* add = dict_malloc_func(sizeof(*add));			\
+    if (!add) {								\
+	if (inserted)							\
+	    *inserted = false;						\
+	return NULL;							\
+    }									\
+    add->link[0] = add->link[1] = NULL;					\
+    add->bal = 0;							\
+    add->key = key;							\
+    memset(&add->datum, 0, sizeof(add->datum));				\
+    *where = add;							\
+    tree->count++;							\
+    for (p = s; p && p != add; ) {					\
+	const int dir = cmp(key, p->key) > 0;				\
+	p->bal += dir ? 1 : -1;						\
+	p = p->link[dir];						\
+    }									\
+    if (s && (s->bal == 2 || s->bal == -2)) {				\
+	const int hdir = s->bal > 0;					\
+	const int hd = hdir ? 1 : -1;					\
+	name##_node* child = s->link[hdir];				\
+	if (child->bal == hd) {						\
+	    s->link[hdir] = child->link[!hdir];				\
+	    child->link[!hdir] = s;					\
+	    s->bal = child->bal = 0;					\
+	    *slot = child;						\
+	} else {							\
+	    name##_node* gc = child->link[!hdir];			\
+	    child->link[!hdir] = gc->link[hdir];			\
+	    gc->link[hdir] = child;					\
+	    s->link[hdir] = gc->link[!hdir];				\
+	    gc->link[!hdir] = s;					\
+	    s->bal = child->bal = 0;					\
+	    if (gc->bal == hd)						\
+		s->bal = -hd;						\
+	    else if (gc->bal == -hd)					\
+		child->bal = hd;					\
+	    gc->bal = 0;						\
+	    *slot = gc;							\
+	}								\
+    }									\
+    if (inserted)							\
+	*inserted = true;						\
+    return &add->datum;							\
+}									\
+									\
+static inline bool							\
+name##_remove(name* tree, key_type key)					\
+{									\
+    name##_node** slots[DICT_TYPED_TREE_MAX_PATH];			\
+    int dirs[DICT_TYPED_TREE_MAX_PATH];					\
+    unsigned depth = 0;							\
+    name##_node** slot = &tree->root;					\
+    name##_node* p = tree->root;					\
+    for (;;) {								\
+	if (!p)								\
+	    return false;						\
+	const int c = cmp(key, p->key);					\
+	if (c == 0)							\
+	    break;							\
+	const int dir = c > 0;						\
+	slots[depth] = slot;						\
+	dirs[depth] = dir;						\
+	++depth;							\
+	slot = &p->link[dir];						\
+	p = *slot;							\
+    }									\
+    if (p->link[0] && p->link[1]) {					\
+	/* Move the in-order successor's key and datum into |p| and	\
+	 * unlink the successor, which has no left child. */		\
+	slots[depth] = slot;						\
+	dirs[depth] = 1;						\
+	++depth;							\
+	name##_node** sslot = &p->link[1];				\
+	name##_node* succ = *sslot;					\
+	while (succ->link[0]) {						\
+	    slots[depth] = sslot;					\
+	    dirs[depth] = 0;						\
+	    ++depth;							\
+	    sslot = &succ->link[0];					\
+	    succ = *sslot;						\
+	}								\
+	p->key = succ->key;						\
+	p->datum = succ->datum;						\
+	slot = sslot;							\
+	p = succ;							\
+    }									\
+    *slot = p->link[p->link[0] ? 0 : 1];				\
+    dict_free_func(p);							\
+    tree->count--;							\
+    while (depth--) {							\
+	name##_node* a = *slots[depth];					\
+	const int d = dirs[depth] ? 1 : -1;				\
+	a->bal -= d;							\
+	if (a->bal == -d)						\
+	    break;		/* Subtree height unchanged. */		\
+	if (a->bal == 0)						\
+	    continue;		/* Subtree shrank; keep going up. */	\
+	const int hdir = a->bal > 0;					\
+	const int hd = hdir ? 1 : -1;					\
+	name##_node* child = a->link[hdir];				\
+	if (child->bal == -hd) {					\
+	    name##_node* gc = child->link[!hdir];			\
+	    child->link[!hdir] = gc->link[hdir];			\
+	    gc->link[hdir] = child;					\
+	    a->link[hdir] = gc->link[!hdir];				\
+	    gc->link[!hdir] = a;					\
+	    a->bal = child->bal = 0;					\
+	    if (gc->bal == hd)						\
+		a->bal = -hd;						\
+	    else if (gc->bal == -hd)					\
+		child->bal = hd;					\
+	    gc->bal = 0;						\
+	    *slots[depth] = gc;						\
+	} else {							\
+	    a->link[hdir] = child->link[!hdir];				\
+	    child->link[!hdir] = a;					\
+	    *slots[depth] = child;					\
+	    if (child->bal == 0) {					\
+		child->bal = -hd;					\
+		a->bal = hd;						\
+		break;		/* Subtree height unchanged. */		\
+	    }								\
+	    child->bal = a->bal = 0;					\
+	}								\
+    }									\
+    return true;							\
+}									\
+									\
+static inline bool							\
+name##_traverse_node(name##_node* node,					\
+		     bool (*visit)(key_type key, datum_type* datum),	\
+		     size_t* count)					\
+{									\
+    if (node->link[0] && !name##_traverse_node(node->link[0], visit, count)) \
+	return false;							\
+    ++*count;								\
+    if (!visit(node->key, &node->datum))				\
+	return false;							\
+    return !node->link[1] ||						\
+	name##_traverse_node(node->link[1], visit, count);		\
+}									\
+									\
+static inline size_t							\
+name##_traverse(name* tree,						\
+		bool (*visit)(key_type key, datum_type* datum))		\
+{									\
+    size_t count = 0;							\
+    if (tree->root)							\
+	name##_traverse_node(tree->root, visit, &count);		\
+    return count;							\
+}									\
+									\
+static inline size_t							\
+name##_count(const name* tree)						\
+{									\
+    return tree->count;							\
+}									\
+									\
+static inline void							\
+name##_clear_node(name##_node* node)					\
+{									\
+    if (node->link[0])							\
+	name##_clear_node(node->link[0]);				\
+    if (node->link[1])							\
+	name##_clear_node(node->link[1]);				\
+    dict_free_func(node);						\
+}									\
+									\
+static inline size_t							\
+name##_clear(name* tree)						\
+{									\
+    const size_t count = tree->count;					\
+    if (tree->root) {							\
+	name##_clear_node(tree->root);					\
+	tree->root = NULL;						\
+	tree->count = 0;						\
+    }									\
+    return count;							\
+}									\
+									\
+static inline int							\
+name##_verify_node(const name##_node* node, size_t* count)		\
+{									\
+    if (!node)								\
+	return 0;							\
+    if (node->link[0] && cmp(node->link[0]->key, node->key) >= 0)	\
+	return -1;							\
+    if (node->link[1] && cmp(node->key, node->link[1]->key) >= 0)	\
+	return -1;							\
+    const int lh = name##_verify_node(node->link[0], count);		\
+    const int rh = name##_verify_node(node->link[1], count);		\
+    if (lh < 0 || rh < 0 || node->bal != rh - lh ||			\
+	node->bal < -1 || node->bal > 1)				\
+	return -1;							\
+    ++*count;								\
+    return (lh > rh ? lh : rh) + 1;					\
+}									\
+									\
+static inline bool							\
+name##_verify(const name* tree)						\
+{									\
+    size_t count = 0;							\
+    return name##_verify_node(tree->root, &count) >= 0 &&		\
+	count == tree->count;						\
+}
+
+#define DICT_TYPED_HASHTABLE(name, key_type, datum_type, hash, cmp)	\
+typedef struct {							\
+    uint64_t	hash;		/* Zero for an empty slot. */		\
+    key_type	key;							\
+    datum_type	datum;							\
+} name##_slot;								\
+									\
+typedef struct {							\
+    name##_slot*    table;						\
+    size_t	    size;	/* Always a power of two. */		\
+    size_t	    count;						\
+} name;									\
+									\
+static inline uint64_t							\
+name##_hash_key(key_type key)						\
+{									\
+    const uint64_t h = hash(key);					\
+    return h ? h : ~(uint64_t)0;					\
+}									\
+									\
+static inline bool							\
+name##_init(name* tbl, size_t initial_size)				\
+{									\
+    size_t size = 16;							\
+    while (size < initial_size)						\
+	size <<= 1;							\
+    tbl->table = dict_malloc_func(size * sizeof(name##_slot));		\
+    if (!tbl->table)							\
+	return false;							\
+    memset(tbl->table, 0, size * sizeof(name##_slot));			\
+    tbl->size = size;							\
+    tbl->count = 0;							\
+    return true;							\
+}									\
+									\
+static inline datum_type*						\
+name##_search(name* tbl, key_type key)					\
+{									\
+    const uint64_t h = name##_hash_key(key);				\
+    const size_t mask = tbl->size - 1;					\
+    for (size_t i = h & mask; tbl->table[i].hash; i = (i + 1) & mask) {	\
+	if (tbl->table[i].hash == h && cmp(key, tbl->table[i].key) == 0) \
+	    return &tbl->table[i].datum;				\
+    }									\
+    return NULL;							\
+}									\
+									\
+static inline bool							\
+name##_grow(name* tbl)							\
+{									\
+    const size_t nsize = tbl->size * 2;					\
+    name##_slot* ntable = dict_malloc_func(nsize * sizeof(name##_slot)); \
+    if (!ntable)							\
+	return false;							\
+    memset(ntable, 0, nsize * sizeof(name##_slot));			\
+    const size_t nmask = nsize - 1;					\
+    for (size_t i = 0; i < tbl->size; ++i) {				\
+	if (!tbl->table[i].hash)					\
+	    continue;							\
+	size_t j = tbl->table[i].hash & nmask;				\
+	while (ntable[j].hash)						\
+	    j = (j + 1) & nmask;					\
+	ntable[j] = tbl->table[i];					\
+    }									\
+    dict_free_func(tbl->table);						\
+    tbl->table = ntable;						\
+    tbl->size = nsize;							\
+    return true;							\
+}									\
+									\
+static inline datum_type*						\
+name##_insert(name* tbl, key_type key, bool* inserted)			\
+{									\
+    if (tbl->count * 3 >= tbl->size * 2 && !name##_grow(tbl)) {		\
+	if (inserted)							\
+	    *inserted = false;						\
+	return NULL;							\
+    }									\
+    const uint64_t h = name##_hash_key(key);				\
+    const size_t mask = tbl->size - 1;					\
+    size_t i = h & mask;						\
+    while (tbl->table[i].hash) {					\
+	if (tbl->table[i].hash == h && cmp(key, tbl->table[i].key) == 0) { \
+	    if (inserted)						\
+		*inserted = false;					\
+	    return &tbl->table[i].datum;				\
+	}								\
+	i = (i + 1) & mask;						\
+    }									\
+    tbl->table[i].hash = h;						\
+    tbl->table[i].key = key;						\
+    memset(&tbl->table[i].datum, 0, sizeof(tbl->table[i].datum));	\
+    tbl->count++;							\
+    if (inserted)							\
+	*inserted = true;						\
+    return &tbl->table[i].datum;					\
+}									\
+									\
+static inline bool							\
+name##_remove(name* tbl, key_type key)					\
+{									\
+    const uint64_t h = name##_hash_key(key);				\
+    const size_t mask = tbl->size - 1;					\
+    size_t i = h & mask;						\
+    for (;; i = (i + 1) & mask) {					\
+	if (!tbl->table[i].hash)					\
+	    return false;						\
+	if (tbl->table[i].hash == h && cmp(key, tbl->table[i].key) == 0) \
+	    break;							\
+    }									\
+    /* Shift later entries of the probe sequence backward instead of	\
+     * leaving a tombstone, so searches still stop at an empty slot. */	\
+    size_t j = i;							\
+    for (;;) {								\
+	j = (j + 1) & mask;						\
+	if (!tbl->table[j].hash)					\
+	    break;							\
+	const size_t home = tbl->table[j].hash & mask;			\
+	if (((j - home) & mask) >= ((j - i) & mask)) {			\
+	    tbl->table[i] = tbl->table[j];				\
+	    i = j;							\
+	}								\
+    }									\
+    tbl->table[i].hash = 0;						\
+    tbl->count--;							\
+    return true;							\
+}									\
+									\
+static inline size_t							\
+name##_traverse(name* tbl,						\
+		bool (*visit)(key_type key, datum_type* datum))		\
+{									\
+    size_t count = 0;							\
+    for (size_t i = 0; i < tbl->size; ++i) {				\
+	if (tbl->table[i].hash) {					\
+	    ++count;							\
+	    if (!visit(tbl->table[i].key, &tbl->table[i].datum))	\
+		break;							\
+	}								\
+    }									\
+    return count;							\
+}									\
+									\
+static inline size_t							\
+name##_count(const name* tbl)						\
+{									\
+    return tbl->count;							\
+}									\
+									\
+static inline size_t							\
+name##_clear(name* tbl)							\
+{									\
+    const size_t count = tbl->count;					\
+    memset(tbl->table, 0, tbl->size * sizeof(name##_slot));		\
+    tbl->count = 0;							\
+    return count;							\
+}									\
+									\
+static inline void							\
+name##_free(name* tbl)							\
+{									\
+    dict_free_func(tbl->table);						\
+    tbl->table = NULL;							\
+    tbl->size = tbl->count = 0;						\
+}									\
+									\
+static inline bool							\
+name##_verify(const name* tbl)						\
+{									\
+    if (tbl->size == 0 || (tbl->size & (tbl->size - 1)) != 0)		\
+	return false;							\
+    if (tbl->count * 3 > tbl->size * 2)					\
+	return false;							\
+    const size_t mask = tbl->size - 1;					\
+    size_t occupied = 0;						\
+    for (size_t i = 0; i < tbl->size; ++i) {				\
+	if (!tbl->table[i].hash)					\
+	    continue;							\
+	++occupied;							\
+	/* Every slot between an entry's home and its position must be	\
+	 * occupied, or searches would stop short of it. */		\
+	for (size_t j = tbl->table[i].hash & mask; j != i;		\
+	     j = (j + 1) & mask) {					\
+	    if (!tbl->table[j].hash)					\
+		return false;						\
+	}								\
+    }									\
+    return occupied == tbl->count;					\
+}
+
+#endif /* !LIBDICT_DICT_TYPED_H__ */
@@ -35,19 +35,49 @@ BEGIN_DECL
 typedef struct hashtable hashtable;
 
 hashtable*	hashtable_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
+/* As hashtable_new, but table growth migrates a bounded number of buckets per
+ * insert/search/remove call instead of rehashing everything at once. */
+hashtable*	hashtable_new_incremental(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
+/* As hashtable_new, but nodes are carved out of a slab allocator owned by the
+ * table, so clearing the table without a delete function frees all nodes at
+ * once instead of walking them. */
+hashtable*	hashtable_new_pooled(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
+/* As hashtable_new, but the table keeps a one-byte fingerprint of each
+ * bucket's resident hashes, letting searches for most absent keys be
+ * rejected with a single cache-resident load instead of a chain walk. */
+hashtable*	hashtable_new_filtered(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
+/* As hashtable_new, but the bucket count is kept a power of two rather than
+ * prime, so hashes map to slots with a multiply and mask instead of an
+ * integer division. */
+hashtable*	hashtable_new_pow2(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
 dict*		hashtable_dict_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
+dict*		hashtable_dict_new_incremental(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
+dict*		hashtable_dict_new_pooled(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
+dict*		hashtable_dict_new_filtered(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
+dict*		hashtable_dict_new_pow2(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
 size_t		hashtable_free(hashtable* table, dict_delete_func delete_func);
 
 dict_insert_result
 		hashtable_insert(hashtable* table, void* key);
 void**		hashtable_search(hashtable* table, const void* key);
+size_t		hashtable_search_batch(hashtable* table, const void* const* keys, size_t nkeys, void*** results);
 dict_remove_result
 		hashtable_remove(hashtable* table, const void* key);
+/* Splice |src|'s nodes into |table|'s bucket chains without reallocating;
+ * see dict_merge for the contract. Returns DICT_MERGE_INCOMPATIBLE unless
+ * both tables use the same comparison and hash functions and neither is
+ * pooled. */
+size_t		hashtable_merge(hashtable* table, hashtable* src);
 size_t		hashtable_clear(hashtable* table, dict_delete_func delete_func);
+/* As hashtable_clear, but splits the bucket array across |nthreads| worker
+ * threads; |delete_func| must be thread-safe. Pooled and lightly loaded
+ * tables clear serially. */
+size_t		hashtable_clear_parallel(hashtable* table, dict_delete_func delete_func, unsigned nthreads);
 size_t		hashtable_traverse(hashtable* table, dict_visit_func visit);
 size_t		hashtable_count(const hashtable* table);
 size_t		hashtable_size(const hashtable* table);
 size_t		hashtable_slots_used(const hashtable* table);
+void		hashtable_get_stats(hashtable* table, dict_stats* stats);
 bool		hashtable_verify(const hashtable* table);
 bool		hashtable_resize(hashtable* table, unsigned size);
 
@@ -55,6 +85,7 @@ typedef struct hashtable_itor hashtable_itor;
 
 hashtable_itor* hashtable_itor_new(hashtable* table);
 dict_itor*	hashtable_dict_itor_new(hashtable* table);
+itor_vtable*	hashtable_itor_init(hashtable* table, hashtable_itor* itor);
 void		hashtable_itor_free(hashtable_itor* itor);
 
 bool		hashtable_itor_valid(const hashtable_itor* itor);
@@ -68,6 +99,9 @@ bool		hashtable_itor_last(hashtable_itor* itor);
 bool		hashtable_itor_search(hashtable_itor* itor, const void* key);
 const void*	hashtable_itor_key(const hashtable_itor* itor);
 void**		hashtable_itor_datum(hashtable_itor* itor);
+/* Unlink the entry the iterator points at, in constant time and without
+ * rehashing its key, and advance to the successor. Returns true iff the
+ * iterator is left on a valid entry. */
 bool		hashtable_itor_remove(hashtable_itor* itor);
 
 END_DECL
@@ -35,12 +35,28 @@ BEGIN_DECL
 typedef struct hashtable2 hashtable2;
 
 hashtable2*	hashtable2_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size);
+/* As hashtable2_new, but table growth migrates a bounded number of slots per
+ * insert/search/remove call instead of rehashing everything at once. */
+hashtable2*	hashtable2_new_incremental(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size);
+/* As hashtable2_new, but the table also shrinks automatically: when removals
+ * leave the load factor below a low-water mark, the entries are rehashed into
+ * a smaller array (never below |initial_size|), keeping memory proportional
+ * to the live data. */
+hashtable2*	hashtable2_new_shrinking(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size);
+/* As hashtable2_new, but the slot count is kept a power of two rather than
+ * prime, so hashes map to slots with a multiply and mask instead of an
+ * integer division. */
+hashtable2*	hashtable2_new_pow2(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size);
 dict*		hashtable2_dict_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size);
+dict*		hashtable2_dict_new_incremental(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size);
+dict*		hashtable2_dict_new_shrinking(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size);
+dict*		hashtable2_dict_new_pow2(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size);
 size_t		hashtable2_free(hashtable2* table, dict_delete_func delete_func);
 
 dict_insert_result
 		hashtable2_insert(hashtable2* table, void* key);
 void**		hashtable2_search(hashtable2* table, const void* key);
+size_t		hashtable2_search_batch(hashtable2* table, const void* const* keys, size_t nkeys, void*** results);
 dict_remove_result
 		hashtable2_remove(hashtable2* table, const void* key);
 size_t		hashtable2_clear(hashtable2* table, dict_delete_func delete_func);
@@ -48,13 +64,18 @@ size_t		hashtable2_traverse(hashtable2* table, dict_visit_func visit);
 size_t		hashtable2_count(const hashtable2* table);
 size_t		hashtable2_size(const hashtable2* table);
 size_t		hashtable2_slots_used(const hashtable2* table);
+void		hashtable2_get_stats(hashtable2* table, dict_stats* stats);
 bool		hashtable2_verify(const hashtable2* table);
 bool		hashtable2_resize(hashtable2* table, unsigned size);
+/* Rehash into the smallest array that still leaves headroom for a few
+ * insertions, regardless of the automatic shrink policy. */
+bool		hashtable2_shrink_to_fit(hashtable2* table);
 
 typedef struct hashtable2_itor hashtable2_itor;
 
 hashtable2_itor* hashtable2_itor_new(hashtable2* table);
 dict_itor*	hashtable2_dict_itor_new(hashtable2* table);
+itor_vtable*	hashtable2_itor_init(hashtable2* table, hashtable2_itor* itor);
 void		hashtable2_itor_free(hashtable2_itor* itor);
 
 bool		hashtable2_itor_valid(const hashtable2_itor* itor);
@@ -68,6 +89,11 @@ bool		hashtable2_itor_last(hashtable2_itor* itor);
 bool		hashtable2_itor_search(hashtable2_itor* itor, const void* key);
 const void*	hashtable2_itor_key(const hashtable2_itor* itor);
 void**		hashtable2_itor_datum(hashtable2_itor* itor);
+/* Remove the entry the iterator points at without rehashing its key, and
+ * advance to the successor. Returns true iff the iterator is left on a valid
+ * entry. Repairing the probe cluster may shift a not-yet-visited entry
+ * around the end of the slot array, in which case a full scan can see that
+ * entry twice; removal never causes entries to be skipped. */
 bool		hashtable2_itor_remove(hashtable2_itor* itor);
 
 END_DECL
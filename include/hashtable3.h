@@ -0,0 +1,78 @@
+/*
+ * libdict -- open-addressing hash-table with group probing interface.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBDICT_HASHTABLE3_H__
+#define LIBDICT_HASHTABLE3_H__
+
+#include "dict.h"
+
+BEGIN_DECL
+
+typedef struct hashtable3 hashtable3;
+
+hashtable3*	hashtable3_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size);
+dict*		hashtable3_dict_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size);
+size_t		hashtable3_free(hashtable3* table, dict_delete_func delete_func);
+
+dict_insert_result
+		hashtable3_insert(hashtable3* table, void* key);
+void**		hashtable3_search(hashtable3* table, const void* key);
+size_t		hashtable3_search_batch(hashtable3* table, const void* const* keys, size_t nkeys, void*** results);
+dict_remove_result
+		hashtable3_remove(hashtable3* table, const void* key);
+size_t		hashtable3_clear(hashtable3* table, dict_delete_func delete_func);
+size_t		hashtable3_traverse(hashtable3* table, dict_visit_func visit);
+size_t		hashtable3_count(const hashtable3* table);
+size_t		hashtable3_size(const hashtable3* table);
+size_t		hashtable3_slots_used(const hashtable3* table);
+void		hashtable3_get_stats(hashtable3* table, dict_stats* stats);
+bool		hashtable3_verify(const hashtable3* table);
+bool		hashtable3_resize(hashtable3* table, unsigned size);
+
+typedef struct hashtable3_itor hashtable3_itor;
+
+hashtable3_itor* hashtable3_itor_new(hashtable3* table);
+dict_itor*	hashtable3_dict_itor_new(hashtable3* table);
+itor_vtable*	hashtable3_itor_init(hashtable3* table, hashtable3_itor* itor);
+void		hashtable3_itor_free(hashtable3_itor* itor);
+
+bool		hashtable3_itor_valid(const hashtable3_itor* itor);
+void		hashtable3_itor_invalidate(hashtable3_itor* itor);
+bool		hashtable3_itor_next(hashtable3_itor* itor);
+bool		hashtable3_itor_prev(hashtable3_itor* itor);
+bool		hashtable3_itor_nextn(hashtable3_itor* itor, size_t count);
+bool		hashtable3_itor_prevn(hashtable3_itor* itor, size_t count);
+bool		hashtable3_itor_first(hashtable3_itor* itor);
+bool		hashtable3_itor_last(hashtable3_itor* itor);
+bool		hashtable3_itor_search(hashtable3_itor* itor, const void* key);
+const void*	hashtable3_itor_key(const hashtable3_itor* itor);
+void**		hashtable3_itor_datum(hashtable3_itor* itor);
+bool		hashtable3_itor_remove(hashtable3_itor* itor);
+
+END_DECL
+
+#endif /* !LIBDICT_HASHTABLE3_H__ */
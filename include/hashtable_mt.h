@@ -0,0 +1,89 @@
+/*
+ * libdict -- thread-safe chained hash-table interface.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBDICT_HASHTABLE_MT_H__
+#define LIBDICT_HASHTABLE_MT_H__
+
+#include "dict.h"
+
+BEGIN_DECL
+
+/* A chained hash table whose bucket array is partitioned into stripes, each
+ * guarded by its own read-write lock, so that insert, search and remove may
+ * be called concurrently from multiple threads. Lookups in different stripes
+ * never contend, and readers of the same stripe share its lock. The caller's
+ * compare and hash functions must be thread-safe, and access to a datum
+ * through a returned pointer must be synchronized by the caller. */
+typedef struct hashtable_mt hashtable_mt;
+
+hashtable_mt*	hashtable_mt_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
+dict*		hashtable_mt_dict_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size);
+size_t		hashtable_mt_free(hashtable_mt* table, dict_delete_func delete_func);
+
+dict_insert_result
+		hashtable_mt_insert(hashtable_mt* table, void* key);
+void**		hashtable_mt_search(hashtable_mt* table, const void* key);
+dict_remove_result
+		hashtable_mt_remove(hashtable_mt* table, const void* key);
+size_t		hashtable_mt_clear(hashtable_mt* table, dict_delete_func delete_func);
+size_t		hashtable_mt_traverse(hashtable_mt* table, dict_visit_func visit);
+size_t		hashtable_mt_count(const hashtable_mt* table);
+size_t		hashtable_mt_size(const hashtable_mt* table);
+void		hashtable_mt_get_stats(hashtable_mt* table, dict_stats* stats);
+bool		hashtable_mt_verify(const hashtable_mt* table);
+
+typedef struct hashtable_mt_itor hashtable_mt_itor;
+
+/* Iterators created with the plain constructors do not lock anything; the
+ * caller must ensure no concurrent modification while one is in use. The
+ * _locked constructors read-lock the whole table until the iterator is
+ * freed, excluding writers but not other readers. */
+hashtable_mt_itor*
+		hashtable_mt_itor_new(hashtable_mt* table);
+hashtable_mt_itor*
+		hashtable_mt_itor_new_locked(hashtable_mt* table);
+dict_itor*	hashtable_mt_dict_itor_new(hashtable_mt* table);
+dict_itor*	hashtable_mt_dict_itor_new_locked(hashtable_mt* table);
+/* Initialize caller-provided iterator storage (unlocked); see dict_itor_init. */
+itor_vtable*	hashtable_mt_itor_init(hashtable_mt* table, hashtable_mt_itor* itor);
+void		hashtable_mt_itor_free(hashtable_mt_itor* itor);
+
+bool		hashtable_mt_itor_valid(const hashtable_mt_itor* itor);
+void		hashtable_mt_itor_invalidate(hashtable_mt_itor* itor);
+bool		hashtable_mt_itor_next(hashtable_mt_itor* itor);
+bool		hashtable_mt_itor_prev(hashtable_mt_itor* itor);
+bool		hashtable_mt_itor_nextn(hashtable_mt_itor* itor, size_t count);
+bool		hashtable_mt_itor_prevn(hashtable_mt_itor* itor, size_t count);
+bool		hashtable_mt_itor_first(hashtable_mt_itor* itor);
+bool		hashtable_mt_itor_last(hashtable_mt_itor* itor);
+bool		hashtable_mt_itor_search(hashtable_mt_itor* itor, const void* key);
+const void*	hashtable_mt_itor_key(const hashtable_mt_itor* itor);
+void**		hashtable_mt_itor_datum(hashtable_mt_itor* itor);
+
+END_DECL
+
+#endif /* !LIBDICT_HASHTABLE_MT_H__ */
@@ -36,7 +36,15 @@ typedef struct hb_tree hb_tree;
 
 hb_tree*	hb_tree_new(dict_compare_func cmp_func);
 dict*		hb_dict_new(dict_compare_func cmp_func);
+/* Build a perfectly balanced tree from |nkeys| distinct keys in ascending
+ * order, in linear time with no rotations. |datums| may be NULL, or an array
+ * of initial values parallel to |keys|. */
+hb_tree*	hb_tree_from_sorted(dict_compare_func cmp_func, void* const* keys, void* const* datums, size_t nkeys);
+dict*		hb_dict_from_sorted(dict_compare_func cmp_func, void* const* keys, void* const* datums, size_t nkeys);
 size_t		hb_tree_free(hb_tree* tree, dict_delete_func delete_func);
+/* Return an independent copy of the tree which shares its keys and data;
+ * see dict_clone. */
+hb_tree*	hb_tree_clone(hb_tree* tree);
 
 dict_insert_result
 		hb_tree_insert(hb_tree* tree, void* key);
@@ -47,6 +55,11 @@ void**		hb_tree_search_ge(hb_tree* tree, const void* key);
 void**		hb_tree_search_gt(hb_tree* tree, const void* key);
 dict_remove_result
 		hb_tree_remove(hb_tree* tree, const void* key);
+/* Move |src|'s entries into |tree| in linear time by merging the two sorted
+ * sequences and rebuilding both trees; see dict_merge for the contract.
+ * Returns DICT_MERGE_INCOMPATIBLE unless the trees share a comparison
+ * function. */
+size_t		hb_tree_merge(hb_tree* tree, hb_tree* src);
 size_t		hb_tree_clear(hb_tree* tree, dict_delete_func delete_func);
 size_t		hb_tree_traverse(hb_tree* tree, dict_visit_func visit);
 size_t		hb_tree_count(const hb_tree* tree);
@@ -61,6 +74,8 @@ typedef struct hb_itor hb_itor;
 
 hb_itor*	hb_itor_new(hb_tree* tree);
 dict_itor*	hb_dict_itor_new(hb_tree* tree);
+/* Initialize caller-provided iterator storage; see dict_itor_init. */
+itor_vtable*	hb_itor_init(hb_tree* tree, hb_itor* itor);
 void		hb_itor_free(hb_itor* tree);
 
 bool		hb_itor_valid(const hb_itor* itor);
@@ -0,0 +1,58 @@
+/*
+ * libdict -- fixed-size node allocator interface.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBDICT_NODE_POOL_H__
+#define LIBDICT_NODE_POOL_H__
+
+#include "dict.h"
+
+BEGIN_DECL
+
+/* A slab allocator for fixed-size dictionary nodes. Nodes are carved out of
+ * large chunks obtained with dict_malloc_func, so allocating a node usually
+ * costs a pointer bump, and node_pool_clear releases every node at once
+ * without walking them. Pools are not thread-safe. */
+typedef struct node_pool node_pool;
+
+node_pool*	node_pool_new(size_t node_size);
+/* As node_pool_new, but every node starts on an |align| boundary, which must
+ * be a power of two; sizes are rounded up to a multiple of it. Useful for
+ * keeping small nodes from straddling cache lines. */
+node_pool*	node_pool_new_aligned(size_t node_size, size_t align);
+/* Release all chunks and the pool itself. Any node still allocated from the
+ * pool becomes invalid. */
+void		node_pool_free(node_pool* pool);
+
+void*		node_pool_alloc(node_pool* pool);
+void		node_pool_dealloc(node_pool* pool, void* node);
+/* Release all chunks at once; every node allocated from the pool becomes
+ * invalid, but the pool itself remains usable. */
+void		node_pool_clear(node_pool* pool);
+
+END_DECL
+
+#endif /* !LIBDICT_NODE_POOL_H__ */
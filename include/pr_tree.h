@@ -36,7 +36,15 @@ typedef struct pr_tree pr_tree;
 
 pr_tree*	pr_tree_new(dict_compare_func cmp_func);
 dict*		pr_dict_new(dict_compare_func cmp_func);
+/* Build a perfectly balanced tree in linear time from |nkeys| distinct keys
+ * in ascending order, with initial values taken from |datums| unless it is
+ * NULL. */
+pr_tree*	pr_tree_from_sorted(dict_compare_func cmp_func, void* const* keys, void* const* datums, size_t nkeys);
+dict*		pr_dict_from_sorted(dict_compare_func cmp_func, void* const* keys, void* const* datums, size_t nkeys);
 size_t		pr_tree_free(pr_tree* tree, dict_delete_func delete_func);
+/* Return an independent copy of the tree which shares its keys and data;
+ * see dict_clone. */
+pr_tree*	pr_tree_clone(pr_tree* tree);
 
 dict_insert_result
 		pr_tree_insert(pr_tree* tree, void* key);
@@ -47,6 +55,11 @@ void**		pr_tree_search_ge(pr_tree* tree, const void* key);
 void**		pr_tree_search_gt(pr_tree* tree, const void* key);
 dict_remove_result
 		pr_tree_remove(pr_tree* tree, const void* key);
+/* Move |src|'s entries into |tree| in linear time by merging the two sorted
+ * sequences and rebuilding both trees; see dict_merge for the contract.
+ * Returns DICT_MERGE_INCOMPATIBLE unless the trees share a comparison
+ * function. */
+size_t		pr_tree_merge(pr_tree* tree, pr_tree* src);
 size_t		pr_tree_clear(pr_tree* tree, dict_delete_func delete_func);
 size_t		pr_tree_traverse(pr_tree* tree, dict_visit_func visit);
 size_t		pr_tree_count(const pr_tree* tree);
@@ -61,6 +74,7 @@ typedef struct pr_itor pr_itor;
 
 pr_itor*	pr_itor_new(pr_tree* tree);
 dict_itor*	pr_dict_itor_new(pr_tree* tree);
+itor_vtable*	pr_itor_init(pr_tree* tree, pr_itor* itor);
 void		pr_itor_free(pr_itor* tree);
 
 bool		pr_itor_valid(const pr_itor* itor);
@@ -36,23 +36,45 @@ typedef struct rb_tree rb_tree;
 
 rb_tree*	rb_tree_new(dict_compare_func cmp_func);
 dict*		rb_dict_new(dict_compare_func cmp_func);
+/* As rb_tree_new, but nodes are carved out of a slab allocator owned by the
+ * tree, so clearing the tree without a delete function frees all nodes at
+ * once instead of walking them. */
+rb_tree*	rb_tree_new_pooled(dict_compare_func cmp_func);
+dict*		rb_dict_new_pooled(dict_compare_func cmp_func);
+/* Build a perfectly balanced tree from |nkeys| distinct keys in ascending
+ * order, in linear time with no rotations; only the deepest level is colored
+ * red. |datums| may be NULL, or an array of initial values parallel to
+ * |keys|. */
+rb_tree*	rb_tree_from_sorted(dict_compare_func cmp_func, void* const* keys, void* const* datums, size_t nkeys);
+dict*		rb_dict_from_sorted(dict_compare_func cmp_func, void* const* keys, void* const* datums, size_t nkeys);
 size_t		rb_tree_free(rb_tree* tree, dict_delete_func delete_func);
+/* Return an independent copy of the tree which shares its keys and data;
+ * a pooled tree yields a clone with its own pool. See dict_clone. */
+rb_tree*	rb_tree_clone(rb_tree* tree);
 
 dict_insert_result
 		rb_tree_insert(rb_tree* tree, void* key);
 void**		rb_tree_search(rb_tree* tree, const void* key);
+size_t		rb_tree_search_batch(rb_tree* tree, const void* const* keys, size_t nkeys, void*** results);
 void**		rb_tree_search_le(rb_tree* tree, const void* key);
 void**		rb_tree_search_lt(rb_tree* tree, const void* key);
 void**		rb_tree_search_ge(rb_tree* tree, const void* key);
 void**		rb_tree_search_gt(rb_tree* tree, const void* key);
 dict_remove_result
 		rb_tree_remove(rb_tree* tree, const void* key);
+/* Move |src|'s entries into |tree| in linear time by merging the two sorted
+ * sequences and rebuilding both trees; see dict_merge for the contract.
+ * Returns DICT_MERGE_INCOMPATIBLE unless the trees share a comparison
+ * function and neither uses a node pool. */
+size_t		rb_tree_merge(rb_tree* tree, rb_tree* src);
 size_t		rb_tree_clear(rb_tree* tree, dict_delete_func delete_func);
 size_t		rb_tree_traverse(rb_tree* tree, dict_visit_func visit);
+size_t		rb_tree_traverse_range(rb_tree* tree, const void* lo, const void* hi, dict_visit_func visit);
 size_t		rb_tree_count(const rb_tree* tree);
 size_t		rb_tree_height(const rb_tree* tree);
 size_t		rb_tree_mheight(const rb_tree* tree);
 size_t		rb_tree_pathlen(const rb_tree* tree);
+void		rb_tree_get_stats(rb_tree* tree, dict_stats* stats);
 const void*	rb_tree_min(const rb_tree* tree);
 const void*	rb_tree_max(const rb_tree* tree);
 bool		rb_tree_verify(const rb_tree* tree);
@@ -61,6 +83,7 @@ typedef struct rb_itor rb_itor;
 
 rb_itor*	rb_itor_new(rb_tree* tree);
 dict_itor*	rb_dict_itor_new(rb_tree* tree);
+itor_vtable*	rb_itor_init(rb_tree* tree, rb_itor* itor);
 void		rb_itor_free(rb_itor* tree);
 
 bool		rb_itor_valid(const rb_itor* itor);
@@ -35,9 +35,22 @@ BEGIN_DECL
 typedef struct skiplist skiplist;
 
 skiplist*	skiplist_new(dict_compare_func cmp_func, unsigned max_link);
+/* As skiplist_new, but nodes are carved from one slab pool per link count,
+ * with slabs aligned and sized in cache lines, so the towers walked during a
+ * descent are packed together instead of scattered one malloc apart. Removed
+ * nodes are recycled within the list and only returned to the system by
+ * clear or free. */
+skiplist*	skiplist_new_pooled(dict_compare_func cmp_func, unsigned max_link);
 dict*		skiplist_dict_new(dict_compare_func cmp_func, unsigned max_link);
+dict*		skiplist_dict_new_pooled(dict_compare_func cmp_func, unsigned max_link);
 size_t		skiplist_free(skiplist* list, dict_delete_func delete_func);
 
+/* Seed the generator that draws tower heights. Each list carries its own
+ * generator state, so two lists given the same seed assign the same heights
+ * to the same insertion sequence, which makes replay runs deterministic.
+ * An unseeded list starts from the global generator. */
+void		skiplist_set_seed(skiplist* list, uint64_t seed);
+
 dict_insert_result
 		skiplist_insert(skiplist* list, void* key);
 void**		skiplist_search(skiplist* list, const void* key);
@@ -49,6 +62,7 @@ dict_remove_result
 		skiplist_remove(skiplist* list, const void* key);
 size_t		skiplist_clear(skiplist* list, dict_delete_func delete_func);
 size_t		skiplist_traverse(skiplist* list, dict_visit_func visit);
+size_t		skiplist_traverse_range(skiplist* list, const void* lo, const void* hi, dict_visit_func visit);
 size_t		skiplist_count(const skiplist* list);
 bool		skiplist_verify(const skiplist* list);
 
@@ -59,11 +73,13 @@ bool		skiplist_verify(const skiplist* list);
  * |counts| (i.e. the array was not large enough). */
 size_t		skiplist_link_count_histogram(const skiplist* list,
 					      size_t counts[], size_t ncounts);
+void		skiplist_get_stats(skiplist* list, dict_stats* stats);
 
 typedef struct skiplist_itor skiplist_itor;
 
 skiplist_itor*	skiplist_itor_new(skiplist* list);
 dict_itor*	skiplist_dict_itor_new(skiplist* list);
+itor_vtable*	skiplist_itor_init(skiplist* list, skiplist_itor* itor);
 void		skiplist_itor_free(skiplist_itor* );
 
 bool		skiplist_itor_valid(const skiplist_itor* itor);
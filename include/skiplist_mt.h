@@ -0,0 +1,87 @@
+/*
+ * libdict -- lock-free skiplist interface.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBDICT_SKIPLIST_MT_H__
+#define LIBDICT_SKIPLIST_MT_H__
+
+#include "dict.h"
+
+BEGIN_DECL
+
+/* An ordered dictionary whose insert, search and remove operate without any
+ * locks: per-level next pointers carry a deletion mark in their low bit and
+ * are updated with compare-and-swap, so any number of threads may call these
+ * three operations concurrently and at least one always makes progress.
+ * Removed nodes are unlinked but not freed until clear or free, which - like
+ * traverse and verify - must only run while no other thread is using the
+ * list. The caller's compare function must be thread-safe, and access to a
+ * datum through a returned pointer must be synchronized by the caller. */
+typedef struct skiplist_mt skiplist_mt;
+
+skiplist_mt*	skiplist_mt_new(dict_compare_func cmp_func, unsigned max_link);
+dict*		skiplist_mt_dict_new(dict_compare_func cmp_func, unsigned max_link);
+size_t		skiplist_mt_free(skiplist_mt* list, dict_delete_func delete_func);
+
+dict_insert_result
+		skiplist_mt_insert(skiplist_mt* list, void* key);
+void**		skiplist_mt_search(skiplist_mt* list, const void* key);
+dict_remove_result
+		skiplist_mt_remove(skiplist_mt* list, const void* key);
+size_t		skiplist_mt_clear(skiplist_mt* list, dict_delete_func delete_func);
+size_t		skiplist_mt_traverse(skiplist_mt* list, dict_visit_func visit);
+size_t		skiplist_mt_traverse_range(skiplist_mt* list, const void* lo, const void* hi, dict_visit_func visit);
+size_t		skiplist_mt_count(const skiplist_mt* list);
+void		skiplist_mt_get_stats(skiplist_mt* list, dict_stats* stats);
+bool		skiplist_mt_verify(const skiplist_mt* list);
+
+typedef struct skiplist_mt_itor skiplist_mt_itor;
+
+/* Iterators may run alongside writers: a node an iterator points at stays
+ * allocated until the next clear or free, so key and datum remain readable,
+ * but stepping reflects whatever insertions and removals have happened. */
+skiplist_mt_itor*
+		skiplist_mt_itor_new(skiplist_mt* list);
+dict_itor*	skiplist_mt_dict_itor_new(skiplist_mt* list);
+/* Initialize caller-provided iterator storage; see dict_itor_init. */
+itor_vtable*	skiplist_mt_itor_init(skiplist_mt* list, skiplist_mt_itor* itor);
+void		skiplist_mt_itor_free(skiplist_mt_itor* itor);
+
+bool		skiplist_mt_itor_valid(const skiplist_mt_itor* itor);
+void		skiplist_mt_itor_invalidate(skiplist_mt_itor* itor);
+bool		skiplist_mt_itor_next(skiplist_mt_itor* itor);
+bool		skiplist_mt_itor_prev(skiplist_mt_itor* itor);
+bool		skiplist_mt_itor_nextn(skiplist_mt_itor* itor, size_t count);
+bool		skiplist_mt_itor_prevn(skiplist_mt_itor* itor, size_t count);
+bool		skiplist_mt_itor_first(skiplist_mt_itor* itor);
+bool		skiplist_mt_itor_last(skiplist_mt_itor* itor);
+bool		skiplist_mt_itor_search(skiplist_mt_itor* itor, const void* key);
+const void*	skiplist_mt_itor_key(const skiplist_mt_itor* itor);
+void**		skiplist_mt_itor_datum(skiplist_mt_itor* itor);
+
+END_DECL
+
+#endif /* !LIBDICT_SKIPLIST_MT_H__ */
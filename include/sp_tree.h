@@ -34,9 +34,31 @@ BEGIN_DECL
 
 typedef struct sp_tree sp_tree;
 
+/* How searches restructure the tree. Inserts and removes always splay in
+ * full, since they must write to the tree anyway. */
+typedef enum {
+    SP_SPLAY_ALWAYS,	/* Move every searched node to the root (default). */
+    SP_SPLAY_SEMI,	/* Semi-splay: halve the path depth with about half
+			 * the pointer writes of a full splay. */
+    SP_SPLAY_PERIODIC,	/* Only every |period|-th search splays in full. */
+    SP_SPLAY_NEVER,	/* Searches never write to the tree. */
+} sp_splay_policy;
+
 sp_tree*	sp_tree_new(dict_compare_func cmp_func);
 dict*		sp_dict_new(dict_compare_func cmp_func);
+/* As sp_tree_new, but searches restructure the tree according to |policy|,
+ * trading adaptivity for less write traffic on read-mostly workloads;
+ * |period| is only meaningful for SP_SPLAY_PERIODIC. */
+sp_tree*	sp_tree_new_policy(dict_compare_func cmp_func, sp_splay_policy policy, unsigned period);
+dict*		sp_dict_new_policy(dict_compare_func cmp_func, sp_splay_policy policy, unsigned period);
+/* Build a balanced tree in linear time from |nkeys| distinct keys in
+ * ascending order; |datums|, if not NULL, supplies the initial values. */
+sp_tree*	sp_tree_from_sorted(dict_compare_func cmp_func, void* const* keys, void* const* datums, size_t nkeys);
+dict*		sp_dict_from_sorted(dict_compare_func cmp_func, void* const* keys, void* const* datums, size_t nkeys);
 size_t		sp_tree_free(sp_tree* tree, dict_delete_func delete_func);
+/* Return an independent copy of the tree which shares its keys and data;
+ * see dict_clone. */
+sp_tree*	sp_tree_clone(sp_tree* tree);
 
 dict_insert_result
 		sp_tree_insert(sp_tree* tree, void* key);
@@ -47,6 +69,11 @@ void**		sp_tree_search_ge(sp_tree* tree, const void* key);
 void**		sp_tree_search_gt(sp_tree* tree, const void* key);
 dict_remove_result
 		sp_tree_remove(sp_tree* tree, const void* key);
+/* Move |src|'s entries into |tree| in linear time by merging the two sorted
+ * sequences and rebuilding both trees; see dict_merge for the contract.
+ * Returns DICT_MERGE_INCOMPATIBLE unless the trees share a comparison
+ * function. */
+size_t		sp_tree_merge(sp_tree* tree, sp_tree* src);
 size_t		sp_tree_clear(sp_tree* tree, dict_delete_func delete_func);
 size_t		sp_tree_traverse(sp_tree* tree, dict_visit_func visit);
 size_t		sp_tree_count(const sp_tree* tree);
@@ -61,6 +88,7 @@ typedef struct sp_itor sp_itor;
 
 sp_itor*	sp_itor_new(sp_tree* tree);
 dict_itor*	sp_dict_itor_new(sp_tree* tree);
+itor_vtable*	sp_itor_init(sp_tree* tree, sp_itor* itor);
 void		sp_itor_free(sp_itor* tree);
 
 bool		sp_itor_valid(const sp_itor* itor);
@@ -36,7 +36,15 @@ typedef struct tr_tree tr_tree;
 
 tr_tree*	tr_tree_new(dict_compare_func compare_func, dict_prio_func prio_func);
 dict*		tr_dict_new(dict_compare_func compare_func, dict_prio_func prio_func);
+/* Build a perfectly balanced treap in linear time from |nkeys| distinct keys
+ * in ascending order, raising priorities where needed so the heap property
+ * holds without rotations. |datums|, if not NULL, supplies initial values. */
+tr_tree*	tr_tree_from_sorted(dict_compare_func compare_func, dict_prio_func prio_func, void* const* keys, void* const* datums, size_t nkeys);
+dict*		tr_dict_from_sorted(dict_compare_func compare_func, dict_prio_func prio_func, void* const* keys, void* const* datums, size_t nkeys);
 size_t		tr_tree_free(tr_tree* tree, dict_delete_func delete_func);
+/* Return an independent copy of the tree which shares its keys and data;
+ * see dict_clone. */
+tr_tree*	tr_tree_clone(tr_tree* tree);
 
 dict_insert_result
 		tr_tree_insert(tr_tree* tree, void* key);
@@ -47,6 +55,11 @@ void**		tr_tree_search_ge(tr_tree* tree, const void* key);
 void**		tr_tree_search_gt(tr_tree* tree, const void* key);
 dict_remove_result
 		tr_tree_remove(tr_tree* tree, const void* key);
+/* Meld |src| into |tree| by splitting and joining subtrees around the
+ * existing priorities, reusing src's nodes; see dict_merge for the contract.
+ * Returns DICT_MERGE_INCOMPATIBLE unless the trees share a comparison
+ * function. */
+size_t		tr_tree_merge(tr_tree* tree, tr_tree* src);
 size_t		tr_tree_clear(tr_tree* tree, dict_delete_func delete_func);
 size_t		tr_tree_traverse(tr_tree* tree, dict_visit_func visit);
 size_t		tr_tree_count(const tr_tree* tree);
@@ -61,6 +74,7 @@ typedef struct tr_itor tr_itor;
 
 tr_itor*	tr_itor_new(tr_tree* tree);
 dict_itor*	tr_dict_itor_new(tr_tree* tree);
+itor_vtable*	tr_itor_init(tr_tree* tree, tr_itor* itor);
 void		tr_itor_free(tr_itor* tree);
 
 bool		tr_itor_valid(const tr_itor* itor);
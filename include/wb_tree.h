@@ -36,7 +36,15 @@ typedef struct wb_tree wb_tree;
 
 wb_tree*	wb_tree_new(dict_compare_func cmp_func);
 dict*		wb_dict_new(dict_compare_func cmp_func);
+/* Build a perfectly balanced tree from |nkeys| distinct, ascending keys in
+ * linear time. |datums| may be NULL, or an array of initial values parallel
+ * to |keys|. */
+wb_tree*	wb_tree_from_sorted(dict_compare_func cmp_func, void* const* keys, void* const* datums, size_t nkeys);
+dict*		wb_dict_from_sorted(dict_compare_func cmp_func, void* const* keys, void* const* datums, size_t nkeys);
 size_t		wb_tree_free(wb_tree* tree, dict_delete_func delete_func);
+/* Return an independent copy of the tree which shares its keys and data;
+ * see dict_clone. */
+wb_tree*	wb_tree_clone(wb_tree* tree);
 
 dict_insert_result
 		wb_tree_insert(wb_tree* tree, void* key);
@@ -47,6 +55,11 @@ void**		wb_tree_search_ge(wb_tree* tree, const void* key);
 void**		wb_tree_search_gt(wb_tree* tree, const void* key);
 dict_remove_result
 		wb_tree_remove(wb_tree* tree, const void* key);
+/* Move |src|'s entries into |tree| in linear time by merging the two sorted
+ * sequences and rebuilding both trees; see dict_merge for the contract.
+ * Returns DICT_MERGE_INCOMPATIBLE unless the trees share a comparison
+ * function. */
+size_t		wb_tree_merge(wb_tree* tree, wb_tree* src);
 size_t		wb_tree_clear(wb_tree* tree, dict_delete_func delete_func);
 size_t		wb_tree_traverse(wb_tree* tree, dict_visit_func visit);
 size_t		wb_tree_count(const wb_tree* tree);
@@ -55,12 +68,21 @@ size_t		wb_tree_mheight(const wb_tree* tree);
 size_t		wb_tree_pathlen(const wb_tree* tree);
 const void*	wb_tree_min(const wb_tree* tree);
 const void*	wb_tree_max(const wb_tree* tree);
+/* Store the key and datum with the given 0-based |rank| into |key| and
+ * |datum|, descending through the subtree weights in O(lg n) time. Returns
+ * false if |rank| is not less than the number of keys in the tree. */
+bool		wb_tree_select(const wb_tree* tree, size_t rank, const void** key, void** datum);
+/* Store the 0-based rank of |key| into |rank|, i.e. the number of keys in
+ * the tree which compare less than |key|; also O(lg n). Returns false if
+ * |key| is not present. */
+bool		wb_tree_rank(const wb_tree* tree, const void* key, size_t* rank);
 bool		wb_tree_verify(const wb_tree* tree);
 
 typedef struct wb_itor wb_itor;
 
 wb_itor*	wb_itor_new(wb_tree* tree);
 dict_itor*	wb_dict_itor_new(wb_tree* tree);
+itor_vtable*	wb_itor_init(wb_tree* tree, wb_itor* itor);
 void		wb_itor_free(wb_itor* tree);
 
 bool		wb_itor_valid(const wb_itor* itor);
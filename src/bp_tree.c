@@ -0,0 +1,1038 @@
+/*
+ * libdict -- B+-tree implementation.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * cf. [Bayer and McCreight 1972], [Comer 1979]
+ *
+ * Unlike the binary trees, which touch one cache line per comparison, a
+ * B+-tree node packs many keys into a few consecutive cache lines, so a
+ * search touches only a handful of lines even for large dictionaries, and
+ * ordered iteration walks a linked list of leaves instead of chasing parent
+ * pointers. All key/datum pairs live in the leaves; branches hold only
+ * separator keys, each of which is the smallest key in the subtree to its
+ * right. Splits happen top-down during insertion; removal frees nodes that
+ * become empty but does not otherwise rebalance.
+ */
+
+#include "bp_tree.h"
+
+#include <string.h>	    /* For memmove() */
+#include "dict_private.h"
+
+/* With sixteen pointer-sized keys per node, the key array spans two 64-byte
+ * cache lines, which keeps a whole descent step within a few line fills. */
+#define LEAF_FANOUT	16  /* Maximum key/datum pairs per leaf. */
+#define BRANCH_FANOUT	16  /* Maximum children per branch. */
+
+typedef struct bp_branch bp_branch;
+typedef struct bp_leaf bp_leaf;
+
+/* Header common to both node types; must be their first member. */
+typedef struct {
+    bp_branch*		    parent;
+    unsigned		    count;	/* Keys in a leaf, children in a branch. */
+    bool		    leaf;
+} bp_node;
+
+struct bp_branch {
+    bp_node		    node;
+    void*		    key[BRANCH_FANOUT - 1];
+    bp_node*		    child[BRANCH_FANOUT];
+};
+
+struct bp_leaf {
+    bp_node		    node;
+    bp_leaf*		    next;
+    bp_leaf*		    prev;
+    void*		    key[LEAF_FANOUT];
+    void*		    datum[LEAF_FANOUT];
+};
+
+struct bp_tree {
+    OP_COUNTERS
+    bp_node*		    root;
+    size_t		    count;
+    dict_compare_func	    cmp_func;
+};
+
+struct bp_itor {
+    bp_tree*		    tree;
+    bp_leaf*		    leaf;	/* NULL if invalid. */
+    unsigned		    index;
+};
+
+static dict_vtable bp_tree_vtable = {
+    (dict_inew_func)	    bp_dict_itor_new,
+    (dict_dfree_func)	    bp_tree_free,
+    (dict_insert_func)	    bp_tree_insert,
+    (dict_search_func)	    bp_tree_search,
+    (dict_search_func)	    bp_tree_search_le,
+    (dict_search_func)	    bp_tree_search_lt,
+    (dict_search_func)	    bp_tree_search_ge,
+    (dict_search_func)	    bp_tree_search_gt,
+    (dict_remove_func)	    bp_tree_remove,
+    (dict_clear_func)	    bp_tree_clear,
+    (dict_clear_parallel_func) NULL,/* clear_parallel: not implemented */
+    (dict_traverse_func)    bp_tree_traverse,
+    (dict_count_func)	    bp_tree_count,
+    (dict_verify_func)	    bp_tree_verify,
+    (dict_search_batch_func) NULL,/* search_batch: generic fallback */
+    (dict_traverse_range_func) bp_tree_traverse_range,
+    (dict_iinit_func)	    bp_itor_init,
+    (dict_get_stats_func)   bp_tree_get_stats,
+    (dict_clone_func)	    NULL,/* TODO: implement clone */
+    (dict_merge_func)	    NULL,/* merge: generic fallback */
+};
+
+static itor_vtable bp_tree_itor_vtable = {
+    (dict_ifree_func)	    bp_itor_free,
+    (dict_valid_func)	    bp_itor_valid,
+    (dict_invalidate_func)  bp_itor_invalidate,
+    (dict_next_func)	    bp_itor_next,
+    (dict_prev_func)	    bp_itor_prev,
+    (dict_nextn_func)	    bp_itor_nextn,
+    (dict_prevn_func)	    bp_itor_prevn,
+    (dict_first_func)	    bp_itor_first,
+    (dict_last_func)	    bp_itor_last,
+    (dict_key_func)	    bp_itor_key,
+    (dict_datum_func)	    bp_itor_datum,
+    (dict_isearch_func)	    bp_itor_search,
+    (dict_isearch_func)	    bp_itor_search_le,
+    (dict_isearch_func)	    bp_itor_search_lt,
+    (dict_isearch_func)	    bp_itor_search_ge,
+    (dict_isearch_func)	    bp_itor_search_gt,
+    (dict_iremove_func)	    NULL,/* bp_itor_remove not implemented yet */
+    (dict_icompare_func)    NULL,/* bp_itor_compare not implemented yet */
+};
+
+static bp_leaf*	leaf_new(void);
+static bp_branch* branch_new(void);
+static bp_leaf*	min_leaf(bp_node* node);
+static bp_leaf*	max_leaf(bp_node* node);
+static bp_leaf*	descend(const bp_tree* tree, const void* key);
+static bool	leaf_find(const bp_tree* tree, const bp_leaf* leaf, const void* key, unsigned* position);
+static unsigned	branch_index(const bp_branch* branch, const bp_node* child);
+static bool	split_child(bp_branch* parent, unsigned index);
+static void	refresh_separator(bp_node* node);
+
+bp_tree*
+bp_tree_new(dict_compare_func cmp_func)
+{
+    ASSERT(cmp_func != NULL);
+
+    bp_tree* tree = MALLOC(sizeof(*tree));
+    if (tree) {
+	tree->root = NULL;
+	tree->count = 0;
+	tree->cmp_func = cmp_func;
+	STATS_RESET(tree);
+    }
+    return tree;
+}
+
+dict*
+bp_dict_new(dict_compare_func cmp_func)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = bp_tree_new(cmp_func))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &bp_tree_vtable;
+    }
+    return dct;
+}
+
+size_t
+bp_tree_free(bp_tree* tree, dict_delete_func delete_func)
+{
+    ASSERT(tree != NULL);
+
+    const size_t count = bp_tree_clear(tree, delete_func);
+    FREE(tree);
+    return count;
+}
+
+static bp_leaf*
+leaf_new(void)
+{
+    bp_leaf* leaf = MALLOC(sizeof(*leaf));
+    if (leaf) {
+	leaf->node.parent = NULL;
+	leaf->node.count = 0;
+	leaf->node.leaf = true;
+	leaf->next = NULL;
+	leaf->prev = NULL;
+    }
+    return leaf;
+}
+
+static bp_branch*
+branch_new(void)
+{
+    bp_branch* branch = MALLOC(sizeof(*branch));
+    if (branch) {
+	branch->node.parent = NULL;
+	branch->node.count = 0;
+	branch->node.leaf = false;
+    }
+    return branch;
+}
+
+static bp_leaf*
+min_leaf(bp_node* node)
+{
+    while (!node->leaf)
+	node = ((bp_branch*)node)->child[0];
+    return (bp_leaf*)node;
+}
+
+static bp_leaf*
+max_leaf(bp_node* node)
+{
+    while (!node->leaf) {
+	bp_branch* branch = (bp_branch*)node;
+	node = branch->child[branch->node.count - 1];
+    }
+    return (bp_leaf*)node;
+}
+
+/* Return the leaf whose key range covers |key|. */
+static bp_leaf*
+descend(const bp_tree* tree, const void* key)
+{
+    bp_node* node = tree->root;
+    while (!node->leaf) {
+	bp_branch* branch = (bp_branch*)node;
+	unsigned index = 0;
+	while (index < branch->node.count - 1 &&
+	       dict_cmp(tree->cmp_func, key, branch->key[index]) >= 0)
+	    ++index;
+	node = branch->child[index];
+    }
+    return (bp_leaf*)node;
+}
+
+/* Set |*position| to the index of the first key in |leaf| not less than
+ * |key|, and return true if it is equal to |key|. */
+static bool
+leaf_find(const bp_tree* tree, const bp_leaf* leaf, const void* key, unsigned* position)
+{
+    unsigned index = 0;
+    while (index < leaf->node.count) {
+	const int cmp = dict_cmp(tree->cmp_func, key, leaf->key[index]);
+	if (cmp < 0)
+	    break;
+	if (cmp == 0) {
+	    *position = index;
+	    return true;
+	}
+	++index;
+    }
+    *position = index;
+    return false;
+}
+
+static unsigned
+branch_index(const bp_branch* branch, const bp_node* child)
+{
+    unsigned index = 0;
+    while (branch->child[index] != child) {
+	++index;
+	ASSERT(index < branch->node.count);
+    }
+    return index;
+}
+
+static bool
+node_full(const bp_node* node)
+{
+    return node->count == (node->leaf ? LEAF_FANOUT : BRANCH_FANOUT);
+}
+
+/* Insert |child| into the non-full |branch| at position |index|+1, with the
+ * separator |sep| at position |index|. */
+static void
+branch_put(bp_branch* branch, unsigned index, void* sep, bp_node* child)
+{
+    const unsigned nkeys = branch->node.count - 1;
+    memmove(branch->key + index + 1, branch->key + index,
+	    (nkeys - index) * sizeof(branch->key[0]));
+    memmove(branch->child + index + 2, branch->child + index + 1,
+	    (nkeys - index) * sizeof(branch->child[0]));
+    branch->key[index] = sep;
+    branch->child[index + 1] = child;
+    branch->node.count++;
+    child->parent = branch;
+}
+
+/* Split the full child at |index| of the non-full |parent| into two nodes
+ * and insert the separator between them into |parent|. */
+static bool
+split_child(bp_branch* parent, unsigned index)
+{
+    bp_node* left = parent->child[index];
+    void* sep;
+    bp_node* right;
+    ASSERT(node_full(left));
+    if (left->leaf) {
+	bp_leaf* l = (bp_leaf*)left;
+	bp_leaf* r = leaf_new();
+	if (!r)
+	    return false;
+	const unsigned keep = LEAF_FANOUT / 2;
+	const unsigned move = LEAF_FANOUT - keep;
+	memcpy(r->key, l->key + keep, move * sizeof(l->key[0]));
+	memcpy(r->datum, l->datum + keep, move * sizeof(l->datum[0]));
+	l->node.count = keep;
+	r->node.count = move;
+	r->next = l->next;
+	r->prev = l;
+	if (l->next)
+	    l->next->prev = r;
+	l->next = r;
+	sep = r->key[0];
+	right = (bp_node*)r;
+    } else {
+	bp_branch* l = (bp_branch*)left;
+	bp_branch* r = branch_new();
+	if (!r)
+	    return false;
+	const unsigned keep = BRANCH_FANOUT / 2;
+	const unsigned move = BRANCH_FANOUT - keep;
+	sep = l->key[keep - 1];
+	memcpy(r->key, l->key + keep, (move - 1) * sizeof(l->key[0]));
+	memcpy(r->child, l->child + keep, move * sizeof(l->child[0]));
+	l->node.count = keep;
+	r->node.count = move;
+	for (unsigned i = 0; i < move; ++i)
+	    r->child[i]->parent = r;
+	right = (bp_node*)r;
+    }
+    branch_put(parent, index, sep, right);
+    return true;
+}
+
+dict_insert_result
+bp_tree_insert(bp_tree* tree, void* key)
+{
+    ASSERT(tree != NULL);
+    STATS_INC(tree, insert_count);
+
+    if (!tree->root) {
+	bp_leaf* leaf = leaf_new();
+	if (!leaf)
+	    return (dict_insert_result) { NULL, false };
+	leaf->key[0] = key;
+	leaf->datum[0] = NULL;
+	leaf->node.count = 1;
+	tree->root = (bp_node*)leaf;
+	tree->count = 1;
+	return (dict_insert_result) { &leaf->datum[0], true };
+    }
+    if (node_full(tree->root)) {
+	bp_node* old_root = tree->root;
+	bp_branch* branch = branch_new();
+	if (!branch)
+	    return (dict_insert_result) { NULL, false };
+	branch->node.count = 1;
+	branch->child[0] = old_root;
+	old_root->parent = branch;
+	if (!split_child(branch, 0)) {
+	    old_root->parent = NULL;
+	    FREE(branch);
+	    return (dict_insert_result) { NULL, false };
+	}
+	tree->root = (bp_node*)branch;
+    }
+    /* Split any full node before descending into it, so that a leaf split
+     * never needs to propagate back up the tree. */
+    bp_node* node = tree->root;
+    while (!node->leaf) {
+	bp_branch* branch = (bp_branch*)node;
+	unsigned index = 0;
+	while (index < branch->node.count - 1 &&
+	       dict_cmp(tree->cmp_func, key, branch->key[index]) >= 0)
+	    ++index;
+	if (node_full(branch->child[index])) {
+	    if (!split_child(branch, index))
+		return (dict_insert_result) { NULL, false };
+	    if (dict_cmp(tree->cmp_func, key, branch->key[index]) >= 0)
+		++index;
+	}
+	node = branch->child[index];
+    }
+    bp_leaf* leaf = (bp_leaf*)node;
+    unsigned position;
+    if (leaf_find(tree, leaf, key, &position))
+	return (dict_insert_result) { &leaf->datum[position], false };
+    memmove(leaf->key + position + 1, leaf->key + position,
+	    (leaf->node.count - position) * sizeof(leaf->key[0]));
+    memmove(leaf->datum + position + 1, leaf->datum + position,
+	    (leaf->node.count - position) * sizeof(leaf->datum[0]));
+    leaf->key[position] = key;
+    leaf->datum[position] = NULL;
+    leaf->node.count++;
+    tree->count++;
+    return (dict_insert_result) { &leaf->datum[position], true };
+}
+
+void**
+bp_tree_search(bp_tree* tree, const void* key)
+{
+    ASSERT(tree != NULL);
+    STATS_INC(tree, search_count);
+
+    if (!tree->root)
+	return NULL;
+    bp_leaf* leaf = descend(tree, key);
+    unsigned position;
+    if (leaf_find(tree, leaf, key, &position))
+	return &leaf->datum[position];
+    return NULL;
+}
+
+/* Locate the smallest key not less than |key|. */
+static bool
+locate_ge(bp_tree* tree, const void* key, bp_leaf** leaf_out, unsigned* index_out)
+{
+    if (!tree->root)
+	return false;
+    bp_leaf* leaf = descend(tree, key);
+    unsigned index;
+    leaf_find(tree, leaf, key, &index);
+    if (index == leaf->node.count) {
+	if (!(leaf = leaf->next))
+	    return false;
+	index = 0;
+    }
+    *leaf_out = leaf;
+    *index_out = index;
+    return true;
+}
+
+/* Locate the smallest key strictly greater than |key|. */
+static bool
+locate_gt(bp_tree* tree, const void* key, bp_leaf** leaf_out, unsigned* index_out)
+{
+    if (!tree->root)
+	return false;
+    bp_leaf* leaf = descend(tree, key);
+    unsigned index;
+    if (leaf_find(tree, leaf, key, &index))
+	++index;
+    if (index >= leaf->node.count) {
+	if (!(leaf = leaf->next))
+	    return false;
+	index = 0;
+    }
+    *leaf_out = leaf;
+    *index_out = index;
+    return true;
+}
+
+/* Locate the largest key not greater than |key|. */
+static bool
+locate_le(bp_tree* tree, const void* key, bp_leaf** leaf_out, unsigned* index_out)
+{
+    if (!tree->root)
+	return false;
+    bp_leaf* leaf = descend(tree, key);
+    unsigned index;
+    if (!leaf_find(tree, leaf, key, &index)) {
+	if (index == 0) {
+	    if (!(leaf = leaf->prev))
+		return false;
+	    index = leaf->node.count - 1;
+	} else {
+	    --index;
+	}
+    }
+    *leaf_out = leaf;
+    *index_out = index;
+    return true;
+}
+
+/* Locate the largest key strictly less than |key|. */
+static bool
+locate_lt(bp_tree* tree, const void* key, bp_leaf** leaf_out, unsigned* index_out)
+{
+    if (!tree->root)
+	return false;
+    bp_leaf* leaf = descend(tree, key);
+    unsigned index;
+    leaf_find(tree, leaf, key, &index);
+    if (index == 0) {
+	if (!(leaf = leaf->prev))
+	    return false;
+	index = leaf->node.count - 1;
+    } else {
+	--index;
+    }
+    *leaf_out = leaf;
+    *index_out = index;
+    return true;
+}
+
+void**
+bp_tree_search_le(bp_tree* tree, const void* key)
+{
+    ASSERT(tree != NULL);
+
+    bp_leaf* leaf;
+    unsigned index;
+    return locate_le(tree, key, &leaf, &index) ? &leaf->datum[index] : NULL;
+}
+
+void**
+bp_tree_search_lt(bp_tree* tree, const void* key)
+{
+    ASSERT(tree != NULL);
+
+    bp_leaf* leaf;
+    unsigned index;
+    return locate_lt(tree, key, &leaf, &index) ? &leaf->datum[index] : NULL;
+}
+
+void**
+bp_tree_search_ge(bp_tree* tree, const void* key)
+{
+    ASSERT(tree != NULL);
+
+    bp_leaf* leaf;
+    unsigned index;
+    return locate_ge(tree, key, &leaf, &index) ? &leaf->datum[index] : NULL;
+}
+
+void**
+bp_tree_search_gt(bp_tree* tree, const void* key)
+{
+    ASSERT(tree != NULL);
+
+    bp_leaf* leaf;
+    unsigned index;
+    return locate_gt(tree, key, &leaf, &index) ? &leaf->datum[index] : NULL;
+}
+
+/* The smallest key in |node|'s subtree changed; update the separator
+ * guarding that subtree, if there is one. */
+static void
+refresh_separator(bp_node* node)
+{
+    bp_branch* parent = node->parent;
+    while (parent) {
+	const unsigned index = branch_index(parent, node);
+	if (index > 0) {
+	    parent->key[index - 1] = min_leaf(node)->key[0];
+	    return;
+	}
+	node = (bp_node*)parent;
+	parent = parent->node.parent;
+    }
+}
+
+dict_remove_result
+bp_tree_remove(bp_tree* tree, const void* key)
+{
+    ASSERT(tree != NULL);
+    STATS_INC(tree, remove_count);
+
+    if (!tree->root)
+	return (dict_remove_result) { NULL, NULL, false };
+    bp_leaf* leaf = descend(tree, key);
+    unsigned position;
+    if (!leaf_find(tree, leaf, key, &position))
+	return (dict_remove_result) { NULL, NULL, false };
+    dict_remove_result result = { leaf->key[position], leaf->datum[position], true };
+    memmove(leaf->key + position, leaf->key + position + 1,
+	    (leaf->node.count - position - 1) * sizeof(leaf->key[0]));
+    memmove(leaf->datum + position, leaf->datum + position + 1,
+	    (leaf->node.count - position - 1) * sizeof(leaf->datum[0]));
+    leaf->node.count--;
+    tree->count--;
+    if (leaf->node.count > 0) {
+	if (position == 0)
+	    refresh_separator((bp_node*)leaf);
+    } else {
+	if (leaf->prev)
+	    leaf->prev->next = leaf->next;
+	if (leaf->next)
+	    leaf->next->prev = leaf->prev;
+	/* Remove the empty node from its parent, repeating as long as the
+	 * parent becomes empty in turn. */
+	bp_node* node = (bp_node*)leaf;
+	for (;;) {
+	    bp_branch* parent = node->parent;
+	    if (!parent) {
+		FREE(node);
+		tree->root = NULL;
+		break;
+	    }
+	    const unsigned index = branch_index(parent, node);
+	    FREE(node);
+	    const unsigned nkeys = parent->node.count - 1;
+	    if (index > 0) {
+		memmove(parent->key + index - 1, parent->key + index,
+			(nkeys - index) * sizeof(parent->key[0]));
+	    } else if (nkeys > 0) {
+		memmove(parent->key, parent->key + 1,
+			(nkeys - 1) * sizeof(parent->key[0]));
+	    }
+	    memmove(parent->child + index, parent->child + index + 1,
+		    (parent->node.count - index - 1) * sizeof(parent->child[0]));
+	    parent->node.count--;
+	    if (parent->node.count == 0) {
+		node = (bp_node*)parent;
+		continue;
+	    }
+	    if (index == 0)
+		refresh_separator((bp_node*)parent);
+	    break;
+	}
+	while (tree->root && !tree->root->leaf && tree->root->count == 1) {
+	    bp_branch* branch = (bp_branch*)tree->root;
+	    tree->root = branch->child[0];
+	    tree->root->parent = NULL;
+	    FREE(branch);
+	}
+    }
+    return result;
+}
+
+static void
+clear_subtree(bp_node* node, dict_delete_func delete_func)
+{
+    if (node->leaf) {
+	bp_leaf* leaf = (bp_leaf*)node;
+	if (delete_func)
+	    for (unsigned i = 0; i < leaf->node.count; ++i)
+		delete_func(leaf->key[i], leaf->datum[i]);
+    } else {
+	bp_branch* branch = (bp_branch*)node;
+	for (unsigned i = 0; i < branch->node.count; ++i)
+	    clear_subtree(branch->child[i], delete_func);
+    }
+    FREE(node);
+}
+
+size_t
+bp_tree_clear(bp_tree* tree, dict_delete_func delete_func)
+{
+    ASSERT(tree != NULL);
+
+    const size_t count = tree->count;
+    if (tree->root) {
+	clear_subtree(tree->root, delete_func);
+	tree->root = NULL;
+	tree->count = 0;
+    }
+    return count;
+}
+
+size_t
+bp_tree_traverse(bp_tree* tree, dict_visit_func visit)
+{
+    ASSERT(tree != NULL);
+    ASSERT(visit != NULL);
+
+    if (!tree->root)
+	return 0;
+    size_t count = 0;
+    for (bp_leaf* leaf = min_leaf(tree->root); leaf; leaf = leaf->next)
+	for (unsigned i = 0; i < leaf->node.count; ++i) {
+	    ++count;
+	    if (!visit(leaf->key[i], leaf->datum[i]))
+		return count;
+	}
+    return count;
+}
+
+size_t
+bp_tree_traverse_range(bp_tree* tree, const void* lo, const void* hi,
+		       dict_visit_func visit)
+{
+    ASSERT(tree != NULL);
+    ASSERT(visit != NULL);
+
+    if (!tree->root)
+	return 0;
+    bp_leaf* leaf;
+    unsigned index;
+    if (lo) {
+	if (!locate_ge(tree, lo, &leaf, &index))
+	    return 0;
+    } else {
+	leaf = min_leaf(tree->root);
+	index = 0;
+    }
+    size_t count = 0;
+    for (; leaf; leaf = leaf->next, index = 0)
+	for (; index < leaf->node.count; ++index) {
+	    if (hi && dict_cmp(tree->cmp_func, hi, leaf->key[index]) < 0)
+		return count;
+	    ++count;
+	    if (!visit(leaf->key[index], leaf->datum[index]))
+		return count;
+	}
+    return count;
+}
+
+size_t
+bp_tree_count(const bp_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    return tree->count;
+}
+
+void
+bp_tree_get_stats(bp_tree* tree, dict_stats* stats)
+{
+    ASSERT(tree != NULL);
+    ASSERT(stats != NULL);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = tree->count;
+    /* Every leaf sits at the same depth. */
+    size_t depth = 0;
+    for (const bp_node* node = tree->root; node;
+	 node = node->leaf ? NULL : ((const bp_branch*)node)->child[0])
+	depth++;
+    stats->min_leaf_depth = depth;
+    stats->max_leaf_depth = depth;
+    STATS_EXPORT(tree, stats);
+}
+
+const void*
+bp_tree_min(const bp_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    return tree->root ? min_leaf(tree->root)->key[0] : NULL;
+}
+
+const void*
+bp_tree_max(const bp_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    if (!tree->root)
+	return NULL;
+    const bp_leaf* leaf = max_leaf(tree->root);
+    return leaf->key[leaf->node.count - 1];
+}
+
+static bool
+node_verify(const bp_tree* tree, const bp_node* node, const bp_branch* parent,
+	    unsigned depth, unsigned* leaf_depth)
+{
+    VERIFY(node->parent == parent);
+    VERIFY(node->count >= 1);
+    if (node->leaf) {
+	const bp_leaf* leaf = (const bp_leaf*)node;
+	VERIFY(node->count <= LEAF_FANOUT);
+	for (unsigned i = 1; i < node->count; ++i)
+	    VERIFY(dict_cmp(tree->cmp_func, leaf->key[i - 1], leaf->key[i]) < 0);
+	if (*leaf_depth == 0)
+	    *leaf_depth = depth;
+	else
+	    VERIFY(*leaf_depth == depth);
+    } else {
+	const bp_branch* branch = (const bp_branch*)node;
+	if (node == tree->root)
+	    VERIFY(node->count >= 2);
+	VERIFY(node->count <= BRANCH_FANOUT);
+	for (unsigned i = 1; i < node->count; ++i) {
+	    VERIFY(branch->key[i - 1] == min_leaf(branch->child[i])->key[0]);
+	    if (i > 1)
+		VERIFY(dict_cmp(tree->cmp_func, branch->key[i - 2], branch->key[i - 1]) < 0);
+	}
+	for (unsigned i = 0; i < node->count; ++i)
+	    if (!node_verify(tree, branch->child[i], branch, depth + 1, leaf_depth))
+		return false;
+    }
+    return true;
+}
+
+bool
+bp_tree_verify(const bp_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    if (!tree->root) {
+	VERIFY(tree->count == 0);
+	return true;
+    }
+    VERIFY(tree->root->parent == NULL);
+    unsigned leaf_depth = 0;
+    if (!node_verify(tree, tree->root, NULL, 1, &leaf_depth))
+	return false;
+    /* The leaf chain must contain every key, in ascending order. */
+    size_t count = 0;
+    const bp_leaf* prev = NULL;
+    for (const bp_leaf* leaf = min_leaf(tree->root); leaf; leaf = leaf->next) {
+	VERIFY(leaf->prev == prev);
+	if (prev)
+	    VERIFY(dict_cmp(tree->cmp_func, prev->key[prev->node.count - 1], leaf->key[0]) < 0);
+	count += leaf->node.count;
+	prev = leaf;
+    }
+    VERIFY(prev == max_leaf(tree->root));
+    VERIFY(count == tree->count);
+    return true;
+}
+
+#define VALID(itor) ((itor)->leaf != NULL)
+
+bp_itor*
+bp_itor_new(bp_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    bp_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	itor->tree = tree;
+	itor->leaf = NULL;
+	itor->index = 0;
+    }
+    return itor;
+}
+
+itor_vtable*
+bp_itor_init(bp_tree* tree, bp_itor* itor)
+{
+    ASSERT(tree != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(bp_itor) <= DICT_ITOR_STATE_MAX,
+		   "bp_itor must fit in dict_itor_storage");
+
+    itor->tree = tree;
+    itor->leaf = NULL;
+    itor->index = 0;
+    return &bp_tree_itor_vtable;
+}
+
+dict_itor*
+bp_dict_itor_new(bp_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    dict_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	if (!(itor->_itor = bp_itor_new(tree))) {
+	    FREE(itor);
+	    return NULL;
+	}
+	itor->_vtable = &bp_tree_itor_vtable;
+    }
+    return itor;
+}
+
+void
+bp_itor_free(bp_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    FREE(itor);
+}
+
+bool
+bp_itor_valid(const bp_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return VALID(itor);
+}
+
+void
+bp_itor_invalidate(bp_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    itor->leaf = NULL;
+    itor->index = 0;
+}
+
+bool
+bp_itor_next(bp_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (!itor->leaf)
+	return bp_itor_first(itor);
+    if (++itor->index >= itor->leaf->node.count) {
+	itor->leaf = itor->leaf->next;
+	itor->index = 0;
+    } else if (itor->index + 1 >= itor->leaf->node.count) {
+	/* About to leave this leaf: warm its successor. */
+	PREFETCH(itor->leaf->next);
+    }
+    return VALID(itor);
+}
+
+bool
+bp_itor_prev(bp_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (!itor->leaf)
+	return bp_itor_last(itor);
+    if (itor->index > 0) {
+	--itor->index;
+	return true;
+    }
+    if ((itor->leaf = itor->leaf->prev) != NULL)
+	itor->index = itor->leaf->node.count - 1;
+    return VALID(itor);
+}
+
+bool
+bp_itor_nextn(bp_itor* itor, size_t count)
+{
+    ASSERT(itor != NULL);
+
+    while (count--)
+	if (!bp_itor_next(itor))
+	    return false;
+    return VALID(itor);
+}
+
+bool
+bp_itor_prevn(bp_itor* itor, size_t count)
+{
+    ASSERT(itor != NULL);
+
+    while (count--)
+	if (!bp_itor_prev(itor))
+	    return false;
+    return VALID(itor);
+}
+
+bool
+bp_itor_first(bp_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    itor->leaf = itor->tree->root ? min_leaf(itor->tree->root) : NULL;
+    itor->index = 0;
+    return VALID(itor);
+}
+
+bool
+bp_itor_last(bp_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (!itor->tree->root) {
+	itor->leaf = NULL;
+	itor->index = 0;
+	return false;
+    }
+    itor->leaf = max_leaf(itor->tree->root);
+    itor->index = itor->leaf->node.count - 1;
+    return true;
+}
+
+bool
+bp_itor_search(bp_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    if (itor->tree->root) {
+	bp_leaf* leaf = descend(itor->tree, key);
+	unsigned position;
+	if (leaf_find(itor->tree, leaf, key, &position)) {
+	    itor->leaf = leaf;
+	    itor->index = position;
+	    return true;
+	}
+    }
+    itor->leaf = NULL;
+    itor->index = 0;
+    return false;
+}
+
+bool
+bp_itor_search_le(bp_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    if (locate_le(itor->tree, key, &itor->leaf, &itor->index))
+	return true;
+    bp_itor_invalidate(itor);
+    return false;
+}
+
+bool
+bp_itor_search_lt(bp_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    if (locate_lt(itor->tree, key, &itor->leaf, &itor->index))
+	return true;
+    bp_itor_invalidate(itor);
+    return false;
+}
+
+bool
+bp_itor_search_ge(bp_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    if (locate_ge(itor->tree, key, &itor->leaf, &itor->index))
+	return true;
+    bp_itor_invalidate(itor);
+    return false;
+}
+
+bool
+bp_itor_search_gt(bp_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    if (locate_gt(itor->tree, key, &itor->leaf, &itor->index))
+	return true;
+    bp_itor_invalidate(itor);
+    return false;
+}
+
+const void*
+bp_itor_key(const bp_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return itor->leaf ? itor->leaf->key[itor->index] : NULL;
+}
+
+void**
+bp_itor_datum(bp_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return itor->leaf ? &itor->leaf->datum[itor->index] : NULL;
+}
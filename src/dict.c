@@ -27,6 +27,8 @@
 
 #include "dict_private.h"
 
+#include <string.h>	    /* For memcpy() */
+
 #define XSTRINGIFY(x)	STRINGIFY(x)
 #define STRINGIFY(x)	#x
 
@@ -75,12 +77,81 @@ dict_ptr_cmp(const void* k1, const void* k2)
     return (k1 > k2) - (k1 < k2);
 }
 
-int
+/* The string routines below scan a word at a time, in the style of the C
+ * library's own string functions: an aligned eight-byte load never crosses a
+ * page boundary, so it may safely read up to seven bytes past a terminator.
+ * Unaligned loads are only ever issued for byte ranges known to lie within
+ * the string. */
+#define WORD_ONES	UINT64_C(0x0101010101010101)
+#define WORD_HIGHS	UINT64_C(0x8080808080808080)
+
+/* AddressSanitizer checks loads with byte granularity and so rejects the
+ * (harmless) tail of an aligned word load; exempt the scanning routines. */
+#if defined(__SANITIZE_ADDRESS__)
+# define NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#elif defined(__has_feature)
+# if __has_feature(address_sanitizer)
+#  define NO_SANITIZE_ADDRESS __attribute__((no_sanitize("address")))
+# endif
+#endif
+#ifndef NO_SANITIZE_ADDRESS
+# define NO_SANITIZE_ADDRESS
+#endif
+
+static inline NO_SANITIZE_ADDRESS uint64_t
+load_word(const void* ptr)
+{
+    uint64_t word;
+    memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+static inline bool
+word_has_nul(uint64_t word)
+{
+    return ((word - WORD_ONES) & ~word & WORD_HIGHS) != 0;
+}
+
+static inline NO_SANITIZE_ADDRESS size_t
+str_length(const char* str)
+{
+    const char* p = str;
+    while ((uintptr_t)p & (sizeof(uint64_t) - 1)) {
+	if (!*p)
+	    return (size_t)(p - str);
+	++p;
+    }
+    while (!word_has_nul(load_word(p)))
+	p += sizeof(uint64_t);
+    while (*p)
+	++p;
+    return (size_t)(p - str);
+}
+
+NO_SANITIZE_ADDRESS int
 dict_str_cmp(const void* k1, const void* k2)
 {
     const char* a = k1;
     const char* b = k2;
 
+    /* When the strings are mutually aligned, skim over equal prefixes eight
+     * bytes per load; the first differing or terminating word, and the
+     * mixed-alignment case, are handled by the byte loop. */
+    if ((((uintptr_t)a ^ (uintptr_t)b) & (sizeof(uint64_t) - 1)) == 0) {
+	while ((uintptr_t)a & (sizeof(uint64_t) - 1)) {
+	    char p = *a, q = *b;
+	    if (!p || p != q)
+		return (p > q) - (p < q);
+	    ++a, ++b;
+	}
+	for (;;) {
+	    const uint64_t word = load_word(a);
+	    if (word != load_word(b) || word_has_nul(word))
+		break;
+	    a += sizeof(uint64_t);
+	    b += sizeof(uint64_t);
+	}
+    }
     for (;;) {
 	char p = *a++, q = *b++;
 	if (!p || p != q)
@@ -88,14 +159,39 @@ dict_str_cmp(const void* k1, const void* k2)
     }
 }
 
-unsigned
+uint64_t
 dict_str_hash(const void* k)
 {
-    /* FNV 1-a string hash. */
-    unsigned hash = 2166136261U;
-    for (const uint8_t* ptr = k; *ptr;) {
-	hash = (hash ^ *ptr++) * 16777619U;
+    /* Finding the length first costs a second pass, but both passes move a
+     * word at a time and the first has usually pulled the string into L1. */
+    return dict_str_hash_len(k, str_length(k));
+}
+
+uint64_t
+dict_str_hash_len(const void* str, size_t len)
+{
+    /* 64-bit FNV 1-a over eight-byte chunks rather than single bytes, seeded
+     * with the length so that keys differing only in the zero padding of the
+     * final chunk cannot collide, and followed by a murmur-style finalizer so
+     * that the low-order bits used for bucket selection are as well mixed as
+     * the rest. */
+    const char* ptr = str;
+    uint64_t hash = 14695981039346656037ULL ^ (len * 1099511628211ULL);
+    while (len >= sizeof(uint64_t)) {
+	hash = (hash ^ load_word(ptr)) * 1099511628211ULL;
+	ptr += sizeof(uint64_t);
+	len -= sizeof(uint64_t);
+    }
+    if (len) {
+	uint64_t word = 0;
+	memcpy(&word, ptr, len);
+	hash = (hash ^ word) * 1099511628211ULL;
     }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
     return hash;
 }
 
@@ -109,6 +205,131 @@ dict_free(dict* dct, dict_delete_func delete_func)
     return count;
 }
 
+dict*
+dict_clone(dict* dct)
+{
+    ASSERT(dct != NULL);
+
+    if (!dct->_vtable->clone)
+	return NULL;
+    void* object = dct->_vtable->clone(dct->_object);
+    if (!object)
+	return NULL;
+    dict* clone = MALLOC(sizeof(*clone));
+    if (!clone) {
+	dct->_vtable->dfree(object, NULL);
+	return NULL;
+    }
+    clone->_object = object;
+    clone->_vtable = dct->_vtable;
+    return clone;
+}
+
+size_t
+dict_itor_next_batch(dict_itor* itor, const void** keys, void*** datums, size_t n)
+{
+    ASSERT(itor != NULL);
+
+    const itor_vtable* vtable = itor->_vtable;
+    void* state = itor->_itor;
+    size_t read = 0;
+    while (read < n && vtable->valid(state)) {
+	if (keys)
+	    keys[read] = vtable->key(state);
+	if (datums)
+	    datums[read] = vtable->datum(state);
+	++read;
+	vtable->next(state);
+    }
+    return read;
+}
+
+size_t
+dict_merge(dict* dst, dict* src)
+{
+    ASSERT(dst != NULL);
+    ASSERT(src != NULL);
+    ASSERT(dst != src);
+
+    if (dst->_vtable == src->_vtable && dst->_vtable->merge) {
+	const size_t moved = dst->_vtable->merge(dst->_object, src->_object);
+	if (moved != DICT_MERGE_INCOMPATIBLE)
+	    return moved;
+    }
+    /* Generic fallback: snapshot src's entries, then reinsert each into dst
+     * and remove the moved ones from src. The key array is needed because
+     * removing from src while iterating it would invalidate the iterator. */
+    const size_t src_count = dict_count(src);
+    if (src_count == 0)
+	return 0;
+    void** pairs = MALLOC(src_count * 2 * sizeof(void*));
+    if (!pairs)
+	return 0;
+    dict_itor* itor = dict_itor_new(src);
+    if (!itor) {
+	FREE(pairs);
+	return 0;
+    }
+    size_t n = 0;
+    for (dict_itor_first(itor); dict_itor_valid(itor); dict_itor_next(itor)) {
+	pairs[n * 2] = (void*)dict_itor_key(itor);
+	pairs[n * 2 + 1] = *dict_itor_datum(itor);
+	++n;
+    }
+    dict_itor_free(itor);
+    size_t moved = 0;
+    for (size_t i = 0; i < n; ++i) {
+	dict_insert_result result = dict_insert(dst, pairs[i * 2]);
+	if (result.inserted) {
+	    *result.datum_ptr = pairs[i * 2 + 1];
+	    dict_remove(src, pairs[i * 2]);
+	    ++moved;
+	}
+    }
+    FREE(pairs);
+    return moved;
+}
+
+size_t
+dict_clear_parallel(dict* dct, dict_delete_func delete_func, unsigned nthreads)
+{
+    ASSERT(dct != NULL);
+
+    if (nthreads > 1 && dct->_vtable->clear_parallel)
+	return dct->_vtable->clear_parallel(dct->_object, delete_func, nthreads);
+    return dct->_vtable->clear(dct->_object, delete_func);
+}
+
+size_t
+dict_search_batch(dict* dct, const void* const* keys, size_t nkeys, void*** results)
+{
+    ASSERT(dct != NULL);
+    ASSERT(keys != NULL || nkeys == 0);
+    ASSERT(results != NULL || nkeys == 0);
+
+    if (dct->_vtable->search_batch)
+	return dct->_vtable->search_batch(dct->_object, keys, nkeys, results);
+
+    size_t found = 0;
+    for (size_t i = 0; i < nkeys; ++i) {
+	results[i] = dct->_vtable->search(dct->_object, keys[i]);
+	if (results[i])
+	    ++found;
+    }
+    return found;
+}
+
+dict_itor*
+dict_itor_init(dict* dct, dict_itor_storage* storage)
+{
+    ASSERT(dct != NULL);
+    ASSERT(storage != NULL);
+
+    storage->_itor._itor = storage->_state;
+    storage->_itor._vtable = dct->_vtable->iinit(dct->_object, storage->_state);
+    return &storage->_itor;
+}
+
 void
 dict_itor_free(dict_itor* itor)
 {
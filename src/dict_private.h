@@ -70,6 +70,35 @@
 	} \
     } while (0)
 
+/* Per-container operation counters, maintained only when libdict is compiled
+ * with -DDICT_STATS. Without the flag the struct member and the increments
+ * vanish, so the hot paths carry no extra work. Containers embed the counters
+ * with OP_COUNTERS, bump them with STATS_INC, and copy them out in their
+ * get_stats function with STATS_EXPORT. */
+typedef struct {
+    size_t  insert_count;
+    size_t  search_count;
+    size_t  remove_count;
+} dict_op_counters;
+
+#ifdef DICT_STATS
+# define OP_COUNTERS		dict_op_counters op_counters;
+# define STATS_RESET(obj) \
+    ((obj)->op_counters = (dict_op_counters) { 0, 0, 0 })
+# define STATS_INC(obj,field)	((void)++(obj)->op_counters.field)
+# define STATS_EXPORT(obj,st) \
+    do { \
+	(st)->insert_count = (obj)->op_counters.insert_count; \
+	(st)->search_count = (obj)->op_counters.search_count; \
+	(st)->remove_count = (obj)->op_counters.remove_count; \
+    } while (0)
+#else
+# define OP_COUNTERS
+# define STATS_RESET(obj)	((void)0)
+# define STATS_INC(obj,field)	((void)0)
+# define STATS_EXPORT(obj,st)	((void)0)
+#endif
+
 #define MALLOC(n)	(*dict_malloc_func)(n)
 #define FREE(p)		(*dict_free_func)(p)
 
@@ -81,11 +110,26 @@
 #if defined(__GNUC__) || defined(__clang__)
 # define GCC_INLINE	__inline__
 # define GCC_CONST	__attribute__((__const__))
+# define PREFETCH(p)	__builtin_prefetch(p)
 #else
 # define GCC_INLINE
 # define GCC_CONST
+# define PREFETCH(p)	((void)0)
 #endif
 
+/* Dictionaries built with dict_ptr_cmp hold pointer-sized keys directly in
+ * the key slot, by value, so they can be compared inline instead of through
+ * the indirect call — the key's cache line is never touched. Every backend
+ * routes its key comparisons through here; the test against the well-known
+ * comparator is perfectly predicted after the first descent. */
+static inline int
+dict_cmp(dict_compare_func cmp_func, const void* k1, const void* k2)
+{
+    if (cmp_func == dict_ptr_cmp)
+	return (k1 > k2) - (k1 < k2);
+    return cmp_func(k1, k2);
+}
+
 static inline unsigned dict_rand() {
 #if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
     extern long random();
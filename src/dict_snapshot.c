@@ -0,0 +1,683 @@
+/*
+ * libdict -- memory-mapped snapshot implementation.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Snapshot layout: a fixed header, then one offset-table entry per key in
+ * sorted order, then the serialized key and datum bytes. All file positions
+ * are byte offsets from the start of the file, so the image can be mapped at
+ * any address. Loading maps the file read-only and allocates only the array
+ * of datum pointers which the dict interface hands out through void**;
+ * searches binary-search the entry table and compare keys in the mapping
+ * directly.
+ */
+
+#define _POSIX_C_SOURCE 200809L	    /* For mmap() under -std=c11. */
+
+#include "dict_snapshot.h"
+
+#include <stdlib.h>	    /* For qsort() */
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dict_private.h"
+
+#define SNAP_MAGIC	"dictsnap"
+#define SNAP_VERSION	1
+
+typedef struct {
+    char	magic[8];
+    uint32_t	version;
+    uint32_t	unused;
+    uint64_t	count;
+} snap_header;
+
+typedef struct {
+    uint64_t	key_off;
+    uint64_t	key_len;
+    uint64_t	datum_off;
+    uint64_t	datum_len;	/* Zero for a NULL datum. */
+} snap_entry;
+
+struct dict_snapshot {
+    void*		map;
+    size_t		map_size;
+    size_t		count;
+    dict_compare_func	cmp_func;
+    const snap_entry*	entries;
+    void**		datums;
+};
+
+struct dict_snapshot_itor {
+    dict_snapshot*	snap;
+    size_t		index;	/* Not less than snap->count if invalid. */
+};
+
+#define ENTRY_KEY(snap,i) ((void*)((char*)(snap)->map + (snap)->entries[i].key_off))
+#define VALID(itor)	  ((itor)->index < (itor)->snap->count)
+
+static dict_insert_result
+dict_snapshot_insert(dict_snapshot* snap, void* key)
+{
+    ASSERT(snap != NULL);
+    (void)key;
+    /* Snapshots are read-only. */
+    return (dict_insert_result) { NULL, false };
+}
+
+static dict_remove_result
+dict_snapshot_remove(dict_snapshot* snap, const void* key)
+{
+    ASSERT(snap != NULL);
+    (void)key;
+    /* Snapshots are read-only. */
+    return (dict_remove_result) { NULL, NULL, false };
+}
+
+static size_t
+dict_snapshot_clear(dict_snapshot* snap, dict_delete_func delete_func)
+{
+    ASSERT(snap != NULL);
+    (void)delete_func;
+    /* Snapshots are read-only; nothing is removed. */
+    return 0;
+}
+
+static dict_vtable dict_snapshot_vtable = {
+    (dict_inew_func)	    dict_snapshot_dict_itor_new,
+    (dict_dfree_func)	    dict_snapshot_free,
+    (dict_insert_func)	    dict_snapshot_insert,
+    (dict_search_func)	    dict_snapshot_search,
+    (dict_search_func)	    dict_snapshot_search_le,
+    (dict_search_func)	    dict_snapshot_search_lt,
+    (dict_search_func)	    dict_snapshot_search_ge,
+    (dict_search_func)	    dict_snapshot_search_gt,
+    (dict_remove_func)	    dict_snapshot_remove,
+    (dict_clear_func)	    dict_snapshot_clear,
+    (dict_clear_parallel_func) NULL,/* clear_parallel not applicable */
+    (dict_traverse_func)    dict_snapshot_traverse,
+    (dict_count_func)	    dict_snapshot_count,
+    (dict_verify_func)	    dict_snapshot_verify,
+    (dict_search_batch_func) NULL,/* search_batch: generic fallback */
+    (dict_traverse_range_func) dict_snapshot_traverse_range,
+    (dict_iinit_func)	    dict_snapshot_itor_init,
+    (dict_get_stats_func)   dict_snapshot_get_stats,
+    (dict_clone_func)	    NULL,/* clone not applicable */
+    (dict_merge_func)	    NULL,/* merge not applicable */
+};
+
+static itor_vtable dict_snapshot_itor_vtable = {
+    (dict_ifree_func)	    dict_snapshot_itor_free,
+    (dict_valid_func)	    dict_snapshot_itor_valid,
+    (dict_invalidate_func)  dict_snapshot_itor_invalidate,
+    (dict_next_func)	    dict_snapshot_itor_next,
+    (dict_prev_func)	    dict_snapshot_itor_prev,
+    (dict_nextn_func)	    dict_snapshot_itor_nextn,
+    (dict_prevn_func)	    dict_snapshot_itor_prevn,
+    (dict_first_func)	    dict_snapshot_itor_first,
+    (dict_last_func)	    dict_snapshot_itor_last,
+    (dict_key_func)	    dict_snapshot_itor_key,
+    (dict_datum_func)	    dict_snapshot_itor_datum,
+    (dict_isearch_func)	    dict_snapshot_itor_search,
+    (dict_isearch_func)	    dict_snapshot_itor_search_le,
+    (dict_isearch_func)	    dict_snapshot_itor_search_lt,
+    (dict_isearch_func)	    dict_snapshot_itor_search_ge,
+    (dict_isearch_func)	    dict_snapshot_itor_search_gt,
+    (dict_iremove_func)	    NULL,/* itor_remove: snapshots are read-only */
+    (dict_icompare_func)    NULL,/* itor_compare not implemented yet */
+};
+
+typedef struct {
+    void*   key;
+    void*   datum;
+} snap_pair;
+
+/* Comparison context for qsort(); saving is not reentrant. */
+static dict_compare_func sort_cmp_func;
+
+static int
+pair_cmp(const void* a, const void* b)
+{
+    return dict_cmp(sort_cmp_func, ((const snap_pair*)a)->key, ((const snap_pair*)b)->key);
+}
+
+static bool
+write_all(int fd, const void* buf, size_t len)
+{
+    const char* p = buf;
+    while (len) {
+	const ssize_t w = write(fd, p, len);
+	if (w <= 0)
+	    return false;
+	p += w;
+	len -= (size_t)w;
+    }
+    return true;
+}
+
+bool
+dict_snapshot_save(dict* dct, int fd, dict_measure_func key_len,
+		   dict_measure_func datum_len, dict_compare_func cmp_func)
+{
+    ASSERT(dct != NULL);
+    ASSERT(key_len != NULL);
+    ASSERT(cmp_func != NULL);
+
+    const size_t count = dict_count(dct);
+    snap_pair* pairs = MALLOC(count * sizeof(*pairs) + 1);
+    snap_entry* entries = MALLOC(count * sizeof(*entries) + 1);
+    if (!pairs || !entries) {
+	FREE(pairs);
+	FREE(entries);
+	return false;
+    }
+
+    size_t n = 0;
+    dict_itor* itor = dict_itor_new(dct);
+    if (!itor) {
+	FREE(pairs);
+	FREE(entries);
+	return false;
+    }
+    for (dict_itor_first(itor); dict_itor_valid(itor); dict_itor_next(itor)) {
+	ASSERT(n < count);
+	pairs[n].key = dict_itor_key(itor);
+	pairs[n].datum = *dict_itor_datum(itor);
+	++n;
+    }
+    dict_itor_free(itor);
+    ASSERT(n == count);
+
+    /* Tree iterators already run in order, but hash table iterators do not;
+     * sort so that loading can binary search with |cmp_func|. */
+    sort_cmp_func = cmp_func;
+    qsort(pairs, count, sizeof(*pairs), pair_cmp);
+
+    uint64_t offset = sizeof(snap_header) + count * sizeof(snap_entry);
+    for (size_t i = 0; i < count; ++i) {
+	entries[i].key_off = offset;
+	entries[i].key_len = key_len(pairs[i].key);
+	offset += entries[i].key_len;
+	entries[i].datum_off = offset;
+	entries[i].datum_len =
+	    (datum_len && pairs[i].datum) ? datum_len(pairs[i].datum) : 0;
+	offset += entries[i].datum_len;
+    }
+
+    snap_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAP_MAGIC, sizeof(header.magic));
+    header.version = SNAP_VERSION;
+    header.count = count;
+
+    bool ok = write_all(fd, &header, sizeof(header)) &&
+	      write_all(fd, entries, count * sizeof(*entries));
+    for (size_t i = 0; ok && i < count; ++i) {
+	ok = write_all(fd, pairs[i].key, entries[i].key_len) &&
+	     (!entries[i].datum_len ||
+	      write_all(fd, pairs[i].datum, entries[i].datum_len));
+    }
+    FREE(pairs);
+    FREE(entries);
+    return ok;
+}
+
+dict_snapshot*
+dict_snapshot_load(int fd, dict_compare_func cmp_func)
+{
+    ASSERT(cmp_func != NULL);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(snap_header))
+	return NULL;
+    const size_t map_size = (size_t)st.st_size;
+    void* map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+	return NULL;
+
+    const snap_header* header = map;
+    if (memcmp(header->magic, SNAP_MAGIC, sizeof(header->magic)) != 0 ||
+	header->version != SNAP_VERSION ||
+	header->count > (map_size - sizeof(snap_header)) / sizeof(snap_entry)) {
+	munmap(map, map_size);
+	return NULL;
+    }
+
+    dict_snapshot* snap = MALLOC(sizeof(*snap));
+    void** datums = MALLOC(header->count * sizeof(void*) + 1);
+    if (!snap || !datums) {
+	FREE(snap);
+	FREE(datums);
+	munmap(map, map_size);
+	return NULL;
+    }
+    snap->map = map;
+    snap->map_size = map_size;
+    snap->count = header->count;
+    snap->cmp_func = cmp_func;
+    snap->entries = (const snap_entry*)((const char*)map + sizeof(snap_header));
+    snap->datums = datums;
+    for (size_t i = 0; i < snap->count; ++i)
+	datums[i] = snap->entries[i].datum_len ?
+	    (char*)map + snap->entries[i].datum_off : NULL;
+    return snap;
+}
+
+dict*
+dict_snapshot_dict_load(int fd, dict_compare_func cmp_func)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = dict_snapshot_load(fd, cmp_func))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &dict_snapshot_vtable;
+    }
+    return dct;
+}
+
+size_t
+dict_snapshot_free(dict_snapshot* snap, dict_delete_func delete_func)
+{
+    ASSERT(snap != NULL);
+    (void)delete_func;	/* Keys and datums live in the mapping. */
+
+    const size_t count = snap->count;
+    munmap(snap->map, snap->map_size);
+    FREE(snap->datums);
+    FREE(snap);
+    return count;
+}
+
+/* Return the lowest index whose key is not less than |key|, which is
+ * |snap->count| if there is none, setting |*found| if the key is present. */
+static size_t
+lower_bound(const dict_snapshot* snap, const void* key, bool* found)
+{
+    size_t lo = 0, hi = snap->count;
+    *found = false;
+    while (lo < hi) {
+	const size_t mid = lo + (hi - lo) / 2;
+	const int cmp = dict_cmp(snap->cmp_func, key, ENTRY_KEY(snap, mid));
+	if (cmp < 0) {
+	    hi = mid;
+	} else if (cmp > 0) {
+	    lo = mid + 1;
+	} else {
+	    *found = true;
+	    return mid;
+	}
+    }
+    return lo;
+}
+
+void**
+dict_snapshot_search(dict_snapshot* snap, const void* key)
+{
+    ASSERT(snap != NULL);
+
+    bool found;
+    const size_t index = lower_bound(snap, key, &found);
+    return found ? &snap->datums[index] : NULL;
+}
+
+void**
+dict_snapshot_search_le(dict_snapshot* snap, const void* key)
+{
+    ASSERT(snap != NULL);
+
+    bool found;
+    const size_t index = lower_bound(snap, key, &found);
+    if (found)
+	return &snap->datums[index];
+    return index > 0 ? &snap->datums[index - 1] : NULL;
+}
+
+void**
+dict_snapshot_search_lt(dict_snapshot* snap, const void* key)
+{
+    ASSERT(snap != NULL);
+
+    bool found;
+    const size_t index = lower_bound(snap, key, &found);
+    return index > 0 ? &snap->datums[index - 1] : NULL;
+}
+
+void**
+dict_snapshot_search_ge(dict_snapshot* snap, const void* key)
+{
+    ASSERT(snap != NULL);
+
+    bool found;
+    const size_t index = lower_bound(snap, key, &found);
+    return index < snap->count ? &snap->datums[index] : NULL;
+}
+
+void**
+dict_snapshot_search_gt(dict_snapshot* snap, const void* key)
+{
+    ASSERT(snap != NULL);
+
+    bool found;
+    size_t index = lower_bound(snap, key, &found);
+    if (found)
+	++index;
+    return index < snap->count ? &snap->datums[index] : NULL;
+}
+
+size_t
+dict_snapshot_traverse(dict_snapshot* snap, dict_visit_func visit)
+{
+    ASSERT(snap != NULL);
+    ASSERT(visit != NULL);
+
+    size_t count = 0;
+    for (size_t i = 0; i < snap->count; ++i) {
+	++count;
+	if (!visit(ENTRY_KEY(snap, i), snap->datums[i]))
+	    break;
+    }
+    return count;
+}
+
+size_t
+dict_snapshot_traverse_range(dict_snapshot* snap, const void* lo,
+			     const void* hi, dict_visit_func visit)
+{
+    ASSERT(snap != NULL);
+    ASSERT(visit != NULL);
+
+    bool found;
+    size_t index = lo ? lower_bound(snap, lo, &found) : 0;
+    size_t count = 0;
+    for (; index < snap->count; ++index) {
+	if (hi && dict_cmp(snap->cmp_func, hi, ENTRY_KEY(snap, index)) < 0)
+	    break;
+	++count;
+	if (!visit(ENTRY_KEY(snap, index), snap->datums[index]))
+	    break;
+    }
+    return count;
+}
+
+size_t
+dict_snapshot_count(const dict_snapshot* snap)
+{
+    ASSERT(snap != NULL);
+
+    return snap->count;
+}
+
+void
+dict_snapshot_get_stats(dict_snapshot* snap, dict_stats* stats)
+{
+    ASSERT(snap != NULL);
+    ASSERT(stats != NULL);
+
+    /* A snapshot is a flat sorted array; it has no structure to report. */
+    memset(stats, 0, sizeof(*stats));
+    stats->count = snap->count;
+}
+
+const void*
+dict_snapshot_min(const dict_snapshot* snap)
+{
+    ASSERT(snap != NULL);
+
+    return snap->count ? ENTRY_KEY(snap, 0) : NULL;
+}
+
+const void*
+dict_snapshot_max(const dict_snapshot* snap)
+{
+    ASSERT(snap != NULL);
+
+    return snap->count ? ENTRY_KEY(snap, snap->count - 1) : NULL;
+}
+
+bool
+dict_snapshot_verify(const dict_snapshot* snap)
+{
+    ASSERT(snap != NULL);
+
+    for (size_t i = 0; i < snap->count; ++i) {
+	const snap_entry* e = &snap->entries[i];
+	VERIFY(e->key_off + e->key_len <= snap->map_size);
+	VERIFY(e->key_off + e->key_len >= e->key_off);
+	VERIFY(e->datum_off + e->datum_len <= snap->map_size);
+	VERIFY(e->datum_off + e->datum_len >= e->datum_off);
+	if (i > 0)
+	    VERIFY(dict_cmp(snap->cmp_func, ENTRY_KEY(snap, i - 1),
+				  ENTRY_KEY(snap, i)) < 0);
+    }
+    return true;
+}
+
+dict_snapshot_itor*
+dict_snapshot_itor_new(dict_snapshot* snap)
+{
+    ASSERT(snap != NULL);
+
+    dict_snapshot_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	itor->snap = snap;
+	itor->index = snap->count;
+    }
+    return itor;
+}
+
+dict_itor*
+dict_snapshot_dict_itor_new(dict_snapshot* snap)
+{
+    ASSERT(snap != NULL);
+
+    dict_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	if (!(itor->_itor = dict_snapshot_itor_new(snap))) {
+	    FREE(itor);
+	    return NULL;
+	}
+	itor->_vtable = &dict_snapshot_itor_vtable;
+    }
+    return itor;
+}
+
+itor_vtable*
+dict_snapshot_itor_init(dict_snapshot* snap, dict_snapshot_itor* itor)
+{
+    ASSERT(snap != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(dict_snapshot_itor) <= DICT_ITOR_STATE_MAX,
+		   "dict_snapshot_itor must fit in dict_itor_storage");
+
+    itor->snap = snap;
+    itor->index = snap->count;
+    return &dict_snapshot_itor_vtable;
+}
+
+void
+dict_snapshot_itor_free(dict_snapshot_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    FREE(itor);
+}
+
+bool
+dict_snapshot_itor_valid(const dict_snapshot_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return VALID(itor);
+}
+
+void
+dict_snapshot_itor_invalidate(dict_snapshot_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    itor->index = itor->snap->count;
+}
+
+bool
+dict_snapshot_itor_next(dict_snapshot_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (VALID(itor))
+	++itor->index;
+    return VALID(itor);
+}
+
+bool
+dict_snapshot_itor_prev(dict_snapshot_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (VALID(itor) && itor->index > 0) {
+	--itor->index;
+	return true;
+    }
+    itor->index = itor->snap->count;
+    return false;
+}
+
+bool
+dict_snapshot_itor_nextn(dict_snapshot_itor* itor, size_t count)
+{
+    ASSERT(itor != NULL);
+
+    while (count--)
+	if (!dict_snapshot_itor_next(itor))
+	    return false;
+    return VALID(itor);
+}
+
+bool
+dict_snapshot_itor_prevn(dict_snapshot_itor* itor, size_t count)
+{
+    ASSERT(itor != NULL);
+
+    while (count--)
+	if (!dict_snapshot_itor_prev(itor))
+	    return false;
+    return VALID(itor);
+}
+
+bool
+dict_snapshot_itor_first(dict_snapshot_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    itor->index = 0;
+    return VALID(itor);
+}
+
+bool
+dict_snapshot_itor_last(dict_snapshot_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    itor->index = itor->snap->count ? itor->snap->count - 1 : 0;
+    return VALID(itor);
+}
+
+bool
+dict_snapshot_itor_search(dict_snapshot_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    bool found;
+    const size_t index = lower_bound(itor->snap, key, &found);
+    itor->index = found ? index : itor->snap->count;
+    return VALID(itor);
+}
+
+bool
+dict_snapshot_itor_search_le(dict_snapshot_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    bool found;
+    const size_t index = lower_bound(itor->snap, key, &found);
+    if (found)
+	itor->index = index;
+    else
+	itor->index = index > 0 ? index - 1 : itor->snap->count;
+    return VALID(itor);
+}
+
+bool
+dict_snapshot_itor_search_lt(dict_snapshot_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    bool found;
+    const size_t index = lower_bound(itor->snap, key, &found);
+    itor->index = index > 0 ? index - 1 : itor->snap->count;
+    return VALID(itor);
+}
+
+bool
+dict_snapshot_itor_search_ge(dict_snapshot_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    bool found;
+    itor->index = lower_bound(itor->snap, key, &found);
+    return VALID(itor);
+}
+
+bool
+dict_snapshot_itor_search_gt(dict_snapshot_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    bool found;
+    size_t index = lower_bound(itor->snap, key, &found);
+    if (found)
+	++index;
+    itor->index = index;
+    return VALID(itor);
+}
+
+const void*
+dict_snapshot_itor_key(const dict_snapshot_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return VALID(itor) ? ENTRY_KEY(itor->snap, itor->index) : NULL;
+}
+
+void**
+dict_snapshot_itor_datum(dict_snapshot_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return VALID(itor) ? &itor->snap->datums[itor->index] : NULL;
+}
@@ -29,11 +29,16 @@
  * cf. [Gonnet 1984], [Knuth 1998]
  */
 
+/* For pthread_create under -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
 #include "hashtable.h"
 
+#include <pthread.h>
 #include <string.h> /* For memset() */
 #include "dict_private.h"
 #include "hashtable_common.h"
+#include "node_pool.h"
 
 /* TODO: make this configurable in the constructor methods */
 #define LOADFACTOR_NUMERATOR	2
@@ -42,6 +47,23 @@
 # error LOADFACTOR_NUMERATOR must be less than LOADFACTOR_DENOMINATOR
 #endif
 
+/* Number of old buckets migrated per insert/search/remove call while an
+ * incremental resize is in progress. */
+#define MIGRATION_STEP		8
+
+/* Number of lookups whose memory accesses are overlapped by search_batch. */
+#define BATCH_WIDTH		16
+
+/* Each byte of the optional filter is a tiny Bloom filter over the hashes
+ * resident in its bucket: one bit per node, chosen by the top three bits of
+ * the untruncated hash so that it is independent of the bucket index. A
+ * search whose bit is clear cannot find its key in the chain. */
+static inline uint8_t
+filter_bit(uint64_t hash)
+{
+    return (uint8_t)(1u << (hash >> 61));
+}
+
 typedef struct hash_node hash_node;
 
 struct hash_node {
@@ -50,15 +72,24 @@ struct hash_node {
     hash_node*		    next;
     /* Only because iterators are bidirectional: */
     hash_node*		    prev;
-    unsigned		    hash;	/* Untruncated hash value. */
+    uint64_t		    hash;	/* Untruncated hash value. */
 };
 
 struct hashtable {
+    OP_COUNTERS
     hash_node**		    table;
+    hash_node**		    old_table;	/* Buckets not yet migrated, or NULL. */
+    uint8_t*		    filter;	/* Optional per-bucket fingerprints. */
+    node_pool*		    pool;	/* Optional node allocator. */
     dict_compare_func	    cmp_func;
     dict_hash_func	    hash_func;
     size_t		    count;
     unsigned		    size;
+    unsigned		    old_size;
+    unsigned		    migrate_slot;
+    size_t		    resize_count;
+    bool		    incremental;
+    bool		    pow2;	/* Mask-based slot mapping. */
 };
 
 struct hashtable_itor {
@@ -78,9 +109,16 @@ static dict_vtable hashtable_vtable = {
     (dict_search_func)	    NULL,/* search_gt: not implemented */
     (dict_remove_func)	    hashtable_remove,
     (dict_clear_func)	    hashtable_clear,
+    (dict_clear_parallel_func) hashtable_clear_parallel,
     (dict_traverse_func)    hashtable_traverse,
     (dict_count_func)	    hashtable_count,
     (dict_verify_func)	    hashtable_verify,
+    (dict_search_batch_func) hashtable_search_batch,
+    (dict_traverse_range_func) NULL,/* traverse_range: no key ordering */
+    (dict_iinit_func)	    hashtable_itor_init,
+    (dict_get_stats_func)   hashtable_get_stats,
+    (dict_clone_func)	    NULL,/* TODO: implement clone */
+    (dict_merge_func)	    hashtable_merge,
 };
 
 static itor_vtable hashtable_itor_vtable = {
@@ -100,12 +138,13 @@ static itor_vtable hashtable_itor_vtable = {
     (dict_isearch_func)	    NULL,/* itor_search_lt: not implemented */
     (dict_isearch_func)	    NULL,/* itor_search_ge: not implemented */
     (dict_isearch_func)	    NULL,/* itor_search_gt: not implemented */
-    (dict_iremove_func)	    NULL,/* hashtable_itor_remove not implemented yet */
+    (dict_iremove_func)	    hashtable_itor_remove,
     (dict_icompare_func)    NULL,/* hashtable_itor_compare not implemented yet */
 };
 
-hashtable*
-hashtable_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+static hashtable*
+table_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size,
+	  bool pow2)
 {
     ASSERT(cmp_func != NULL);
     ASSERT(hash_func != NULL);
@@ -113,16 +152,75 @@ hashtable_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned siz
 
     hashtable* table = MALLOC(sizeof(*table));
     if (table) {
-	table->size = dict_prime_geq(size);
+	table->size = pow2 ? dict_pow2_geq(size) : dict_prime_geq(size);
 	table->table = MALLOC(table->size * sizeof(hash_node*));
 	if (!table->table) {
 	    FREE(table);
 	    return NULL;
 	}
 	memset(table->table, 0, table->size * sizeof(hash_node*));
+	table->old_table = NULL;
+	table->filter = NULL;
+	table->pool = NULL;
 	table->cmp_func = cmp_func;
 	table->hash_func = hash_func;
 	table->count = 0;
+	table->old_size = 0;
+	table->migrate_slot = 0;
+	table->resize_count = 0;
+	STATS_RESET(table);
+	table->incremental = false;
+	table->pow2 = pow2;
+    }
+    return table;
+}
+
+hashtable*
+hashtable_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    return table_new(cmp_func, hash_func, size, false);
+}
+
+hashtable*
+hashtable_new_pow2(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    return table_new(cmp_func, hash_func, size, true);
+}
+
+hashtable*
+hashtable_new_incremental(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    hashtable* table = hashtable_new(cmp_func, hash_func, size);
+    if (table)
+	table->incremental = true;
+    return table;
+}
+
+hashtable*
+hashtable_new_filtered(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    hashtable* table = hashtable_new(cmp_func, hash_func, size);
+    if (table) {
+	if (!(table->filter = MALLOC(table->size))) {
+	    FREE(table->table);
+	    FREE(table);
+	    return NULL;
+	}
+	memset(table->filter, 0, table->size);
+    }
+    return table;
+}
+
+hashtable*
+hashtable_new_pooled(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    hashtable* table = hashtable_new(cmp_func, hash_func, size);
+    if (table) {
+	if (!(table->pool = node_pool_new(sizeof(hash_node)))) {
+	    FREE(table->table);
+	    FREE(table);
+	    return NULL;
+	}
     }
     return table;
 }
@@ -145,39 +243,193 @@ hashtable_dict_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigne
     return dct;
 }
 
+dict*
+hashtable_dict_new_incremental(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    dict* dct = hashtable_dict_new(cmp_func, hash_func, size);
+    if (dct)
+	((hashtable*)dct->_object)->incremental = true;
+    return dct;
+}
+
+dict*
+hashtable_dict_new_pow2(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	dct->_object = hashtable_new_pow2(cmp_func, hash_func, size);
+	if (!dct->_object) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &hashtable_vtable;
+    }
+    return dct;
+}
+
+dict*
+hashtable_dict_new_filtered(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	dct->_object = hashtable_new_filtered(cmp_func, hash_func, size);
+	if (!dct->_object) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &hashtable_vtable;
+    }
+    return dct;
+}
+
+dict*
+hashtable_dict_new_pooled(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	dct->_object = hashtable_new_pooled(cmp_func, hash_func, size);
+	if (!dct->_object) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &hashtable_vtable;
+    }
+    return dct;
+}
+
 size_t
 hashtable_free(hashtable* table, dict_delete_func delete_func)
 {
     ASSERT(table != NULL);
 
     size_t count = hashtable_clear(table, delete_func);
+    if (table->pool)
+	node_pool_free(table->pool);
+    if (table->filter)
+	FREE(table->filter);
     FREE(table->table);
     FREE(table);
     return count;
 }
 
+/* Move the contents of a bucket of |old_table| into the current table. */
+static void
+migrate_bucket(hashtable* table, unsigned slot)
+{
+    for (hash_node* node = table->old_table[slot]; node;) {
+	hash_node* const next = node->next;
+	const unsigned mhash = dict_hash_slot(node->hash, table->size, table->pow2);
+
+	hash_node* search = table->table[mhash];
+	hash_node* prev = NULL;
+	while (search && node->hash >= search->hash) {
+	    prev = search;
+	    search = search->next;
+	}
+	if ((node->next = search) != NULL)
+	    search->prev = node;
+	if ((node->prev = prev) != NULL)
+	    prev->next = node;
+	else
+	    table->table[mhash] = node;
+	if (table->filter)
+	    table->filter[mhash] |= filter_bit(node->hash);
+
+	node = next;
+    }
+    table->old_table[slot] = NULL;
+}
+
+static void
+migrate_some(hashtable* table, unsigned nbuckets)
+{
+    if (!table->old_table)
+	return;
+    while (nbuckets-- && table->migrate_slot < table->old_size)
+	migrate_bucket(table, table->migrate_slot++);
+    if (table->migrate_slot == table->old_size) {
+	FREE(table->old_table);
+	table->old_table = NULL;
+	table->old_size = 0;
+	table->migrate_slot = 0;
+    }
+}
+
+static void
+migrate_all(hashtable* table)
+{
+    while (table->old_table)
+	migrate_some(table, table->old_size);
+}
+
+static bool
+start_incremental_resize(hashtable* table, unsigned new_size)
+{
+    ASSERT(table->old_table == NULL);
+
+    new_size = table->pow2 ? dict_pow2_geq(new_size) : dict_prime_geq(new_size);
+    if (table->size == new_size)
+	return true;
+
+    hash_node** ntable = MALLOC(new_size * sizeof(hash_node*));
+    if (!ntable)
+	return false;
+    memset(ntable, 0, new_size * sizeof(hash_node*));
+    if (table->filter) {
+	uint8_t* nfilter = MALLOC(new_size);
+	if (!nfilter) {
+	    FREE(ntable);
+	    return false;
+	}
+	memset(nfilter, 0, new_size);
+	FREE(table->filter);
+	table->filter = nfilter;
+    }
+
+    table->old_table = table->table;
+    table->old_size = table->size;
+    table->migrate_slot = 0;
+    table->table = ntable;
+    table->size = new_size;
+    table->resize_count++;
+    return true;
+}
+
 dict_insert_result
 hashtable_insert(hashtable* table, void* key)
 {
     ASSERT(table != NULL);
+    STATS_INC(table, insert_count);
 
+    migrate_some(table, MIGRATION_STEP);
     if (LOADFACTOR_DENOMINATOR * table->count >= LOADFACTOR_NUMERATOR * table->size) {
 	/* Load factor too high. */
-	hashtable_resize(table, table->size + 1);
+	if (!table->incremental) {
+	    hashtable_resize(table, table->size + 1);
+	} else if (table->old_table) {
+	    /* Still migrating: finish before growing again. */
+	    migrate_all(table);
+	    start_incremental_resize(table, table->size + 1);
+	} else {
+	    start_incremental_resize(table, table->size + 1);
+	}
     }
 
-    const unsigned hash = table->hash_func(key);
-    const unsigned mhash = hash % table->size;
+    const uint64_t hash = table->hash_func(key);
+    if (table->old_table)
+	migrate_bucket(table, dict_hash_slot(hash, table->old_size, table->pow2));
+    const unsigned mhash = dict_hash_slot(hash, table->size, table->pow2);
     hash_node* node = table->table[mhash];
     hash_node* prev = NULL;
     while (node && hash >= node->hash) {
-	if (hash == node->hash && table->cmp_func(key, node->key) == 0)
+	if (hash == node->hash && dict_cmp(table->cmp_func, key, node->key) == 0)
 	    return (dict_insert_result) { &node->datum, false };
 	prev = node;
 	node = node->next;
     }
 
-    hash_node* add = MALLOC(sizeof(*add));
+    hash_node* add = table->pool ?
+	node_pool_alloc(table->pool) : MALLOC(sizeof(*add));
     if (!add)
 	return (dict_insert_result) { NULL, false };
 
@@ -192,6 +444,8 @@ hashtable_insert(hashtable* table, void* key)
     add->next = node;
     if (node)
 	node->prev = add;
+    if (table->filter)
+	table->filter[mhash] |= filter_bit(hash);
 
     table->count++;
     return (dict_insert_result) { &add->datum, true };
@@ -201,29 +455,93 @@ void**
 hashtable_search(hashtable* table, const void* key)
 {
     ASSERT(table != NULL);
-
-    const unsigned hash = table->hash_func(key);
-    hash_node* node = table->table[hash % table->size];
+    STATS_INC(table, search_count);
+
+    migrate_some(table, MIGRATION_STEP);
+    const uint64_t hash = table->hash_func(key);
+    if (table->old_table)
+	migrate_bucket(table, dict_hash_slot(hash, table->old_size, table->pow2));
+    const unsigned mhash = dict_hash_slot(hash, table->size, table->pow2);
+    if (table->filter && !(table->filter[mhash] & filter_bit(hash)))
+	return NULL;
+    hash_node* node = table->table[mhash];
     while (node && hash >= node->hash) {
-	if (hash == node->hash && table->cmp_func(key, node->key) == 0)
+	if (hash == node->hash && dict_cmp(table->cmp_func, key, node->key) == 0)
 	    return &node->datum;
 	node = node->next;
     }
     return NULL;
 }
 
+size_t
+hashtable_search_batch(hashtable* table, const void* const* keys, size_t nkeys, void*** results)
+{
+    ASSERT(table != NULL);
+
+    /* Batched lookups only walk the current bucket array. */
+    migrate_all(table);
+    size_t found = 0;
+    for (size_t i = 0; i < nkeys; i += BATCH_WIDTH) {
+	const size_t n = MIN(nkeys - i, (size_t)BATCH_WIDTH);
+	uint64_t hashes[BATCH_WIDTH];
+	hash_node* node[BATCH_WIDTH];
+	/* Hash every key and prefetch its bucket, then its first node, so
+	 * that the cache misses of independent lookups overlap. */
+	for (size_t j = 0; j < n; ++j) {
+	    hashes[j] = table->hash_func(keys[i + j]);
+	    PREFETCH(&table->table[dict_hash_slot(hashes[j], table->size, table->pow2)]);
+	}
+	for (size_t j = 0; j < n; ++j) {
+	    const unsigned mhash = dict_hash_slot(hashes[j], table->size, table->pow2);
+	    if (table->filter && !(table->filter[mhash] & filter_bit(hashes[j]))) {
+		node[j] = NULL;
+		continue;
+	    }
+	    node[j] = table->table[mhash];
+	    if (node[j])
+		PREFETCH(node[j]);
+	}
+	for (size_t j = 0; j < n; ++j) {
+	    results[i + j] = NULL;
+	    for (hash_node* n2 = node[j]; n2 && hashes[j] >= n2->hash; n2 = n2->next) {
+		if (hashes[j] == n2->hash && dict_cmp(table->cmp_func, keys[i + j], n2->key) == 0) {
+		    results[i + j] = &n2->datum;
+		    ++found;
+		    break;
+		}
+	    }
+	}
+    }
+    return found;
+}
+
+/* Removed nodes may share filter bits with their neighbors, so the bucket's
+ * byte is rebuilt from the surviving chain. */
+static void
+filter_recompute(hashtable* table, unsigned slot)
+{
+    uint8_t bits = 0;
+    for (const hash_node* node = table->table[slot]; node; node = node->next)
+	bits |= filter_bit(node->hash);
+    table->filter[slot] = bits;
+}
+
 dict_remove_result
 hashtable_remove(hashtable* table, const void* key)
 {
     ASSERT(table != NULL);
+    STATS_INC(table, remove_count);
 
-    const unsigned hash = table->hash_func(key);
-    const unsigned mhash = hash % table->size;
+    migrate_some(table, MIGRATION_STEP);
+    const uint64_t hash = table->hash_func(key);
+    if (table->old_table)
+	migrate_bucket(table, dict_hash_slot(hash, table->old_size, table->pow2));
+    const unsigned mhash = dict_hash_slot(hash, table->size, table->pow2);
 
     hash_node* node = table->table[mhash];
     hash_node* prev = NULL;
     while (node && hash >= node->hash) {
-	if (hash == node->hash && table->cmp_func(key, node->key) == 0) {
+	if (hash == node->hash && dict_cmp(table->cmp_func, key, node->key) == 0) {
 	    if (prev)
 		prev->next = node->next;
 	    else
@@ -233,7 +551,12 @@ hashtable_remove(hashtable* table, const void* key)
 		node->next->prev = prev;
 
 	    dict_remove_result result = { node->key, node->datum, true };
-	    FREE(node);
+	    if (table->pool)
+		node_pool_dealloc(table->pool, node);
+	    else
+		FREE(node);
+	    if (table->filter)
+		filter_recompute(table, mhash);
 	    table->count--;
 	    return result;
 	}
@@ -243,11 +566,201 @@ hashtable_remove(hashtable* table, const void* key)
     return (dict_remove_result) { NULL, NULL, false };
 }
 
+size_t
+hashtable_merge(hashtable* table, hashtable* src)
+{
+    ASSERT(table != NULL);
+    ASSERT(src != NULL);
+    ASSERT(table != src);
+
+    /* Splicing nodes between tables requires that a node hashes and compares
+     * the same in both, and that dst can eventually free what src allocated,
+     * which rules out slab-pooled nodes. */
+    if (table->cmp_func != src->cmp_func || table->hash_func != src->hash_func ||
+	table->pool || src->pool)
+	return DICT_MERGE_INCOMPATIBLE;
+
+    migrate_all(table);
+    migrate_all(src);
+    const size_t total = table->count + src->count;
+    if (LOADFACTOR_DENOMINATOR * total >= LOADFACTOR_NUMERATOR * table->size) {
+	/* Best effort: a failed resize only means longer chains. */
+	hashtable_resize(table, (unsigned)(total + total / 2 + 1));
+    }
+
+    size_t moved = 0;
+    for (unsigned slot = 0; slot < src->size; slot++) {
+	hash_node* kept_head = NULL;
+	hash_node* kept_tail = NULL;
+	for (hash_node* node = src->table[slot]; node;) {
+	    hash_node* const next = node->next;
+	    const unsigned mhash = dict_hash_slot(node->hash, table->size, table->pow2);
+
+	    hash_node* search = table->table[mhash];
+	    hash_node* prev = NULL;
+	    bool dup = false;
+	    while (search && node->hash >= search->hash) {
+		if (node->hash == search->hash &&
+		    dict_cmp(table->cmp_func, node->key, search->key) == 0) {
+		    dup = true;
+		    break;
+		}
+		prev = search;
+		search = search->next;
+	    }
+	    if (dup) {
+		/* The key is already in |table|; keep the node in |src|. */
+		node->next = NULL;
+		if ((node->prev = kept_tail) != NULL)
+		    kept_tail->next = node;
+		else
+		    kept_head = node;
+		kept_tail = node;
+	    } else {
+		if ((node->next = search) != NULL)
+		    search->prev = node;
+		if ((node->prev = prev) != NULL)
+		    prev->next = node;
+		else
+		    table->table[mhash] = node;
+		if (table->filter)
+		    table->filter[mhash] |= filter_bit(node->hash);
+		++moved;
+	    }
+	    node = next;
+	}
+	src->table[slot] = kept_head;
+	if (src->filter)
+	    filter_recompute(src, slot);
+    }
+    table->count += moved;
+    src->count -= moved;
+    return moved;
+}
+
+typedef struct {
+    hash_node**		buckets;
+    unsigned		begin;
+    unsigned		end;
+    dict_delete_func	delete_func;
+} clear_worker_args;
+
+static void*
+clear_worker(void* Args)
+{
+    const clear_worker_args* args = Args;
+    for (unsigned slot = args->begin; slot < args->end; slot++) {
+	hash_node* node = args->buckets[slot];
+	while (node != NULL) {
+	    hash_node* next = node->next;
+	    if (args->delete_func)
+		args->delete_func(node->key, node->datum);
+	    FREE(node);
+	    node = next;
+	}
+	args->buckets[slot] = NULL;
+    }
+    return NULL;
+}
+
+size_t
+hashtable_clear_parallel(hashtable* table, dict_delete_func delete_func,
+			 unsigned nthreads)
+{
+    ASSERT(table != NULL);
+
+    /* Pooled tables already release every node at once; small tables are
+     * not worth the thread startup. */
+    if (table->pool || nthreads <= 1 || table->count < table->size / 4)
+	return hashtable_clear(table, delete_func);
+    migrate_all(table);
+
+    if (nthreads > table->size)
+	nthreads = table->size;
+    pthread_t* threads = MALLOC((nthreads - 1) * sizeof(threads[0]));
+    clear_worker_args* args = MALLOC(nthreads * sizeof(args[0]));
+    if (!threads || !args) {
+	FREE(threads);
+	FREE(args);
+	return hashtable_clear(table, delete_func);
+    }
+    for (unsigned k = 0; k < nthreads; ++k) {
+	args[k].buckets = table->table;
+	args[k].begin = (unsigned)((uint64_t)table->size * k / nthreads);
+	args[k].end = (unsigned)((uint64_t)table->size * (k + 1) / nthreads);
+	args[k].delete_func = delete_func;
+    }
+    unsigned started = 0;
+    while (started + 1 < nthreads &&
+	   pthread_create(&threads[started], NULL, clear_worker,
+			  &args[started + 1]) == 0)
+	started++;
+    /* The caller's thread takes the first range, plus any ranges whose
+     * worker could not be started. */
+    clear_worker(&args[0]);
+    for (unsigned k = started + 1; k < nthreads; ++k)
+	clear_worker(&args[k]);
+    for (unsigned k = 0; k < started; ++k)
+	pthread_join(threads[k], NULL);
+    FREE(threads);
+    FREE(args);
+    if (table->filter)
+	memset(table->filter, 0, table->size);
+
+    const size_t count = table->count;
+    table->count = 0;
+    return count;
+}
+
 size_t
 hashtable_clear(hashtable* table, dict_delete_func delete_func)
 {
     ASSERT(table != NULL);
 
+    if (table->pool) {
+	/* The pool releases every node at once; only walk the chains if the
+	 * caller needs to see each key and datum. */
+	if (delete_func) {
+	    if (table->old_table) {
+		for (unsigned slot = table->migrate_slot; slot < table->old_size; slot++)
+		    for (hash_node* node = table->old_table[slot]; node; node = node->next)
+			delete_func(node->key, node->datum);
+	    }
+	    for (unsigned slot = 0; slot < table->size; slot++)
+		for (hash_node* node = table->table[slot]; node; node = node->next)
+		    delete_func(node->key, node->datum);
+	}
+	if (table->old_table) {
+	    FREE(table->old_table);
+	    table->old_table = NULL;
+	    table->old_size = 0;
+	    table->migrate_slot = 0;
+	}
+	node_pool_clear(table->pool);
+	memset(table->table, 0, table->size * sizeof(hash_node*));
+	if (table->filter)
+	    memset(table->filter, 0, table->size);
+
+	const size_t count = table->count;
+	table->count = 0;
+	return count;
+    }
+    if (table->old_table) {
+	for (unsigned slot = table->migrate_slot; slot < table->old_size; slot++) {
+	    hash_node* node = table->old_table[slot];
+	    while (node != NULL) {
+		hash_node* next = node->next;
+		if (delete_func)
+		    delete_func(node->key, node->datum);
+		FREE(node);
+		node = next;
+	    }
+	}
+	FREE(table->old_table);
+	table->old_table = NULL;
+	table->old_size = 0;
+	table->migrate_slot = 0;
+    }
     for (unsigned slot = 0; slot < table->size; slot++) {
 	hash_node* node = table->table[slot];
 	while (node != NULL) {
@@ -259,6 +772,8 @@ hashtable_clear(hashtable* table, dict_delete_func delete_func)
 	}
 	table->table[slot] = NULL;
     }
+    if (table->filter)
+	memset(table->filter, 0, table->size);
 
     const size_t count = table->count;
     table->count = 0;
@@ -272,6 +787,14 @@ hashtable_traverse(hashtable* table, dict_visit_func visit)
     ASSERT(visit != NULL);
 
     size_t count = 0;
+    if (table->old_table) {
+	for (unsigned i = table->migrate_slot; i < table->old_size; i++)
+	    for (hash_node* node = table->old_table[i]; node; node = node->next) {
+		++count;
+		if (!visit(node->key, node->datum))
+		    return count;
+	    }
+    }
     for (unsigned i = 0; i < table->size; i++)
 	for (hash_node* node = table->table[i]; node; node = node->next) {
 	    ++count;
@@ -303,19 +826,51 @@ hashtable_slots_used(const hashtable* table)
     ASSERT(table != NULL);
 
     size_t count = 0;
+    if (table->old_table) {
+	for (unsigned i = table->migrate_slot; i < table->old_size; i++)
+	    if (table->old_table[i])
+		count++;
+    }
     for (unsigned i = 0; i < table->size; i++)
 	if (table->table[i])
 	    count++;
     return count;
 }
 
+void
+hashtable_get_stats(hashtable* table, dict_stats* stats)
+{
+    ASSERT(table != NULL);
+    ASSERT(stats != NULL);
+
+    /* Finish any in-progress migration so only the live table is measured. */
+    migrate_all(table);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = table->count;
+    stats->table_size = table->size;
+    stats->resize_count = table->resize_count;
+    size_t total_probes = 0;
+    for (unsigned i = 0; i < table->size; i++) {
+	size_t chain = 0;
+	for (const hash_node* node = table->table[i]; node; node = node->next)
+	    total_probes += ++chain;
+	if (stats->max_probe_length < chain)
+	    stats->max_probe_length = chain;
+    }
+    if (table->count)
+	stats->mean_probe_length = (double)total_probes / (double)table->count;
+    STATS_EXPORT(table, stats);
+}
+
 bool
 hashtable_resize(hashtable* table, unsigned new_size)
 {
     ASSERT(table != NULL);
     ASSERT(new_size != 0);
 
-    new_size = dict_prime_geq(new_size);
+    migrate_all(table);
+    new_size = table->pow2 ? dict_pow2_geq(new_size) : dict_prime_geq(new_size);
     if (table->size == new_size)
 	return true;
 
@@ -324,11 +879,19 @@ hashtable_resize(hashtable* table, unsigned new_size)
     if (!ntable)
 	return false;
     memset(ntable, 0, new_size * sizeof(hash_node*));
+    uint8_t* nfilter = NULL;
+    if (table->filter) {
+	if (!(nfilter = MALLOC(new_size))) {
+	    FREE(ntable);
+	    return false;
+	}
+	memset(nfilter, 0, new_size);
+    }
 
     for (unsigned i = 0; i < table->size; i++) {
 	for (hash_node* node = table->table[i]; node;) {
 	    hash_node* const next = node->next;
-	    const unsigned mhash = node->hash % new_size;
+	    const unsigned mhash = dict_hash_slot(node->hash, new_size, table->pow2);
 
 	    hash_node* search = ntable[mhash];
 	    hash_node* prev = NULL;
@@ -342,6 +905,8 @@ hashtable_resize(hashtable* table, unsigned new_size)
 		prev->next = node;
 	    else
 		ntable[mhash] = node;
+	    if (nfilter)
+		nfilter[mhash] |= filter_bit(node->hash);
 
 	    node = next;
 	}
@@ -349,7 +914,12 @@ hashtable_resize(hashtable* table, unsigned new_size)
 
     FREE(table->table);
     table->table = ntable;
+    if (table->filter) {
+	FREE(table->filter);
+	table->filter = nfilter;
+    }
     table->size = new_size;
+    table->resize_count++;
     return true;
 }
 
@@ -358,6 +928,21 @@ hashtable_verify(const hashtable* table)
 {
     ASSERT(table != NULL);
 
+    if (table->old_table) {
+	VERIFY(table->incremental);
+	VERIFY(table->migrate_slot <= table->old_size);
+	for (unsigned slot = 0; slot < table->old_size; ++slot) {
+	    if (slot < table->migrate_slot) {
+		VERIFY(table->old_table[slot] == NULL);
+		continue;
+	    }
+	    for (hash_node* n = table->old_table[slot]; n; n = n->next) {
+		if (n->next)
+		    VERIFY(n->hash <= n->next->hash);
+		VERIFY(dict_hash_slot(n->hash, table->old_size, table->pow2) == slot);
+	    }
+	}
+    }
     for (unsigned slot = 0; slot < table->size; ++slot) {
 	for (hash_node* n = table->table[slot]; n; n = n->next) {
 	    if (n == table->table[slot]) {
@@ -370,7 +955,13 @@ hashtable_verify(const hashtable* table)
 		VERIFY(n->next->prev == n);
 		VERIFY(n->hash <= n->next->hash);
 	    }
-	    VERIFY(n->hash % table->size == slot);
+	    VERIFY(dict_hash_slot(n->hash, table->size, table->pow2) == slot);
+	}
+	if (table->filter) {
+	    uint8_t bits = 0;
+	    for (const hash_node* n = table->table[slot]; n; n = n->next)
+		bits |= filter_bit(n->hash);
+	    VERIFY(table->filter[slot] == bits);
 	}
     }
     return true;
@@ -381,6 +972,8 @@ hashtable_itor_new(hashtable* table)
 {
     ASSERT(table != NULL);
 
+    /* Iterators only walk the current bucket array. */
+    migrate_all(table);
     hashtable_itor* itor = MALLOC(sizeof(*itor));
     if (itor) {
 	itor->table = table;
@@ -390,6 +983,22 @@ hashtable_itor_new(hashtable* table)
     return itor;
 }
 
+itor_vtable*
+hashtable_itor_init(hashtable* table, hashtable_itor* itor)
+{
+    ASSERT(table != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(hashtable_itor) <= DICT_ITOR_STATE_MAX,
+		   "hashtable_itor must fit in dict_itor_storage");
+
+    /* Iterators only walk the current bucket array. */
+    migrate_all(table);
+    itor->table = table;
+    itor->node = NULL;
+    itor->slot = 0;
+    return &hashtable_itor_vtable;
+}
+
 dict_itor*
 hashtable_dict_itor_new(hashtable* table)
 {
@@ -542,11 +1151,11 @@ hashtable_itor_last(hashtable_itor* itor)
 bool
 hashtable_itor_search(hashtable_itor* itor, const void* key)
 {
-    const unsigned hash = itor->table->hash_func(key);
-    const unsigned mhash = hash % itor->table->size;
+    const uint64_t hash = itor->table->hash_func(key);
+    const unsigned mhash = dict_hash_slot(hash, itor->table->size, itor->table->pow2);
     hash_node* node = itor->table->table[mhash];
     while (node && hash >= node->hash) {
-	if (hash == node->hash && itor->table->cmp_func(key, node->key) == 0) {
+	if (hash == node->hash && dict_cmp(itor->table->cmp_func, key, node->key) == 0) {
 	    itor->node = node;
 	    itor->slot = mhash;
 	    return true;
@@ -573,3 +1182,49 @@ hashtable_itor_datum(hashtable_itor* itor)
 
     return itor->node ? &itor->node->datum : NULL;
 }
+
+bool
+hashtable_itor_remove(hashtable_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (!itor->node)
+	return false;
+
+    hashtable* const table = itor->table;
+    STATS_INC(table, remove_count);
+    hash_node* const node = itor->node;
+    const unsigned slot = itor->slot;
+
+    /* Find the successor first; unlinking |node| does not disturb it. */
+    hash_node* next = node->next;
+    unsigned next_slot = slot;
+    if (!next) {
+	while (++next_slot < table->size)
+	    if ((next = table->table[next_slot]) != NULL)
+		break;
+    }
+
+    if (node->prev)
+	node->prev->next = node->next;
+    else
+	table->table[slot] = node->next;
+    if (node->next)
+	node->next->prev = node->prev;
+    if (table->pool)
+	node_pool_dealloc(table->pool, node);
+    else
+	FREE(node);
+    if (table->filter)
+	filter_recompute(table, slot);
+    table->count--;
+
+    if (next) {
+	itor->node = next;
+	itor->slot = next_slot;
+	return true;
+    }
+    itor->node = NULL;
+    itor->slot = 0;
+    return false;
+}
@@ -43,20 +43,52 @@
 # error LOADFACTOR_NUMERATOR must be less than LOADFACTOR_DENOMINATOR
 #endif
 
+/* A shrinking table is rehashed into a smaller array when its load factor
+ * drops below the low-water mark, and is then sized so that its load factor
+ * is the shrink target; the target must sit well below the growth trigger
+ * above or removals and insertions near the threshold would resize on every
+ * call. */
+#define SHRINK_LOADFACTOR_NUMERATOR	1
+#define SHRINK_LOADFACTOR_DENOMINATOR	4
+#define SHRINK_TARGET_MULTIPLIER	2
+#if SHRINK_TARGET_MULTIPLIER * LOADFACTOR_NUMERATOR <= LOADFACTOR_DENOMINATOR
+# error shrink target load factor must be below the growth trigger
+#endif
+#if SHRINK_LOADFACTOR_NUMERATOR * SHRINK_TARGET_MULTIPLIER >= SHRINK_LOADFACTOR_DENOMINATOR
+# error low-water mark must be below the shrink target load factor
+#endif
+
+/* Number of old slots examined per insert/search/remove call while an
+ * incremental resize is in progress. */
+#define MIGRATION_STEP		8
+
+/* Number of lookups whose memory accesses are overlapped by search_batch. */
+#define BATCH_WIDTH		16
+
 typedef struct hash_node hash_node;
 
 struct hash_node {
     void*		    key;
     void*		    datum;
-    unsigned		    hash;	/* Untruncated hash value; 0 iff unoccupied. */
+    uint64_t		    hash;	/* Untruncated hash value; 0 iff unoccupied. */
 };
 
 struct hashtable2 {
+    OP_COUNTERS
     size_t		    count;
     dict_compare_func	    cmp_func;
     dict_hash_func	    hash_func;
     hash_node*		    table;
+    hash_node*		    old_table;	/* Slots not yet migrated, or NULL. */
     unsigned		    size;
+    unsigned		    old_size;
+    unsigned		    old_remaining;
+    unsigned		    migrate_slot;
+    size_t		    resize_count;
+    unsigned		    min_size;	/* Never shrink below the initial size. */
+    bool		    incremental;
+    bool		    auto_shrink;
+    bool		    pow2;	/* Mask-based slot mapping. */
 };
 
 struct hashtable2_itor {
@@ -75,9 +107,16 @@ static dict_vtable hashtable2_vtable = {
     (dict_search_func)	    NULL,/* search_gt: not implemented */
     (dict_remove_func)	    hashtable2_remove,
     (dict_clear_func)	    hashtable2_clear,
+    (dict_clear_parallel_func) NULL,/* clear_parallel: not implemented */
     (dict_traverse_func)    hashtable2_traverse,
     (dict_count_func)	    hashtable2_count,
     (dict_verify_func)	    hashtable2_verify,
+    (dict_search_batch_func) hashtable2_search_batch,
+    (dict_traverse_range_func) NULL,/* traverse_range: no key ordering */
+    (dict_iinit_func)	    hashtable2_itor_init,
+    (dict_get_stats_func)   hashtable2_get_stats,
+    (dict_clone_func)	    NULL,/* TODO: implement clone */
+    (dict_merge_func)	    NULL,/* merge: generic fallback */
 };
 
 static itor_vtable hashtable2_itor_vtable = {
@@ -97,12 +136,13 @@ static itor_vtable hashtable2_itor_vtable = {
     (dict_isearch_func)	    NULL,/* itor_search_lt: not implemented */
     (dict_isearch_func)	    NULL,/* itor_search_ge: not implemented */
     (dict_isearch_func)	    NULL,/* itor_search_gt: not implemented */
-    (dict_iremove_func)	    NULL,/* hashtable2_itor_remove not implemented yet */
+    (dict_iremove_func)	    hashtable2_itor_remove,
     (dict_icompare_func)    NULL,/* hashtable2_itor_compare not implemented yet */
 };
 
-hashtable2*
-hashtable2_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
+static hashtable2*
+table_new(dict_compare_func cmp_func, dict_hash_func hash_func,
+	  unsigned initial_size, bool pow2)
 {
     ASSERT(cmp_func != NULL);
     ASSERT(hash_func != NULL);
@@ -110,20 +150,60 @@ hashtable2_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned in
 
     hashtable2* table = MALLOC(sizeof(*table));
     if (table) {
-	table->size = dict_prime_geq(initial_size);
+	table->size = pow2 ? dict_pow2_geq(initial_size) : dict_prime_geq(initial_size);
 	table->table = MALLOC(table->size * sizeof(hash_node));
 	if (!table->table) {
 	    FREE(table);
 	    return NULL;
 	}
 	memset(table->table, 0, table->size * sizeof(hash_node));
+	table->old_table = NULL;
 	table->cmp_func = cmp_func;
 	table->hash_func = hash_func;
 	table->count = 0;
+	table->old_size = 0;
+	table->old_remaining = 0;
+	table->migrate_slot = 0;
+	table->resize_count = 0;
+	STATS_RESET(table);
+	table->min_size = table->size;
+	table->incremental = false;
+	table->auto_shrink = false;
+	table->pow2 = pow2;
     }
     return table;
 }
 
+hashtable2*
+hashtable2_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
+{
+    return table_new(cmp_func, hash_func, initial_size, false);
+}
+
+hashtable2*
+hashtable2_new_pow2(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
+{
+    return table_new(cmp_func, hash_func, initial_size, true);
+}
+
+hashtable2*
+hashtable2_new_incremental(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
+{
+    hashtable2* table = hashtable2_new(cmp_func, hash_func, initial_size);
+    if (table)
+	table->incremental = true;
+    return table;
+}
+
+hashtable2*
+hashtable2_new_shrinking(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
+{
+    hashtable2* table = hashtable2_new(cmp_func, hash_func, initial_size);
+    if (table)
+	table->auto_shrink = true;
+    return table;
+}
+
 dict*
 hashtable2_dict_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
 {
@@ -142,6 +222,39 @@ hashtable2_dict_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsign
     return dct;
 }
 
+dict*
+hashtable2_dict_new_incremental(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
+{
+    dict* dct = hashtable2_dict_new(cmp_func, hash_func, initial_size);
+    if (dct)
+	((hashtable2*)dct->_object)->incremental = true;
+    return dct;
+}
+
+dict*
+hashtable2_dict_new_pow2(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	dct->_object = hashtable2_new_pow2(cmp_func, hash_func, initial_size);
+	if (!dct->_object) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &hashtable2_vtable;
+    }
+    return dct;
+}
+
+dict*
+hashtable2_dict_new_shrinking(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
+{
+    dict* dct = hashtable2_dict_new(cmp_func, hash_func, initial_size);
+    if (dct)
+	((hashtable2*)dct->_object)->auto_shrink = true;
+    return dct;
+}
+
 size_t
 hashtable2_free(hashtable2* table, dict_delete_func delete_func)
 {
@@ -154,12 +267,13 @@ hashtable2_free(hashtable2* table, dict_delete_func delete_func)
 }
 
 static inline dict_insert_result
-insert(hashtable2* table, void *key, unsigned hash)
+insert_node(hash_node* tbl, unsigned size, bool pow2, dict_compare_func cmp_func,
+	    void* key, uint64_t hash)
 {
     ASSERT(hash != 0);
 
-    hash_node* const first = table->table + (hash % table->size);
-    hash_node* const table_end = table->table + table->size;
+    hash_node* const first = tbl + dict_hash_slot(hash, size, pow2);
+    hash_node* const table_end = tbl + size;
     hash_node* node = first;
     do {
 	if (!node->hash) {
@@ -169,35 +283,143 @@ insert(hashtable2* table, void *key, unsigned hash)
 	    return (dict_insert_result) { &node->datum, true };
 	}
 
-	if (node->hash == hash && table->cmp_func(key, node->key) == 0)
+	if (node->hash == hash && dict_cmp(cmp_func, key, node->key) == 0)
 	    return (dict_insert_result) { &node->datum, false };
 
 	if (++node == table_end)
-	    node = table->table;
+	    node = tbl;
     } while (node != first);
     /* No room for new element! */
     return (dict_insert_result) { NULL, false };
 }
 
-static inline unsigned
+/* Move the whole probe cluster containing |slot| of |old_table| into the
+ * current table. Clusters must move as a unit: clearing a slot in the middle
+ * of one would break the probe sequences of the keys behind it. */
+static void
+migrate_cluster(hashtable2* table, unsigned slot)
+{
+    ASSERT(table->old_table != NULL);
+    ASSERT(table->old_table[slot].hash != 0);
+
+    unsigned start = slot;
+    for (unsigned steps = 0; steps < table->old_size; ++steps) {
+	const unsigned prev = (start ? start : table->old_size) - 1;
+	if (!table->old_table[prev].hash)
+	    break;
+	start = prev;
+    }
+    for (unsigned i = start; table->old_table[i].hash;
+	 i = (i + 1 == table->old_size) ? 0 : i + 1) {
+	hash_node* node = &table->old_table[i];
+	dict_insert_result result =
+	    insert_node(table->table, table->size, table->pow2, table->cmp_func,
+			node->key, node->hash);
+	ASSERT(result.inserted);
+	ASSERT(result.datum_ptr != NULL);
+	*result.datum_ptr = node->datum;
+	node->key = node->datum = NULL;
+	node->hash = 0;
+	ASSERT(table->old_remaining > 0);
+	table->old_remaining--;
+    }
+}
+
+static void
+migrate_some(hashtable2* table, unsigned budget)
+{
+    if (!table->old_table)
+	return;
+    while (budget && table->old_remaining) {
+	if (table->old_table[table->migrate_slot].hash) {
+	    migrate_cluster(table, table->migrate_slot);
+	} else {
+	    table->migrate_slot =
+		(table->migrate_slot + 1 == table->old_size) ? 0 : table->migrate_slot + 1;
+	    budget--;
+	}
+    }
+    if (!table->old_remaining) {
+	FREE(table->old_table);
+	table->old_table = NULL;
+	table->old_size = 0;
+	table->migrate_slot = 0;
+    }
+}
+
+static void
+migrate_all(hashtable2* table)
+{
+    while (table->old_table)
+	migrate_some(table, table->old_size);
+}
+
+static bool
+start_incremental_resize(hashtable2* table, unsigned new_size)
+{
+    ASSERT(table->old_table == NULL);
+
+    new_size = table->pow2 ? dict_pow2_geq(new_size) : dict_prime_geq(new_size);
+    if (table->size == new_size)
+	return true;
+
+    hash_node* ntable = MALLOC(new_size * sizeof(hash_node));
+    if (!ntable)
+	return false;
+    memset(ntable, 0, new_size * sizeof(hash_node));
+
+    table->old_table = table->table;
+    table->old_size = table->size;
+    table->old_remaining = (unsigned) table->count;
+    table->migrate_slot = 0;
+    table->table = ntable;
+    table->size = new_size;
+    table->resize_count++;
+    return true;
+}
+
+static inline dict_insert_result
+insert(hashtable2* table, void *key, uint64_t hash)
+{
+    return insert_node(table->table, table->size, table->pow2, table->cmp_func,
+		       key, hash);
+}
+
+static inline uint64_t
 nonzero_hash(dict_hash_func hash_func, const void *key)
 {
-    const unsigned hash = hash_func(key);
-    return hash ? hash : ~(unsigned)0;
+    const uint64_t hash = hash_func(key);
+    return hash ? hash : ~(uint64_t)0;
 }
 
 dict_insert_result
 hashtable2_insert(hashtable2* table, void* key)
 {
     ASSERT(table != NULL);
+    STATS_INC(table, insert_count);
 
+    migrate_some(table, MIGRATION_STEP);
     if (LOADFACTOR_DENOMINATOR * table->count >= LOADFACTOR_NUMERATOR * table->size) {
 	/* Load factor too high: increase the table size. */
-	if (!hashtable2_resize(table, table->size + 1)) {
-	    /* No memory for a bigger table, but let the insert proceed anyway. */
+	if (!table->incremental) {
+	    if (!hashtable2_resize(table, table->size + 1)) {
+		/* No memory for a bigger table, but let the insert proceed anyway. */
+	    }
+	} else {
+	    if (table->old_table) {
+		/* Still migrating: finish before growing again. */
+		migrate_all(table);
+	    }
+	    start_incremental_resize(table, table->size + 1);
 	}
     }
-    const unsigned hash = nonzero_hash(table->hash_func, key);
+    const uint64_t hash = nonzero_hash(table->hash_func, key);
+    if (table->old_table) {
+	const unsigned old_slot = dict_hash_slot(hash, table->old_size, table->pow2);
+	if (table->old_table[old_slot].hash)
+	    migrate_cluster(table, old_slot);
+	migrate_some(table, 0);	/* Free the old table if it just emptied. */
+    }
     dict_insert_result result = insert(table, key, hash);
     if (result.inserted)
 	table->count++;
@@ -208,16 +430,24 @@ void**
 hashtable2_search(hashtable2* table, const void* key)
 {
     ASSERT(table != NULL);
-
-    const unsigned hash = nonzero_hash(table->hash_func, key);
-    hash_node* const first = table->table + (hash % table->size);
+    STATS_INC(table, search_count);
+
+    migrate_some(table, MIGRATION_STEP);
+    const uint64_t hash = nonzero_hash(table->hash_func, key);
+    if (table->old_table) {
+	const unsigned old_slot = dict_hash_slot(hash, table->old_size, table->pow2);
+	if (table->old_table[old_slot].hash)
+	    migrate_cluster(table, old_slot);
+	migrate_some(table, 0);	/* Free the old table if it just emptied. */
+    }
+    hash_node* const first = table->table + dict_hash_slot(hash, table->size, table->pow2);
     hash_node* const table_end = table->table + table->size;
     hash_node* node = first;
     do {
 	if (!node->hash) /* Not occupied. */
 	    break;
 
-	if (node->hash == hash && table->cmp_func(key, node->key) == 0)
+	if (node->hash == hash && dict_cmp(table->cmp_func, key, node->key) == 0)
 	    return &node->datum;
 
 	if (++node == table_end)
@@ -226,6 +456,48 @@ hashtable2_search(hashtable2* table, const void* key)
     return NULL;
 }
 
+size_t
+hashtable2_search_batch(hashtable2* table, const void* const* keys, size_t nkeys, void*** results)
+{
+    ASSERT(table != NULL);
+
+    /* Batched lookups only probe the current slot array. */
+    migrate_all(table);
+    hash_node* const table_end = table->table + table->size;
+    size_t found = 0;
+    for (size_t i = 0; i < nkeys; i += BATCH_WIDTH) {
+	const size_t n = MIN(nkeys - i, (size_t)BATCH_WIDTH);
+	uint64_t hashes[BATCH_WIDTH];
+	/* Hash every key and prefetch the start of its probe sequence, so
+	 * that the cache misses of independent lookups overlap. */
+	for (size_t j = 0; j < n; ++j) {
+	    hashes[j] = nonzero_hash(table->hash_func, keys[i + j]);
+	    PREFETCH(&table->table[dict_hash_slot(hashes[j], table->size, table->pow2)]);
+	}
+	for (size_t j = 0; j < n; ++j) {
+	    hash_node* const first =
+		table->table + dict_hash_slot(hashes[j], table->size, table->pow2);
+	    hash_node* node = first;
+	    results[i + j] = NULL;
+	    do {
+		if (!node->hash) /* Not occupied. */
+		    break;
+
+		if (node->hash == hashes[j] &&
+		    dict_cmp(table->cmp_func, keys[i + j], node->key) == 0) {
+		    results[i + j] = &node->datum;
+		    ++found;
+		    break;
+		}
+
+		if (++node == table_end)
+		    node = table->table;
+	    } while (node != first);
+	}
+    }
+    return found;
+}
+
 #if 0
 static int
 index_of_node_to_shift(hashtable2* table, unsigned truncated_hash, unsigned index)
@@ -236,7 +508,7 @@ index_of_node_to_shift(hashtable2* table, unsigned truncated_hash, unsigned inde
 	if (!node->hash) {
 	    break;
 	}
-	if (node->hash % table->size == truncated_hash) {
+	if (dict_hash_slot(node->hash, table->size, table->pow2) == truncated_hash) {
 	    last_index = index;
 	}
 	if (++index == table->size) {
@@ -252,7 +524,7 @@ remove_cleanup(hashtable2* table, hash_node* const first, hash_node* node)
 {
     hash_node* const table_end = table->table + table->size;
     do {
-	const unsigned hash = node->hash;
+	const uint64_t hash = node->hash;
 	if (!hash) /* Not occupied. */
 	    break;
 
@@ -271,20 +543,45 @@ remove_cleanup(hashtable2* table, hash_node* const first, hash_node* node)
     } while (node != first);
 }
 
+/* If a shrinking table's load factor has fallen below the low-water mark,
+ * rehash it into an array sized for the shrink target load factor. Failure to
+ * allocate just keeps the oversized array. */
+static void
+maybe_shrink(hashtable2* table)
+{
+    if (!table->auto_shrink ||
+	table->size <= table->min_size ||
+	SHRINK_LOADFACTOR_DENOMINATOR * table->count >=
+	    SHRINK_LOADFACTOR_NUMERATOR * table->size)
+	return;
+    unsigned new_size = (unsigned)(table->count * SHRINK_TARGET_MULTIPLIER + 1);
+    if (new_size < table->min_size)
+	new_size = table->min_size;
+    hashtable2_resize(table, new_size);
+}
+
 dict_remove_result
 hashtable2_remove(hashtable2* table, const void* key)
 {
     ASSERT(table != NULL);
-
-    const unsigned hash = nonzero_hash(table->hash_func, key);
-    hash_node* const first = table->table + (hash % table->size);
+    STATS_INC(table, remove_count);
+
+    migrate_some(table, MIGRATION_STEP);
+    const uint64_t hash = nonzero_hash(table->hash_func, key);
+    if (table->old_table) {
+	const unsigned old_slot = dict_hash_slot(hash, table->old_size, table->pow2);
+	if (table->old_table[old_slot].hash)
+	    migrate_cluster(table, old_slot);
+	migrate_some(table, 0);	/* Free the old table if it just emptied. */
+    }
+    hash_node* const first = table->table + dict_hash_slot(hash, table->size, table->pow2);
     hash_node* const table_end = table->table + table->size;
     hash_node* node = first;
     do {
 	if (!node->hash) /* Not occupied. */
 	    break;
 
-	if (node->hash == hash && table->cmp_func(key, node->key) == 0) {
+	if (node->hash == hash && dict_cmp(table->cmp_func, key, node->key) == 0) {
 	    dict_remove_result result = { node->key, node->datum, true };
 	    node->key = node->datum = NULL;
 	    node->hash = 0;
@@ -293,6 +590,7 @@ hashtable2_remove(hashtable2* table, const void* key)
 	    if (++node == table_end)
 		node = table->table;
 	    remove_cleanup(table, first, node);
+	    maybe_shrink(table);
 	    return result;
 	}
 
@@ -307,6 +605,21 @@ hashtable2_clear(hashtable2* table, dict_delete_func delete_func)
 {
     ASSERT(table != NULL);
 
+    if (table->old_table) {
+	hash_node *old = table->old_table;
+	hash_node *const old_end = table->old_table + table->old_size;
+	for (; old != old_end; ++old) {
+	    if (old->hash) {
+		if (delete_func)
+		    delete_func(old->key, old->datum);
+	    }
+	}
+	FREE(table->old_table);
+	table->old_table = NULL;
+	table->old_size = 0;
+	table->old_remaining = 0;
+	table->migrate_slot = 0;
+    }
     hash_node *node = table->table;
     hash_node *const end = table->table + table->size;
     for (; node != end; ++node) {
@@ -320,6 +633,8 @@ hashtable2_clear(hashtable2* table, dict_delete_func delete_func)
 
     const size_t count = table->count;
     table->count = 0;
+    if (table->auto_shrink && table->size > table->min_size)
+	hashtable2_resize(table, table->min_size);
     return count;
 }
 
@@ -330,6 +645,17 @@ hashtable2_traverse(hashtable2* table, dict_visit_func visit)
     ASSERT(visit != NULL);
 
     size_t count = 0;
+    if (table->old_table) {
+	hash_node *old = table->old_table;
+	hash_node *const old_end = table->old_table + table->old_size;
+	for (; old != old_end; ++old) {
+	    if (old->hash) {
+		++count;
+		if (!visit(old->key, old->datum))
+		    return count;
+	    }
+	}
+    }
     hash_node *node = table->table;
     hash_node *const end = table->table + table->size;
     for (; node != end; ++node) {
@@ -366,13 +692,43 @@ hashtable2_slots_used(const hashtable2* table)
     return table->count;
 }
 
+void
+hashtable2_get_stats(hashtable2* table, dict_stats* stats)
+{
+    ASSERT(table != NULL);
+    ASSERT(stats != NULL);
+
+    /* Finish any in-progress migration so only the live table is measured. */
+    migrate_all(table);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = table->count;
+    stats->table_size = table->size;
+    stats->resize_count = table->resize_count;
+    size_t total_probes = 0;
+    for (unsigned i = 0; i < table->size; i++) {
+	if (!table->table[i].hash)
+	    continue;
+	/* Linear probing: distance from the slot the hash maps to. */
+	const unsigned home = dict_hash_slot(table->table[i].hash, table->size, table->pow2);
+	const size_t probes = (i >= home ? i - home : i + table->size - home) + 1;
+	total_probes += probes;
+	if (stats->max_probe_length < probes)
+	    stats->max_probe_length = probes;
+    }
+    if (table->count)
+	stats->mean_probe_length = (double)total_probes / (double)table->count;
+    STATS_EXPORT(table, stats);
+}
+
 bool
 hashtable2_resize(hashtable2* table, unsigned new_size)
 {
     ASSERT(table != NULL);
     ASSERT(new_size != 0);
 
-    new_size = dict_prime_geq(new_size);
+    migrate_all(table);
+    new_size = table->pow2 ? dict_pow2_geq(new_size) : dict_prime_geq(new_size);
     if (table->size == new_size)
 	return true;
 
@@ -408,15 +764,48 @@ hashtable2_resize(hashtable2* table, unsigned new_size)
 	}
     }
     FREE(old_table);
+    table->resize_count++;
     return true;
 }
 
+bool
+hashtable2_shrink_to_fit(hashtable2* table)
+{
+    ASSERT(table != NULL);
+
+    migrate_all(table);
+    unsigned new_size = (unsigned)(table->count + table->count / 2 + 1);
+    if (new_size < table->min_size)
+	new_size = table->min_size;
+    if ((table->pow2 ? dict_pow2_geq(new_size) : dict_prime_geq(new_size)) >= table->size)
+	return true;
+    return hashtable2_resize(table, new_size);
+}
+
 bool
 hashtable2_verify(const hashtable2* table)
 {
     ASSERT(table != NULL);
 
     size_t count = 0;
+    if (table->old_table) {
+	VERIFY(table->incremental);
+	VERIFY(table->migrate_slot < table->old_size);
+	size_t old_count = 0;
+	const hash_node *old = table->old_table;
+	const hash_node *old_end = table->old_table + table->old_size;
+	for (; old != old_end; ++old) {
+	    if (old->hash) {
+		++old_count;
+	    } else {
+		VERIFY(old->datum == NULL);
+	    }
+	}
+	VERIFY(table->old_remaining == old_count);
+	count += old_count;
+    } else {
+	VERIFY(table->old_remaining == 0);
+    }
     const hash_node *node = table->table;
     const hash_node *end = table->table + table->size;
     for (; node != end; ++node) {
@@ -435,6 +824,8 @@ hashtable2_itor_new(hashtable2* table)
 {
     ASSERT(table != NULL);
 
+    /* Iterators only walk the current slot array. */
+    migrate_all(table);
     hashtable2_itor* itor = MALLOC(sizeof(*itor));
     if (itor) {
 	itor->table = table;
@@ -443,6 +834,21 @@ hashtable2_itor_new(hashtable2* table)
     return itor;
 }
 
+itor_vtable*
+hashtable2_itor_init(hashtable2* table, hashtable2_itor* itor)
+{
+    ASSERT(table != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(hashtable2_itor) <= DICT_ITOR_STATE_MAX,
+		   "hashtable2_itor must fit in dict_itor_storage");
+
+    /* Iterators only walk the current slot array. */
+    migrate_all(table);
+    itor->table = table;
+    itor->slot = -1;
+    return &hashtable2_itor_vtable;
+}
+
 dict_itor*
 hashtable2_dict_itor_new(hashtable2* table)
 {
@@ -572,14 +978,15 @@ hashtable2_itor_last(hashtable2_itor* itor)
 bool
 hashtable2_itor_search(hashtable2_itor* itor, const void* key)
 {
-    const unsigned hash = nonzero_hash(itor->table->hash_func, key);
-    const unsigned truncated_hash = hash % itor->table->size;
+    const uint64_t hash = nonzero_hash(itor->table->hash_func, key);
+    const unsigned truncated_hash =
+	dict_hash_slot(hash, itor->table->size, itor->table->pow2);
     unsigned index = truncated_hash;
     do {
 	hash_node *node = &itor->table->table[index];
 	if (!node->hash)
 	    break;
-	if (node->hash == hash && itor->table->cmp_func(key, node->key) == 0) {
+	if (node->hash == hash && dict_cmp(itor->table->cmp_func, key, node->key) == 0) {
 	    itor->slot = (int) index;
 	    return true;
 	}
@@ -598,6 +1005,38 @@ hashtable2_itor_key(const hashtable2_itor* itor)
     return (itor->slot >= 0) ? itor->table->table[itor->slot].key : NULL;
 }
 
+bool
+hashtable2_itor_remove(hashtable2_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (itor->slot < 0)
+	return false;
+
+    hashtable2* const table = itor->table;
+    STATS_INC(table, remove_count);
+    hash_node* const node = &table->table[itor->slot];
+    ASSERT(node->hash != 0);
+
+    node->key = node->datum = NULL;
+    node->hash = 0;
+    table->count--;
+
+    /* Repair the probe cluster behind the freed slot. No maybe_shrink here:
+     * rehashing into a smaller array would invalidate the iterator. */
+    hash_node* const table_end = table->table + table->size;
+    hash_node* next = node + 1 == table_end ? table->table : node + 1;
+    remove_cleanup(table, node, next);
+
+    /* The repair may have shifted a later entry of the cluster into the
+     * freed slot, in which case the iterator already points at the next
+     * entry to visit; such an entry wrapping around the end of the array is
+     * the one case where a scan can see an entry twice. */
+    if (table->table[itor->slot].hash)
+	return true;
+    return hashtable2_itor_next(itor);
+}
+
 void**
 hashtable2_itor_datum(hashtable2_itor* itor)
 {
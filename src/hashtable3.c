@@ -0,0 +1,781 @@
+/*
+ * libdict -- open-addressing hash-table with group probing implementation.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * cf. [Knuth 1998]; the metadata layout follows the "Swiss table" design
+ * described by Kulukundis at CppCon 2017.
+ *
+ * Unlike hashtable2, slot occupancy is not tracked in the slots themselves but
+ * in a separate byte array holding a 7-bit fingerprint of each slot's hash.
+ * Probing compares a whole group of 16 fingerprints at a time, so most
+ * collisions are rejected without ever touching the slot array.
+ */
+
+#include "hashtable3.h"
+
+#include <stdbool.h>
+#include <string.h> /* For memset() */
+#include "dict_private.h"
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+/* TODO: make this configurable in the constructor methods */
+#define LOADFACTOR_NUMERATOR	3
+#define LOADFACTOR_DENOMINATOR	4
+#if LOADFACTOR_NUMERATOR > LOADFACTOR_DENOMINATOR
+# error LOADFACTOR_NUMERATOR must be less than LOADFACTOR_DENOMINATOR
+#endif
+
+#define GROUP_SIZE		16
+#define MIN_SIZE		GROUP_SIZE
+
+/* Number of lookups whose memory accesses are overlapped by search_batch. */
+#define BATCH_WIDTH		16
+
+/* Metadata bytes: high bit set means the slot is occupied and the low seven
+ * bits are the hash fingerprint. */
+#define META_EMPTY		0x00
+#define META_DELETED		0x01
+#define META_OCCUPIED		0x80
+
+typedef struct hash_node hash_node;
+
+struct hash_node {
+    void*		    key;
+    void*		    datum;
+    uint64_t		    hash;	/* Untruncated hash value. */
+};
+
+struct hashtable3 {
+    OP_COUNTERS
+    size_t		    count;
+    size_t		    used;	/* Occupied plus deleted slots. */
+    dict_compare_func	    cmp_func;
+    dict_hash_func	    hash_func;
+    uint8_t*		    meta;
+    hash_node*		    table;
+    unsigned		    size;
+    size_t		    resize_count;
+};
+
+struct hashtable3_itor {
+    hashtable3*		    table;
+    int			    slot;
+};
+
+static dict_vtable hashtable3_vtable = {
+    (dict_inew_func)	    hashtable3_dict_itor_new,
+    (dict_dfree_func)	    hashtable3_free,
+    (dict_insert_func)	    hashtable3_insert,
+    (dict_search_func)	    hashtable3_search,
+    (dict_search_func)	    NULL,/* search_le: not implemented */
+    (dict_search_func)	    NULL,/* search_lt: not implemented */
+    (dict_search_func)	    NULL,/* search_ge: not implemented */
+    (dict_search_func)	    NULL,/* search_gt: not implemented */
+    (dict_remove_func)	    hashtable3_remove,
+    (dict_clear_func)	    hashtable3_clear,
+    (dict_clear_parallel_func) NULL,/* clear_parallel: not implemented */
+    (dict_traverse_func)    hashtable3_traverse,
+    (dict_count_func)	    hashtable3_count,
+    (dict_verify_func)	    hashtable3_verify,
+    (dict_search_batch_func) hashtable3_search_batch,
+    (dict_traverse_range_func) NULL,/* traverse_range: no key ordering */
+    (dict_iinit_func)	    hashtable3_itor_init,
+    (dict_get_stats_func)   hashtable3_get_stats,
+    (dict_clone_func)	    NULL,/* TODO: implement clone */
+    (dict_merge_func)	    NULL,/* merge: generic fallback */
+};
+
+static itor_vtable hashtable3_itor_vtable = {
+    (dict_ifree_func)	    hashtable3_itor_free,
+    (dict_valid_func)	    hashtable3_itor_valid,
+    (dict_invalidate_func)  hashtable3_itor_invalidate,
+    (dict_next_func)	    hashtable3_itor_next,
+    (dict_prev_func)	    hashtable3_itor_prev,
+    (dict_nextn_func)	    hashtable3_itor_nextn,
+    (dict_prevn_func)	    hashtable3_itor_prevn,
+    (dict_first_func)	    hashtable3_itor_first,
+    (dict_last_func)	    hashtable3_itor_last,
+    (dict_key_func)	    hashtable3_itor_key,
+    (dict_datum_func)	    hashtable3_itor_datum,
+    (dict_isearch_func)	    hashtable3_itor_search,
+    (dict_isearch_func)	    NULL,/* itor_search_le: not implemented */
+    (dict_isearch_func)	    NULL,/* itor_search_lt: not implemented */
+    (dict_isearch_func)	    NULL,/* itor_search_ge: not implemented */
+    (dict_isearch_func)	    NULL,/* itor_search_gt: not implemented */
+    (dict_iremove_func)	    NULL,/* hashtable3_itor_remove not implemented yet */
+    (dict_icompare_func)    NULL,/* hashtable3_itor_compare not implemented yet */
+};
+
+static inline uint8_t
+fingerprint(uint64_t hash)
+{
+    /* The slot index is taken from the low bits, so fingerprint on the high
+     * bits to keep the two as independent as possible. */
+    return (uint8_t)(META_OCCUPIED | (hash >> 57));
+}
+
+/* Return a bitmask with bit |i| set iff the i'th byte of |meta| equals
+ * |byte|. */
+static inline uint32_t
+group_match(const uint8_t* meta, uint8_t byte)
+{
+#if defined(__SSE2__)
+    const __m128i group = _mm_loadu_si128((const __m128i*)meta);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)byte)));
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    static const uint8_t kBits[GROUP_SIZE] = {
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+    };
+    uint8x16_t eq = vceqq_u8(vld1q_u8(meta), vdupq_n_u8(byte));
+    eq = vandq_u8(eq, vld1q_u8(kBits));
+    uint8x8_t sum = vpadd_u8(vget_low_u8(eq), vget_high_u8(eq));
+    sum = vpadd_u8(sum, sum);
+    sum = vpadd_u8(sum, sum);
+    return (uint32_t)vget_lane_u8(sum, 0) | ((uint32_t)vget_lane_u8(sum, 1) << 8);
+#else
+    uint32_t mask = 0;
+    for (unsigned i = 0; i < GROUP_SIZE; ++i)
+	mask |= (uint32_t)(meta[i] == byte) << i;
+    return mask;
+#endif
+}
+
+/* Return a bitmask with bit |i| set iff the i'th slot of |meta| is empty or
+ * deleted. */
+static inline uint32_t
+group_match_free(const uint8_t* meta)
+{
+#if defined(__SSE2__)
+    const __m128i group = _mm_loadu_si128((const __m128i*)meta);
+    return (uint32_t)_mm_movemask_epi8(group) ^ 0xFFFFU;
+#else
+    uint32_t mask = 0;
+    for (unsigned i = 0; i < GROUP_SIZE; ++i)
+	mask |= (uint32_t)!(meta[i] & META_OCCUPIED) << i;
+    return mask;
+#endif
+}
+
+static inline unsigned
+trailing_zeros(uint32_t mask)
+{
+    ASSERT(mask != 0);
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned index = 0;
+    while (!(mask & 1)) {
+	mask >>= 1;
+	++index;
+    }
+    return index;
+#endif
+}
+
+static inline unsigned
+pow2_geq(unsigned n)
+{
+    unsigned size = MIN_SIZE;
+    while (size < n && (size << 1) != 0)
+	size <<= 1;
+    return size;
+}
+
+hashtable3*
+hashtable3_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
+{
+    ASSERT(cmp_func != NULL);
+    ASSERT(hash_func != NULL);
+    ASSERT(initial_size != 0);
+
+    hashtable3* table = MALLOC(sizeof(*table));
+    if (table) {
+	table->size = pow2_geq(initial_size);
+	table->meta = MALLOC(table->size);
+	table->table = MALLOC(table->size * sizeof(hash_node));
+	if (!table->meta || !table->table) {
+	    FREE(table->meta);
+	    FREE(table->table);
+	    FREE(table);
+	    return NULL;
+	}
+	memset(table->meta, META_EMPTY, table->size);
+	memset(table->table, 0, table->size * sizeof(hash_node));
+	table->cmp_func = cmp_func;
+	table->hash_func = hash_func;
+	table->count = 0;
+	table->used = 0;
+	table->resize_count = 0;
+	STATS_RESET(table);
+    }
+    return table;
+}
+
+dict*
+hashtable3_dict_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned initial_size)
+{
+    ASSERT(hash_func != NULL);
+    ASSERT(initial_size != 0);
+
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	dct->_object = hashtable3_new(cmp_func, hash_func, initial_size);
+	if (!dct->_object) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &hashtable3_vtable;
+    }
+    return dct;
+}
+
+size_t
+hashtable3_free(hashtable3* table, dict_delete_func delete_func)
+{
+    ASSERT(table != NULL);
+
+    size_t count = hashtable3_clear(table, delete_func);
+    FREE(table->meta);
+    FREE(table->table);
+    FREE(table);
+    return count;
+}
+
+static dict_insert_result
+insert(hashtable3* table, void* key, uint64_t hash)
+{
+    const uint8_t fp = fingerprint(hash);
+    const unsigned ngroups = table->size / GROUP_SIZE;
+    unsigned group = (hash / GROUP_SIZE) & (ngroups - 1);
+    int free_slot = -1;
+    for (unsigned probes = 0; probes < ngroups; ++probes) {
+	const unsigned base = group * GROUP_SIZE;
+	const uint8_t* meta = table->meta + base;
+	for (uint32_t mask = group_match(meta, fp); mask; mask &= mask - 1) {
+	    hash_node* node = &table->table[base + trailing_zeros(mask)];
+	    if (node->hash == hash && dict_cmp(table->cmp_func, key, node->key) == 0)
+		return (dict_insert_result) { &node->datum, false };
+	}
+	if (free_slot < 0) {
+	    uint32_t mask = group_match_free(meta);
+	    if (mask)
+		free_slot = (int)(base + trailing_zeros(mask));
+	}
+	if (group_match(meta, META_EMPTY)) {
+	    /* The key cannot live beyond the first truly empty slot. */
+	    break;
+	}
+	group = (group + 1) & (ngroups - 1);
+    }
+    if (free_slot >= 0) {
+	hash_node* node = &table->table[free_slot];
+	if (table->meta[free_slot] == META_EMPTY)
+	    table->used++;
+	table->meta[free_slot] = fp;
+	node->hash = hash;
+	node->key = key;
+	ASSERT(node->datum == NULL);
+	return (dict_insert_result) { &node->datum, true };
+    }
+    /* No room for new element! */
+    return (dict_insert_result) { NULL, false };
+}
+
+dict_insert_result
+hashtable3_insert(hashtable3* table, void* key)
+{
+    ASSERT(table != NULL);
+    STATS_INC(table, insert_count);
+
+    if (LOADFACTOR_DENOMINATOR * (table->used + 1) >= LOADFACTOR_NUMERATOR * table->size) {
+	/* Load factor too high: increase the table size. */
+	if (!hashtable3_resize(table, table->size + 1)) {
+	    /* No memory for a bigger table, but let the insert proceed anyway. */
+	}
+    }
+    dict_insert_result result = insert(table, key, table->hash_func(key));
+    if (result.inserted)
+	table->count++;
+    return result;
+}
+
+static int
+search_slot_hashed(hashtable3* table, const void* key, uint64_t hash)
+{
+    const uint8_t fp = fingerprint(hash);
+    const unsigned ngroups = table->size / GROUP_SIZE;
+    unsigned group = (hash / GROUP_SIZE) & (ngroups - 1);
+    for (unsigned probes = 0; probes < ngroups; ++probes) {
+	const unsigned base = group * GROUP_SIZE;
+	const uint8_t* meta = table->meta + base;
+	for (uint32_t mask = group_match(meta, fp); mask; mask &= mask - 1) {
+	    const unsigned slot = base + trailing_zeros(mask);
+	    hash_node* node = &table->table[slot];
+	    if (node->hash == hash && dict_cmp(table->cmp_func, key, node->key) == 0)
+		return (int)slot;
+	}
+	if (group_match(meta, META_EMPTY))
+	    break;
+	group = (group + 1) & (ngroups - 1);
+    }
+    return -1;
+}
+
+static int
+search_slot(hashtable3* table, const void* key)
+{
+    return search_slot_hashed(table, key, table->hash_func(key));
+}
+
+void**
+hashtable3_search(hashtable3* table, const void* key)
+{
+    ASSERT(table != NULL);
+    STATS_INC(table, search_count);
+
+    const int slot = search_slot(table, key);
+    return (slot >= 0) ? &table->table[slot].datum : NULL;
+}
+
+size_t
+hashtable3_search_batch(hashtable3* table, const void* const* keys, size_t nkeys, void*** results)
+{
+    ASSERT(table != NULL);
+
+    const unsigned ngroups = table->size / GROUP_SIZE;
+    size_t found = 0;
+    for (size_t i = 0; i < nkeys; i += BATCH_WIDTH) {
+	const size_t n = MIN(nkeys - i, (size_t)BATCH_WIDTH);
+	uint64_t hashes[BATCH_WIDTH];
+	/* Hash every key and prefetch the metadata and entries of its first
+	 * probe group, so that the cache misses of independent lookups
+	 * overlap. */
+	for (size_t j = 0; j < n; ++j) {
+	    hashes[j] = table->hash_func(keys[i + j]);
+	    const unsigned base =
+		((hashes[j] / GROUP_SIZE) & (ngroups - 1)) * GROUP_SIZE;
+	    PREFETCH(table->meta + base);
+	    PREFETCH(&table->table[base]);
+	}
+	for (size_t j = 0; j < n; ++j) {
+	    const int slot = search_slot_hashed(table, keys[i + j], hashes[j]);
+	    if ((results[i + j] = (slot >= 0) ? &table->table[slot].datum : NULL) != NULL)
+		++found;
+	}
+    }
+    return found;
+}
+
+static void
+remove_slot(hashtable3* table, unsigned slot)
+{
+    /* If the slot's group has an empty slot, no probe sequence can extend
+     * beyond this group, so the slot can be made empty instead of deleted. */
+    const unsigned base = slot & ~(unsigned)(GROUP_SIZE - 1);
+    if (group_match(table->meta + base, META_EMPTY)) {
+	table->meta[slot] = META_EMPTY;
+	table->used--;
+    } else {
+	table->meta[slot] = META_DELETED;
+    }
+    table->table[slot].key = table->table[slot].datum = NULL;
+    table->table[slot].hash = 0;
+    table->count--;
+}
+
+dict_remove_result
+hashtable3_remove(hashtable3* table, const void* key)
+{
+    ASSERT(table != NULL);
+    STATS_INC(table, remove_count);
+
+    const int slot = search_slot(table, key);
+    if (slot < 0)
+	return (dict_remove_result) { NULL, NULL, false };
+
+    dict_remove_result result = { table->table[slot].key, table->table[slot].datum, true };
+    remove_slot(table, (unsigned)slot);
+    return result;
+}
+
+size_t
+hashtable3_clear(hashtable3* table, dict_delete_func delete_func)
+{
+    ASSERT(table != NULL);
+
+    for (unsigned slot = 0; slot < table->size; ++slot) {
+	if (table->meta[slot] & META_OCCUPIED) {
+	    hash_node* node = &table->table[slot];
+	    if (delete_func)
+		delete_func(node->key, node->datum);
+	    node->key = node->datum = NULL;
+	    node->hash = 0;
+	}
+    }
+    memset(table->meta, META_EMPTY, table->size);
+
+    const size_t count = table->count;
+    table->count = 0;
+    table->used = 0;
+    return count;
+}
+
+size_t
+hashtable3_traverse(hashtable3* table, dict_visit_func visit)
+{
+    ASSERT(table != NULL);
+    ASSERT(visit != NULL);
+
+    size_t count = 0;
+    for (unsigned slot = 0; slot < table->size; ++slot) {
+	if (table->meta[slot] & META_OCCUPIED) {
+	    ++count;
+	    if (!visit(table->table[slot].key, table->table[slot].datum))
+		break;
+	}
+    }
+    return count;
+}
+
+size_t
+hashtable3_count(const hashtable3* table)
+{
+    ASSERT(table != NULL);
+
+    return table->count;
+}
+
+size_t
+hashtable3_size(const hashtable3* table)
+{
+    ASSERT(table != NULL);
+
+    return table->size;
+}
+
+size_t
+hashtable3_slots_used(const hashtable3* table)
+{
+    ASSERT(table != NULL);
+
+    return table->used;
+}
+
+void
+hashtable3_get_stats(hashtable3* table, dict_stats* stats)
+{
+    ASSERT(table != NULL);
+    ASSERT(stats != NULL);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = table->count;
+    stats->table_size = table->size;
+    stats->resize_count = table->resize_count;
+    /* Probing advances one group at a time, so measure probe length in
+     * groups visited rather than slots. */
+    const unsigned ngroups = table->size / GROUP_SIZE;
+    size_t total_probes = 0;
+    for (unsigned slot = 0; slot < table->size; slot++) {
+	if (!(table->meta[slot] & META_OCCUPIED))
+	    continue;
+	const unsigned home = (table->table[slot].hash / GROUP_SIZE) & (ngroups - 1);
+	const unsigned group = slot / GROUP_SIZE;
+	const size_t probes = ((group - home) & (ngroups - 1)) + 1;
+	total_probes += probes;
+	if (stats->max_probe_length < probes)
+	    stats->max_probe_length = probes;
+    }
+    if (table->count)
+	stats->mean_probe_length = (double)total_probes / (double)table->count;
+    STATS_EXPORT(table, stats);
+}
+
+bool
+hashtable3_resize(hashtable3* table, unsigned new_size)
+{
+    ASSERT(table != NULL);
+    ASSERT(new_size != 0);
+
+    new_size = pow2_geq(new_size);
+    if (table->count > LOADFACTOR_NUMERATOR * (new_size / LOADFACTOR_DENOMINATOR)) {
+	/* The number of records already in hashtable will not fit (must be a reduction in size). */
+	return false;
+    }
+    if (table->size == new_size && table->count == table->used)
+	return true;
+
+    const unsigned old_size = table->size;
+    const size_t old_count = table->count;
+    uint8_t* const old_meta = table->meta;
+    hash_node* const old_table = table->table;
+
+    table->meta = MALLOC(new_size);
+    table->table = MALLOC(new_size * sizeof(hash_node));
+    if (!table->meta || !table->table) {
+	FREE(table->meta);
+	FREE(table->table);
+	table->meta = old_meta;
+	table->table = old_table;
+	return false;
+    }
+    memset(table->meta, META_EMPTY, new_size);
+    memset(table->table, 0, new_size * sizeof(hash_node));
+    table->size = new_size;
+    table->used = 0;
+
+    for (unsigned i = 0; i < old_size; ++i) {
+	if (old_meta[i] & META_OCCUPIED) {
+	    dict_insert_result result =
+		insert(table, old_table[i].key, old_table[i].hash);
+	    if (!result.inserted || !result.datum_ptr) {
+		FREE(table->meta);
+		FREE(table->table);
+		table->meta = old_meta;
+		table->table = old_table;
+		table->size = old_size;
+		table->count = old_count;
+		table->used = old_count;
+		return false;
+	    }
+	    *result.datum_ptr = old_table[i].datum;
+	}
+    }
+    FREE(old_meta);
+    FREE(old_table);
+    table->resize_count++;
+    return true;
+}
+
+bool
+hashtable3_verify(const hashtable3* table)
+{
+    ASSERT(table != NULL);
+
+    VERIFY(table->size >= MIN_SIZE);
+    VERIFY((table->size & (table->size - 1)) == 0);
+    size_t count = 0, used = 0;
+    for (unsigned slot = 0; slot < table->size; ++slot) {
+	if (table->meta[slot] & META_OCCUPIED) {
+	    VERIFY(table->meta[slot] == fingerprint(table->table[slot].hash));
+	    ++count;
+	    ++used;
+	} else {
+	    VERIFY(table->meta[slot] == META_EMPTY ||
+		   table->meta[slot] == META_DELETED);
+	    VERIFY(table->table[slot].key == NULL);
+	    VERIFY(table->table[slot].datum == NULL);
+	    if (table->meta[slot] == META_DELETED)
+		++used;
+	}
+    }
+    VERIFY(table->count == count);
+    VERIFY(table->used == used);
+    return true;
+}
+
+hashtable3_itor*
+hashtable3_itor_new(hashtable3* table)
+{
+    ASSERT(table != NULL);
+
+    hashtable3_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	itor->table = table;
+	itor->slot = -1;
+    }
+    return itor;
+}
+
+itor_vtable*
+hashtable3_itor_init(hashtable3* table, hashtable3_itor* itor)
+{
+    ASSERT(table != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(hashtable3_itor) <= DICT_ITOR_STATE_MAX,
+		   "hashtable3_itor must fit in dict_itor_storage");
+
+    itor->table = table;
+    itor->slot = -1;
+    return &hashtable3_itor_vtable;
+}
+
+dict_itor*
+hashtable3_dict_itor_new(hashtable3* table)
+{
+    ASSERT(table != NULL);
+
+    dict_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	if (!(itor->_itor = hashtable3_itor_new(table))) {
+	    FREE(itor);
+	    return NULL;
+	}
+	itor->_vtable = &hashtable3_itor_vtable;
+    }
+    return itor;
+}
+
+void
+hashtable3_itor_free(hashtable3_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    FREE(itor);
+}
+
+bool
+hashtable3_itor_valid(const hashtable3_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return itor->slot >= 0;
+}
+
+void
+hashtable3_itor_invalidate(hashtable3_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    itor->slot = -1;
+}
+
+bool
+hashtable3_itor_next(hashtable3_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (itor->slot < 0)
+	return hashtable3_itor_first(itor);
+
+    while (++itor->slot < (int) itor->table->size) {
+	if (itor->table->meta[itor->slot] & META_OCCUPIED) {
+	    return true;
+	}
+    }
+    itor->slot = -1;
+    return false;
+}
+
+bool
+hashtable3_itor_prev(hashtable3_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (itor->slot < 0)
+	return hashtable3_itor_last(itor);
+
+    while (itor->slot-- > 0) {
+	if (itor->table->meta[itor->slot] & META_OCCUPIED) {
+	    return true;
+	}
+    }
+    ASSERT(itor->slot == -1);
+    return false;
+}
+
+bool
+hashtable3_itor_nextn(hashtable3_itor* itor, size_t count)
+{
+    ASSERT(itor != NULL);
+
+    while (count--)
+	if (!hashtable3_itor_next(itor))
+	    return false;
+    return itor->slot >= 0;
+}
+
+bool
+hashtable3_itor_prevn(hashtable3_itor* itor, size_t count)
+{
+    ASSERT(itor != NULL);
+
+    while (count--)
+	if (!hashtable3_itor_prev(itor))
+	    return false;
+    return itor->slot >= 0;
+}
+
+bool
+hashtable3_itor_first(hashtable3_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    for (unsigned slot = 0; slot < itor->table->size; ++slot) {
+	if (itor->table->meta[slot] & META_OCCUPIED) {
+	    itor->slot = (int) slot;
+	    return true;
+	}
+    }
+    itor->slot = -1;
+    return false;
+}
+
+bool
+hashtable3_itor_last(hashtable3_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    for (unsigned slot = itor->table->size; slot > 0;) {
+	if (itor->table->meta[--slot] & META_OCCUPIED) {
+	    itor->slot = (int) slot;
+	    return true;
+	}
+    }
+    itor->slot = -1;
+    return false;
+}
+
+bool
+hashtable3_itor_search(hashtable3_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    itor->slot = search_slot(itor->table, key);
+    return itor->slot >= 0;
+}
+
+const void*
+hashtable3_itor_key(const hashtable3_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return (itor->slot >= 0) ? itor->table->table[itor->slot].key : NULL;
+}
+
+void**
+hashtable3_itor_datum(hashtable3_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return (itor->slot >= 0) ? &itor->table->table[itor->slot].datum : NULL;
+}
@@ -46,3 +46,12 @@ dict_prime_geq(unsigned n)
 	    return kPrimes[index];
     return kPrimes[kNumPrimes - 1];
 }
+
+unsigned
+dict_pow2_geq(unsigned n)
+{
+    unsigned size = 8;
+    while (size < n && size != (1U << 31))
+	size <<= 1;
+    return size;
+}
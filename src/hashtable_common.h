@@ -28,6 +28,26 @@
 #ifndef LIBDICT_HASHTABLE_COMMON_H__
 #define LIBDICT_HASHTABLE_COMMON_H__
 
+#include <stdbool.h>
+#include <stdint.h>
+
 unsigned dict_prime_geq(unsigned n);
+unsigned dict_pow2_geq(unsigned n);
+
+/* Map an untruncated hash value onto a table of |size| slots. Prime-sized
+ * tables reduce with the usual modulo. Power-of-two tables avoid the
+ * hardware division: the hash is multiplied by an odd 64-bit constant and
+ * the product's high half is folded down before masking, so the mask sees
+ * well-mixed bits even from hash functions whose low-order bits are weak. */
+static inline unsigned
+dict_hash_slot(uint64_t hash, unsigned size, bool pow2)
+{
+    if (pow2) {
+	hash *= UINT64_C(0x9E3779B97F4A7C15);
+	hash ^= hash >> 32;
+	return (unsigned)hash & (size - 1);
+    }
+    return (unsigned)(hash % size);
+}
 
 #endif /* !LIBDICT_HASHTABLE_COMMON_H__ */
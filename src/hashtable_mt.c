@@ -0,0 +1,749 @@
+/*
+ * libdict -- thread-safe chained hash-table implementation.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * cf. [Gonnet 1984], [Knuth 1998], [Herlihy and Shavit 2008]
+ *
+ * The bucket array is divided into STRIPE_COUNT stripes, each guarded by a
+ * read-write lock, so lookups of keys in different stripes proceed in
+ * parallel and lookups in the same stripe share its lock. The bucket count
+ * is kept a multiple of the stripe count so that every chain belongs to
+ * exactly one stripe. Growing the table takes every stripe lock in order,
+ * which also means a thread that holds one stripe lock observes a stable
+ * bucket count; lock_stripe() rechecks the count after acquisition to
+ * detect a resize that slipped in between hashing and locking.
+ */
+
+/* For pthread_rwlock_t under -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include "hashtable_mt.h"
+
+#include <pthread.h>
+#include <string.h>	/* For memset() */
+#include "dict_private.h"
+
+#define LOADFACTOR_NUMERATOR	2
+#define LOADFACTOR_DENOMINATOR	3
+#if LOADFACTOR_NUMERATOR > LOADFACTOR_DENOMINATOR
+# error LOADFACTOR_NUMERATOR must be less than LOADFACTOR_DENOMINATOR
+#endif
+
+#define STRIPE_COUNT		64  /* Must be a power of two. */
+#define STRIPE_MASK		(STRIPE_COUNT - 1)
+
+typedef struct mt_node mt_node;
+
+struct mt_node {
+    void*		    key;
+    void*		    datum;
+    mt_node*		    next;
+    /* Only because iterators are bidirectional: */
+    mt_node*		    prev;
+    uint64_t		    hash;	/* Untruncated hash value. */
+};
+
+/* Padded so that neighboring stripe locks do not share a cache line. */
+typedef union {
+    pthread_rwlock_t	    lock;
+    char		    pad[64];
+} mt_stripe;
+
+struct hashtable_mt {
+    mt_node**		    table;
+    dict_compare_func	    cmp_func;
+    dict_hash_func	    hash_func;
+    size_t		    count;
+    unsigned		    size;
+    size_t		    resize_count;
+    mt_stripe		    stripes[STRIPE_COUNT];
+};
+
+struct hashtable_mt_itor {
+    hashtable_mt*	    table;
+    mt_node*		    node;
+    unsigned		    slot;
+    bool		    locked;
+};
+
+static dict_vtable hashtable_mt_vtable = {
+    (dict_inew_func)	    hashtable_mt_dict_itor_new,
+    (dict_dfree_func)	    hashtable_mt_free,
+    (dict_insert_func)	    hashtable_mt_insert,
+    (dict_search_func)	    hashtable_mt_search,
+    (dict_search_func)	    NULL,/* search_le: not implemented */
+    (dict_search_func)	    NULL,/* search_lt: not implemented */
+    (dict_search_func)	    NULL,/* search_ge: not implemented */
+    (dict_search_func)	    NULL,/* search_gt: not implemented */
+    (dict_remove_func)	    hashtable_mt_remove,
+    (dict_clear_func)	    hashtable_mt_clear,
+    (dict_clear_parallel_func) NULL,/* clear_parallel: not implemented */
+    (dict_traverse_func)    hashtable_mt_traverse,
+    (dict_count_func)	    hashtable_mt_count,
+    (dict_verify_func)	    hashtable_mt_verify,
+    (dict_search_batch_func) NULL,/* search_batch: generic fallback */
+    (dict_traverse_range_func) NULL,/* traverse_range: no key ordering */
+    (dict_iinit_func)	    hashtable_mt_itor_init,
+    (dict_get_stats_func)   hashtable_mt_get_stats,
+    (dict_clone_func)	    NULL,/* TODO: implement clone */
+    (dict_merge_func)	    NULL,/* merge: generic fallback */
+};
+
+static itor_vtable hashtable_mt_itor_vtable = {
+    (dict_ifree_func)	    hashtable_mt_itor_free,
+    (dict_valid_func)	    hashtable_mt_itor_valid,
+    (dict_invalidate_func)  hashtable_mt_itor_invalidate,
+    (dict_next_func)	    hashtable_mt_itor_next,
+    (dict_prev_func)	    hashtable_mt_itor_prev,
+    (dict_nextn_func)	    hashtable_mt_itor_nextn,
+    (dict_prevn_func)	    hashtable_mt_itor_prevn,
+    (dict_first_func)	    hashtable_mt_itor_first,
+    (dict_last_func)	    hashtable_mt_itor_last,
+    (dict_key_func)	    hashtable_mt_itor_key,
+    (dict_datum_func)	    hashtable_mt_itor_datum,
+    (dict_isearch_func)	    hashtable_mt_itor_search,
+    (dict_isearch_func)	    NULL,/* itor_search_le: not implemented */
+    (dict_isearch_func)	    NULL,/* itor_search_lt: not implemented */
+    (dict_isearch_func)	    NULL,/* itor_search_ge: not implemented */
+    (dict_isearch_func)	    NULL,/* itor_search_gt: not implemented */
+    (dict_iremove_func)	    NULL,/* hashtable_mt_itor_remove not implemented yet */
+    (dict_icompare_func)    NULL,/* hashtable_mt_itor_compare not implemented yet */
+};
+
+static unsigned
+load_size(const hashtable_mt* table)
+{
+    return __atomic_load_n(&table->size, __ATOMIC_ACQUIRE);
+}
+
+/* Lock the stripe that covers |hash|'s bucket. A concurrent grow may change
+ * the bucket count, and with it the stripe a key belongs to, between hashing
+ * and locking; since growing holds every stripe lock, rechecking the bucket
+ * count after acquisition suffices to detect that and retry. */
+static pthread_rwlock_t*
+lock_stripe(hashtable_mt* table, unsigned hash, bool exclusive)
+{
+    for (;;) {
+	const unsigned size = load_size(table);
+	pthread_rwlock_t* lock = &table->stripes[(hash % size) & STRIPE_MASK].lock;
+	if (exclusive)
+	    pthread_rwlock_wrlock(lock);
+	else
+	    pthread_rwlock_rdlock(lock);
+	if (load_size(table) == size)
+	    return lock;
+	pthread_rwlock_unlock(lock);
+    }
+}
+
+static void
+lock_all(hashtable_mt* table, bool exclusive)
+{
+    for (unsigned i = 0; i < STRIPE_COUNT; ++i) {
+	if (exclusive)
+	    pthread_rwlock_wrlock(&table->stripes[i].lock);
+	else
+	    pthread_rwlock_rdlock(&table->stripes[i].lock);
+    }
+}
+
+static void
+unlock_all(hashtable_mt* table)
+{
+    for (unsigned i = 0; i < STRIPE_COUNT; ++i)
+	pthread_rwlock_unlock(&table->stripes[i].lock);
+}
+
+hashtable_mt*
+hashtable_mt_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    ASSERT(cmp_func != NULL);
+    ASSERT(hash_func != NULL);
+    ASSERT(size != 0);
+
+    /* Round up to a multiple of the stripe count, so that buckets partition
+     * evenly into stripes. */
+    size = (size + STRIPE_COUNT - 1) / STRIPE_COUNT * STRIPE_COUNT;
+
+    hashtable_mt* table = MALLOC(sizeof(*table));
+    if (table) {
+	table->table = MALLOC(size * sizeof(mt_node*));
+	if (!table->table) {
+	    FREE(table);
+	    return NULL;
+	}
+	memset(table->table, 0, size * sizeof(mt_node*));
+	table->cmp_func = cmp_func;
+	table->hash_func = hash_func;
+	table->count = 0;
+	table->size = size;
+	table->resize_count = 0;
+	for (unsigned i = 0; i < STRIPE_COUNT; ++i)
+	    pthread_rwlock_init(&table->stripes[i].lock, NULL);
+    }
+    return table;
+}
+
+dict*
+hashtable_mt_dict_new(dict_compare_func cmp_func, dict_hash_func hash_func, unsigned size)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = hashtable_mt_new(cmp_func, hash_func, size))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &hashtable_mt_vtable;
+    }
+    return dct;
+}
+
+size_t
+hashtable_mt_free(hashtable_mt* table, dict_delete_func delete_func)
+{
+    ASSERT(table != NULL);
+
+    const size_t count = hashtable_mt_clear(table, delete_func);
+    for (unsigned i = 0; i < STRIPE_COUNT; ++i)
+	pthread_rwlock_destroy(&table->stripes[i].lock);
+    FREE(table->table);
+    FREE(table);
+    return count;
+}
+
+/* Double the bucket count. Takes every stripe lock, so it excludes all
+ * other operations; growth failure is harmless, chains just stay longer. */
+static void
+grow(hashtable_mt* table)
+{
+    lock_all(table, true);
+    /* Another thread may have grown the table while we waited. */
+    if (LOADFACTOR_DENOMINATOR * table->count <
+	LOADFACTOR_NUMERATOR * (size_t)table->size) {
+	unlock_all(table);
+	return;
+    }
+    const unsigned new_size = table->size * 2;
+    mt_node** ntable = MALLOC(new_size * sizeof(mt_node*));
+    if (!ntable) {
+	unlock_all(table);
+	return;
+    }
+    memset(ntable, 0, new_size * sizeof(mt_node*));
+
+    for (unsigned i = 0; i < table->size; i++) {
+	for (mt_node* node = table->table[i]; node;) {
+	    mt_node* const next = node->next;
+	    const unsigned mhash = node->hash % new_size;
+
+	    mt_node* search = ntable[mhash];
+	    mt_node* prev = NULL;
+	    while (search && node->hash >= search->hash) {
+		prev = search;
+		search = search->next;
+	    }
+	    if ((node->next = search) != NULL)
+		search->prev = node;
+	    if ((node->prev = prev) != NULL)
+		prev->next = node;
+	    else
+		ntable[mhash] = node;
+
+	    node = next;
+	}
+    }
+
+    FREE(table->table);
+    table->table = ntable;
+    table->resize_count++;
+    __atomic_store_n(&table->size, new_size, __ATOMIC_RELEASE);
+    unlock_all(table);
+}
+
+dict_insert_result
+hashtable_mt_insert(hashtable_mt* table, void* key)
+{
+    ASSERT(table != NULL);
+
+    if (LOADFACTOR_DENOMINATOR * __atomic_load_n(&table->count, __ATOMIC_RELAXED) >=
+	LOADFACTOR_NUMERATOR * (size_t)load_size(table))
+	grow(table);
+
+    const uint64_t hash = table->hash_func(key);
+    pthread_rwlock_t* lock = lock_stripe(table, hash, true);
+    const unsigned mhash = hash % table->size;
+    mt_node* node = table->table[mhash];
+    mt_node* prev = NULL;
+    while (node && hash >= node->hash) {
+	if (hash == node->hash && dict_cmp(table->cmp_func, key, node->key) == 0) {
+	    pthread_rwlock_unlock(lock);
+	    return (dict_insert_result) { &node->datum, false };
+	}
+	prev = node;
+	node = node->next;
+    }
+
+    mt_node* add = MALLOC(sizeof(*add));
+    if (!add) {
+	pthread_rwlock_unlock(lock);
+	return (dict_insert_result) { NULL, false };
+    }
+
+    add->key = key;
+    add->datum = NULL;
+    add->hash = hash;
+    add->prev = prev;
+    if (prev)
+	prev->next = add;
+    else
+	table->table[mhash] = add;
+    add->next = node;
+    if (node)
+	node->prev = add;
+
+    __atomic_fetch_add(&table->count, 1, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(lock);
+    return (dict_insert_result) { &add->datum, true };
+}
+
+void**
+hashtable_mt_search(hashtable_mt* table, const void* key)
+{
+    ASSERT(table != NULL);
+
+    const uint64_t hash = table->hash_func(key);
+    pthread_rwlock_t* lock = lock_stripe(table, hash, false);
+    mt_node* node = table->table[hash % table->size];
+    while (node && hash >= node->hash) {
+	if (hash == node->hash && dict_cmp(table->cmp_func, key, node->key) == 0) {
+	    pthread_rwlock_unlock(lock);
+	    return &node->datum;
+	}
+	node = node->next;
+    }
+    pthread_rwlock_unlock(lock);
+    return NULL;
+}
+
+dict_remove_result
+hashtable_mt_remove(hashtable_mt* table, const void* key)
+{
+    ASSERT(table != NULL);
+
+    const uint64_t hash = table->hash_func(key);
+    pthread_rwlock_t* lock = lock_stripe(table, hash, true);
+    const unsigned mhash = hash % table->size;
+
+    mt_node* node = table->table[mhash];
+    mt_node* prev = NULL;
+    while (node && hash >= node->hash) {
+	if (hash == node->hash && dict_cmp(table->cmp_func, key, node->key) == 0) {
+	    if (prev)
+		prev->next = node->next;
+	    else
+		table->table[mhash] = node->next;
+
+	    if (node->next)
+		node->next->prev = prev;
+
+	    dict_remove_result result = { node->key, node->datum, true };
+	    FREE(node);
+	    __atomic_fetch_sub(&table->count, 1, __ATOMIC_RELAXED);
+	    pthread_rwlock_unlock(lock);
+	    return result;
+	}
+	prev = node;
+	node = node->next;
+    }
+    pthread_rwlock_unlock(lock);
+    return (dict_remove_result) { NULL, NULL, false };
+}
+
+size_t
+hashtable_mt_clear(hashtable_mt* table, dict_delete_func delete_func)
+{
+    ASSERT(table != NULL);
+
+    lock_all(table, true);
+    for (unsigned slot = 0; slot < table->size; slot++) {
+	mt_node* node = table->table[slot];
+	while (node != NULL) {
+	    mt_node* next = node->next;
+	    if (delete_func)
+		delete_func(node->key, node->datum);
+	    FREE(node);
+	    node = next;
+	}
+	table->table[slot] = NULL;
+    }
+
+    const size_t count = table->count;
+    __atomic_store_n(&table->count, 0, __ATOMIC_RELAXED);
+    unlock_all(table);
+    return count;
+}
+
+size_t
+hashtable_mt_traverse(hashtable_mt* table, dict_visit_func visit)
+{
+    ASSERT(table != NULL);
+    ASSERT(visit != NULL);
+
+    lock_all(table, false);
+    size_t count = 0;
+    for (unsigned i = 0; i < table->size; i++)
+	for (mt_node* node = table->table[i]; node; node = node->next) {
+	    ++count;
+	    if (!visit(node->key, node->datum)) {
+		unlock_all(table);
+		return count;
+	    }
+	}
+    unlock_all(table);
+    return count;
+}
+
+size_t
+hashtable_mt_count(const hashtable_mt* table)
+{
+    ASSERT(table != NULL);
+
+    return __atomic_load_n(&table->count, __ATOMIC_RELAXED);
+}
+
+size_t
+hashtable_mt_size(const hashtable_mt* table)
+{
+    ASSERT(table != NULL);
+
+    return load_size(table);
+}
+
+void
+hashtable_mt_get_stats(hashtable_mt* table, dict_stats* stats)
+{
+    ASSERT(table != NULL);
+    ASSERT(stats != NULL);
+
+    memset(stats, 0, sizeof(*stats));
+    /* Exclude writers so the chains can be walked consistently. Operation
+     * counters are not collected for the concurrent table: unsynchronized
+     * increments on the hot paths would race. */
+    lock_all(table, false);
+    stats->count = table->count;
+    stats->table_size = table->size;
+    stats->resize_count = table->resize_count;
+    size_t total_probes = 0;
+    for (unsigned i = 0; i < table->size; i++) {
+	size_t chain = 0;
+	for (const mt_node* node = table->table[i]; node; node = node->next)
+	    total_probes += ++chain;
+	if (stats->max_probe_length < chain)
+	    stats->max_probe_length = chain;
+    }
+    if (stats->count)
+	stats->mean_probe_length = (double)total_probes / (double)stats->count;
+    unlock_all(table);
+}
+
+bool
+hashtable_mt_verify(const hashtable_mt* table)
+{
+    ASSERT(table != NULL);
+
+    hashtable_mt* t = (hashtable_mt*)table;
+    lock_all(t, false);
+    if (table->size % STRIPE_COUNT != 0) {
+	unlock_all(t);
+	VERIFY(table->size % STRIPE_COUNT == 0);
+    }
+    size_t count = 0;
+    for (unsigned slot = 0; slot < table->size; ++slot) {
+	for (mt_node* n = table->table[slot]; n; n = n->next) {
+	    bool ok = (n == table->table[slot]) ?
+		(n->prev == NULL) : (n->prev != NULL && n->prev->next == n);
+	    if (ok && n->next)
+		ok = n->next->prev == n && n->hash <= n->next->hash;
+	    if (ok)
+		ok = n->hash % table->size == slot;
+	    if (!ok) {
+		unlock_all(t);
+		VERIFY(ok);
+	    }
+	    ++count;
+	}
+    }
+    const bool count_ok = count == table->count;
+    unlock_all(t);
+    VERIFY(count_ok);
+    return true;
+}
+
+hashtable_mt_itor*
+hashtable_mt_itor_new(hashtable_mt* table)
+{
+    ASSERT(table != NULL);
+
+    hashtable_mt_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	itor->table = table;
+	itor->node = NULL;
+	itor->slot = 0;
+	itor->locked = false;
+    }
+    return itor;
+}
+
+itor_vtable*
+hashtable_mt_itor_init(hashtable_mt* table, hashtable_mt_itor* itor)
+{
+    ASSERT(table != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(hashtable_mt_itor) <= DICT_ITOR_STATE_MAX,
+		   "hashtable_mt_itor must fit in dict_itor_storage");
+
+    itor->table = table;
+    itor->node = NULL;
+    itor->slot = 0;
+    itor->locked = false;
+    return &hashtable_mt_itor_vtable;
+}
+
+hashtable_mt_itor*
+hashtable_mt_itor_new_locked(hashtable_mt* table)
+{
+    hashtable_mt_itor* itor = hashtable_mt_itor_new(table);
+    if (itor) {
+	lock_all(table, false);
+	itor->locked = true;
+    }
+    return itor;
+}
+
+dict_itor*
+hashtable_mt_dict_itor_new(hashtable_mt* table)
+{
+    ASSERT(table != NULL);
+
+    dict_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	if (!(itor->_itor = hashtable_mt_itor_new(table))) {
+	    FREE(itor);
+	    return NULL;
+	}
+	itor->_vtable = &hashtable_mt_itor_vtable;
+    }
+    return itor;
+}
+
+dict_itor*
+hashtable_mt_dict_itor_new_locked(hashtable_mt* table)
+{
+    ASSERT(table != NULL);
+
+    dict_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	if (!(itor->_itor = hashtable_mt_itor_new_locked(table))) {
+	    FREE(itor);
+	    return NULL;
+	}
+	itor->_vtable = &hashtable_mt_itor_vtable;
+    }
+    return itor;
+}
+
+void
+hashtable_mt_itor_free(hashtable_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (itor->locked)
+	unlock_all(itor->table);
+    FREE(itor);
+}
+
+bool
+hashtable_mt_itor_valid(const hashtable_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return itor->node != NULL;
+}
+
+void
+hashtable_mt_itor_invalidate(hashtable_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    itor->node = NULL;
+    itor->slot = 0;
+}
+
+bool
+hashtable_mt_itor_next(hashtable_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (!itor->node)
+	return hashtable_mt_itor_first(itor);
+
+    if ((itor->node = itor->node->next) != NULL)
+	return true;
+
+    unsigned slot = itor->slot;
+    while (++slot < itor->table->size) {
+	if (itor->table->table[slot]) {
+	    itor->node = itor->table->table[slot];
+	    itor->slot = slot;
+	    return true;
+	}
+    }
+    itor->node = NULL;
+    itor->slot = 0;
+    return false;
+}
+
+bool
+hashtable_mt_itor_prev(hashtable_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (!itor->node)
+	return hashtable_mt_itor_last(itor);
+
+    if ((itor->node = itor->node->prev) != NULL)
+	return true;
+
+    unsigned slot = itor->slot;
+    while (slot > 0) {
+	mt_node* node = itor->table->table[--slot];
+	if (node) {
+	    while (node->next)
+		node = node->next;
+	    itor->node = node;
+	    itor->slot = slot;
+	    return true;
+	}
+    }
+    itor->node = NULL;
+    itor->slot = 0;
+    return false;
+}
+
+bool
+hashtable_mt_itor_nextn(hashtable_mt_itor* itor, size_t count)
+{
+    ASSERT(itor != NULL);
+
+    while (count--)
+	if (!hashtable_mt_itor_next(itor))
+	    return false;
+    return itor->node != NULL;
+}
+
+bool
+hashtable_mt_itor_prevn(hashtable_mt_itor* itor, size_t count)
+{
+    ASSERT(itor != NULL);
+
+    while (count--)
+	if (!hashtable_mt_itor_prev(itor))
+	    return false;
+    return itor->node != NULL;
+}
+
+bool
+hashtable_mt_itor_first(hashtable_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    for (unsigned slot = 0; slot < itor->table->size; ++slot)
+	if (itor->table->table[slot]) {
+	    itor->node = itor->table->table[slot];
+	    itor->slot = slot;
+	    return true;
+	}
+    itor->node = NULL;
+    itor->slot = 0;
+    return false;
+}
+
+bool
+hashtable_mt_itor_last(hashtable_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    for (unsigned slot = itor->table->size; slot > 0;) {
+	mt_node* node = itor->table->table[--slot];
+	if (node) {
+	    while (node->next)
+		node = node->next;
+	    itor->node = node;
+	    itor->slot = slot;
+	    return true;
+	}
+    }
+    itor->node = NULL;
+    itor->slot = 0;
+    return false;
+}
+
+bool
+hashtable_mt_itor_search(hashtable_mt_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    const uint64_t hash = itor->table->hash_func(key);
+    const unsigned mhash = hash % itor->table->size;
+    for (mt_node* node = itor->table->table[mhash];
+	 node && hash >= node->hash; node = node->next) {
+	if (hash == node->hash && dict_cmp(itor->table->cmp_func, key, node->key) == 0) {
+	    itor->node = node;
+	    itor->slot = mhash;
+	    return true;
+	}
+    }
+    itor->node = NULL;
+    itor->slot = 0;
+    return false;
+}
+
+const void*
+hashtable_mt_itor_key(const hashtable_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return itor->node ? itor->node->key : NULL;
+}
+
+void**
+hashtable_mt_itor_datum(hashtable_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return itor->node ? &itor->node->datum : NULL;
+}
@@ -56,9 +56,16 @@ static dict_vtable hb_tree_vtable = {
     (dict_search_func)	    tree_search_gt,
     (dict_remove_func)	    hb_tree_remove,
     (dict_clear_func)	    tree_clear,
+    (dict_clear_parallel_func) tree_clear_parallel,
     (dict_traverse_func)    tree_traverse,
     (dict_count_func)	    tree_count,
     (dict_verify_func)	    hb_tree_verify,
+    (dict_search_batch_func) tree_search_batch,
+    (dict_traverse_range_func) tree_traverse_range,
+    (dict_iinit_func)	    hb_itor_init,
+    (dict_get_stats_func)   tree_get_stats,
+    (dict_clone_func)	    hb_tree_clone,
+    (dict_merge_func)	    hb_tree_merge,
 };
 
 static itor_vtable hb_tree_itor_vtable = {
@@ -100,6 +107,7 @@ hb_tree_new(dict_compare_func cmp_func)
 	tree->count = 0;
 	tree->cmp_func = cmp_func;
 	tree->rotation_count = 0;
+	STATS_RESET(tree);
     }
     return tree;
 }
@@ -118,6 +126,96 @@ hb_dict_new(dict_compare_func cmp_func)
     return dct;
 }
 
+static void
+free_subtree(hb_node* node)
+{
+    if (node) {
+	free_subtree(node->llink);
+	free_subtree(node->rlink);
+	FREE(node);
+    }
+}
+
+static hb_node*
+from_sorted_build(void* const* keys, void* const* datums, size_t n,
+		  unsigned* height)
+{
+    if (!n) {
+	*height = 0;
+	return NULL;
+    }
+    const size_t mid = n / 2;
+    hb_node* node = node_new(keys[mid]);
+    if (!node)
+	return NULL;
+    if (datums)
+	node->datum = datums[mid];
+    unsigned lheight, rheight;
+    node->llink = from_sorted_build(keys, datums, mid, &lheight);
+    node->rlink = from_sorted_build(keys + mid + 1,
+				    datums ? datums + mid + 1 : NULL,
+				    n - mid - 1, &rheight);
+    if ((mid && !node->llink) || (n - mid - 1 && !node->rlink)) {
+	free_subtree(node);
+	return NULL;
+    }
+    if (node->llink)
+	node->llink->parent = node;
+    if (node->rlink)
+	node->rlink->parent = node;
+    node->bal = (signed char)((int)rheight - (int)lheight);
+    *height = MAX(lheight, rheight) + 1;
+    return node;
+}
+
+hb_tree*
+hb_tree_from_sorted(dict_compare_func cmp_func, void* const* keys,
+		    void* const* datums, size_t nkeys)
+{
+    hb_tree* tree = hb_tree_new(cmp_func);
+    if (tree && nkeys) {
+	unsigned height;
+	if (!(tree->root = from_sorted_build(keys, datums, nkeys, &height))) {
+	    FREE(tree);
+	    return NULL;
+	}
+	tree->count = nkeys;
+    }
+    return tree;
+}
+
+dict*
+hb_dict_from_sorted(dict_compare_func cmp_func, void* const* keys,
+		    void* const* datums, size_t nkeys)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = hb_tree_from_sorted(cmp_func, keys, datums, nkeys))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &hb_tree_vtable;
+    }
+    return dct;
+}
+
+static void*
+merge_rebuild(void* tree, void* const* keys, void* const* datums, size_t n)
+{
+    (void)tree;
+    unsigned height;
+    return from_sorted_build(keys, datums, n, &height);
+}
+
+size_t
+hb_tree_merge(hb_tree* tree, hb_tree* src)
+{
+    ASSERT(tree != NULL);
+    ASSERT(src != NULL);
+
+    return tree_merge(tree, src, merge_rebuild);
+}
+
 size_t
 hb_tree_free(hb_tree* tree, dict_delete_func delete_func)
 {
@@ -128,6 +226,14 @@ hb_tree_free(hb_tree* tree, dict_delete_func delete_func)
     return count;
 }
 
+hb_tree*
+hb_tree_clone(hb_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    return tree_clone(tree, sizeof(*tree), sizeof(hb_node));
+}
+
 size_t
 hb_tree_clear(hb_tree* tree, dict_delete_func delete_func)
 {
@@ -177,13 +283,14 @@ dict_insert_result
 hb_tree_insert(hb_tree* tree, void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, insert_count);
 
     int cmp = 0;
     hb_node* node = tree->root;
     hb_node* parent = NULL;
     hb_node* q = NULL;
     while (node) {
-	cmp = tree->cmp_func(key, node->key);
+	cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    parent = node, node = node->llink;
 	else if (cmp)
@@ -308,11 +415,12 @@ dict_remove_result
 hb_tree_remove(hb_tree* tree, const void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, remove_count);
 
     hb_node* node = tree->root;
     hb_node* parent = NULL;
     while (node) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    parent = node, node = node->llink;
 	else if (cmp)
@@ -639,6 +747,19 @@ hb_itor_new(hb_tree* tree)
     return itor;
 }
 
+itor_vtable*
+hb_itor_init(hb_tree* tree, hb_itor* itor)
+{
+    ASSERT(tree != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(hb_itor) <= DICT_ITOR_STATE_MAX,
+		   "hb_itor must fit in dict_itor_storage");
+
+    itor->tree = tree;
+    itor->node = NULL;
+    return &hb_tree_itor_vtable;
+}
+
 dict_itor*
 hb_dict_itor_new(hb_tree* tree)
 {
@@ -0,0 +1,145 @@
+/*
+ * libdict -- fixed-size node allocator implementation.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "node_pool.h"
+
+#include <stddef.h>	/* For max_align_t */
+#include "dict_private.h"
+
+/* Aim for chunks of roughly this many bytes, header included. */
+#define CHUNK_TARGET_SIZE   65536
+
+typedef union pool_chunk pool_chunk;
+union pool_chunk {
+    pool_chunk*		    next;
+    max_align_t		    align;	/* Align the nodes that follow. */
+};
+
+struct node_pool {
+    pool_chunk*		    chunks;
+    void*		    free_list;	/* Deallocated nodes, linked in place. */
+    char*		    bump;	/* Next unused node in newest chunk. */
+    char*		    bump_end;
+    size_t		    node_size;
+    size_t		    align;
+    size_t		    nodes_per_chunk;
+};
+
+node_pool*
+node_pool_new(size_t node_size)
+{
+    /* Keep nodes aligned at least as strictly as malloc would. */
+    return node_pool_new_aligned(node_size, sizeof(max_align_t));
+}
+
+node_pool*
+node_pool_new_aligned(size_t node_size, size_t align)
+{
+    ASSERT(node_size != 0);
+    ASSERT(align != 0 && (align & (align - 1)) == 0);
+
+    node_pool* pool = MALLOC(sizeof(*pool));
+    if (pool) {
+	if (align < sizeof(max_align_t))
+	    align = sizeof(max_align_t);
+	if (node_size < sizeof(void*))
+	    node_size = sizeof(void*);
+	/* Rounding the stride up keeps every node, not just the first, on an
+	 * |align| boundary. */
+	node_size = (node_size + align - 1) & ~(align - 1);
+	pool->chunks = NULL;
+	pool->free_list = NULL;
+	pool->bump = pool->bump_end = NULL;
+	pool->node_size = node_size;
+	pool->align = align;
+	pool->nodes_per_chunk =
+	    (CHUNK_TARGET_SIZE - sizeof(pool_chunk) - (align - 1)) / node_size;
+	if (pool->nodes_per_chunk < 1)
+	    pool->nodes_per_chunk = 1;
+    }
+    return pool;
+}
+
+void
+node_pool_free(node_pool* pool)
+{
+    ASSERT(pool != NULL);
+
+    node_pool_clear(pool);
+    FREE(pool);
+}
+
+void*
+node_pool_alloc(node_pool* pool)
+{
+    ASSERT(pool != NULL);
+
+    if (pool->free_list) {
+	void* node = pool->free_list;
+	pool->free_list = *(void**)node;
+	return node;
+    }
+    if (pool->bump == pool->bump_end) {
+	pool_chunk* chunk = MALLOC(sizeof(pool_chunk) + (pool->align - 1) +
+				   pool->node_size * pool->nodes_per_chunk);
+	if (!chunk)
+	    return NULL;
+	chunk->next = pool->chunks;
+	pool->chunks = chunk;
+	pool->bump = (char*)(((uintptr_t)(chunk + 1) + pool->align - 1) &
+			     ~(uintptr_t)(pool->align - 1));
+	pool->bump_end = pool->bump + pool->node_size * pool->nodes_per_chunk;
+    }
+    void* node = pool->bump;
+    pool->bump += pool->node_size;
+    return node;
+}
+
+void
+node_pool_dealloc(node_pool* pool, void* node)
+{
+    ASSERT(pool != NULL);
+    ASSERT(node != NULL);
+
+    *(void**)node = pool->free_list;
+    pool->free_list = node;
+}
+
+void
+node_pool_clear(node_pool* pool)
+{
+    ASSERT(pool != NULL);
+
+    for (pool_chunk* chunk = pool->chunks; chunk;) {
+	pool_chunk* next = chunk->next;
+	FREE(chunk);
+	chunk = next;
+    }
+    pool->chunks = NULL;
+    pool->free_list = NULL;
+    pool->bump = pool->bump_end = NULL;
+}
@@ -61,9 +61,16 @@ static dict_vtable pr_tree_vtable = {
     (dict_search_func)	    tree_search_gt,
     (dict_remove_func)	    pr_tree_remove,
     (dict_clear_func)	    tree_clear,
+    (dict_clear_parallel_func) tree_clear_parallel,
     (dict_traverse_func)    tree_traverse,
     (dict_count_func)	    tree_count,
     (dict_verify_func)	    pr_tree_verify,
+    (dict_search_batch_func) tree_search_batch,
+    (dict_traverse_range_func) tree_traverse_range,
+    (dict_iinit_func)	    pr_itor_init,
+    (dict_get_stats_func)   tree_get_stats,
+    (dict_clone_func)	    pr_tree_clone,
+    (dict_merge_func)	    pr_tree_merge,
 };
 
 static itor_vtable pr_tree_itor_vtable = {
@@ -106,6 +113,7 @@ pr_tree_new(dict_compare_func cmp_func)
 	tree->count = 0;
 	tree->cmp_func = cmp_func;
 	tree->rotation_count = 0;
+	STATS_RESET(tree);
     }
     return tree;
 }
@@ -124,6 +132,89 @@ pr_dict_new(dict_compare_func cmp_func)
     return dct;
 }
 
+static void
+free_subtree(pr_node* node)
+{
+    if (node) {
+	free_subtree(node->llink);
+	free_subtree(node->rlink);
+	FREE(node);
+    }
+}
+
+static pr_node*
+from_sorted_build(void* const* keys, void* const* datums, size_t n)
+{
+    if (!n)
+	return NULL;
+    const size_t mid = n / 2;
+    pr_node* node = node_new(keys[mid]);
+    if (!node)
+	return NULL;
+    if (datums)
+	node->datum = datums[mid];
+    node->llink = from_sorted_build(keys, datums, mid);
+    node->rlink = from_sorted_build(keys + mid + 1,
+				    datums ? datums + mid + 1 : NULL,
+				    n - mid - 1);
+    if ((mid && !node->llink) || (n - mid - 1 && !node->rlink)) {
+	free_subtree(node);
+	return NULL;
+    }
+    if (node->llink)
+	node->llink->parent = node;
+    if (node->rlink)
+	node->rlink->parent = node;
+    node->weight = WEIGHT(node->llink) + WEIGHT(node->rlink);
+    return node;
+}
+
+pr_tree*
+pr_tree_from_sorted(dict_compare_func cmp_func, void* const* keys,
+		    void* const* datums, size_t nkeys)
+{
+    pr_tree* tree = pr_tree_new(cmp_func);
+    if (tree && nkeys) {
+	if (!(tree->root = from_sorted_build(keys, datums, nkeys))) {
+	    FREE(tree);
+	    return NULL;
+	}
+	tree->count = nkeys;
+    }
+    return tree;
+}
+
+dict*
+pr_dict_from_sorted(dict_compare_func cmp_func, void* const* keys,
+		    void* const* datums, size_t nkeys)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = pr_tree_from_sorted(cmp_func, keys, datums, nkeys))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &pr_tree_vtable;
+    }
+    return dct;
+}
+
+static void*
+merge_rebuild(void* tree, void* const* keys, void* const* datums, size_t n)
+{
+    (void)tree;
+    return from_sorted_build(keys, datums, n);
+}
+
+size_t
+pr_tree_merge(pr_tree* tree, pr_tree* src)
+{
+    ASSERT(tree != NULL);
+    ASSERT(src != NULL);
+
+    return tree_merge(tree, src, merge_rebuild);
+}
+
 size_t
 pr_tree_free(pr_tree* tree, dict_delete_func delete_func)
 {
@@ -134,6 +225,14 @@ pr_tree_free(pr_tree* tree, dict_delete_func delete_func)
     return count;
 }
 
+pr_tree*
+pr_tree_clone(pr_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    return tree_clone(tree, sizeof(*tree), sizeof(pr_node));
+}
+
 void**
 pr_tree_search(pr_tree* tree, const void* key)
 {
@@ -277,12 +376,13 @@ dict_insert_result
 pr_tree_insert(pr_tree* tree, void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, insert_count);
 
     int cmp = 0;
     pr_node* node = tree->root;
     pr_node* parent = NULL;
     while (node) {
-	cmp = tree->cmp_func(key, node->key);
+	cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    parent = node, node = node->llink;
 	else if (cmp)
@@ -320,11 +420,12 @@ dict_remove_result
 pr_tree_remove(pr_tree* tree, const void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, remove_count);
     ASSERT(key != NULL);
 
     pr_node* node = tree->root;
     while (node) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0) {
 	    node = node->llink;
 	} else if (cmp) {
@@ -635,6 +736,19 @@ pr_itor_new(pr_tree* tree)
     return itor;
 }
 
+itor_vtable*
+pr_itor_init(pr_tree* tree, pr_itor* itor)
+{
+    ASSERT(tree != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(pr_itor) <= DICT_ITOR_STATE_MAX,
+		   "pr_itor must fit in dict_itor_storage");
+
+    itor->tree = tree;
+    itor->node = NULL;
+    return &pr_tree_itor_vtable;
+}
+
 dict_itor*
 pr_dict_itor_new(pr_tree* tree)
 {
@@ -33,8 +33,14 @@
 
 #include <string.h>
 #include "dict_private.h"
+#include "node_pool.h"
 #include "tree_common.h"
 
+/* The node color lives in the low bit of rlink, so a node is exactly five
+ * pointers — eight 40-byte nodes fit in five cache lines instead of six.
+ * The tag relies on nodes being at least 2-byte aligned, which both malloc
+ * and node_pool guarantee; node_new checks it. Access rlink and the color
+ * only through the macros below. */
 typedef struct rb_node rb_node;
 struct rb_node {
     void*	    key;
@@ -46,6 +52,8 @@ struct rb_node {
 	rb_node*    rlink;
     };
 };
+_Static_assert(sizeof(rb_node) == 5 * sizeof(void*),
+	       "rb_node must stay five pointers; keep the color packed in rlink");
 
 #define RB_RED		    0
 #define RB_BLACK	    1
@@ -59,6 +67,7 @@ struct rb_node {
 
 struct rb_tree {
     TREE_FIELDS(rb_node);
+    node_pool*		    pool;	/* Optional node allocator. */
 };
 
 struct rb_itor {
@@ -76,9 +85,16 @@ static dict_vtable rb_tree_vtable = {
     (dict_search_func)	    rb_tree_search_gt,
     (dict_remove_func)	    rb_tree_remove,
     (dict_clear_func)	    rb_tree_clear,
+    (dict_clear_parallel_func) NULL,/* clear_parallel: not implemented */
     (dict_traverse_func)    rb_tree_traverse,
     (dict_count_func)	    tree_count,
     (dict_verify_func)	    rb_tree_verify,
+    (dict_search_batch_func) rb_tree_search_batch,
+    (dict_traverse_range_func) rb_tree_traverse_range,
+    (dict_iinit_func)	    rb_itor_init,
+    (dict_get_stats_func)   rb_tree_get_stats,
+    (dict_clone_func)	    rb_tree_clone,
+    (dict_merge_func)	    rb_tree_merge,
 };
 
 static itor_vtable rb_tree_itor_vtable = {
@@ -112,7 +128,8 @@ static unsigned	delete_fixup(rb_tree* tree, rb_node* node);
 static size_t	node_height(const rb_node* node);
 static size_t	node_mheight(const rb_node* node);
 static size_t	node_pathlen(const rb_node* node, size_t level);
-static rb_node*	node_new(void* key);
+static rb_node*	node_new(rb_tree* tree, void* key);
+static void	node_free(rb_tree* tree, rb_node* node);
 static rb_node*	node_next(rb_node* node);
 static rb_node*	node_prev(rb_node* node);
 static rb_node*	node_max(rb_node* node);
@@ -129,6 +146,8 @@ rb_tree_new(dict_compare_func cmp_func)
 	tree->count = 0;
 	tree->cmp_func = cmp_func;
 	tree->rotation_count = 0;
+	STATS_RESET(tree);
+	tree->pool = NULL;
     }
     return tree;
 }
@@ -147,23 +166,298 @@ rb_dict_new(dict_compare_func cmp_func)
     return dct;
 }
 
+rb_tree*
+rb_tree_new_pooled(dict_compare_func cmp_func)
+{
+    rb_tree* tree = rb_tree_new(cmp_func);
+    if (tree) {
+	if (!(tree->pool = node_pool_new(sizeof(rb_node)))) {
+	    FREE(tree);
+	    return NULL;
+	}
+    }
+    return tree;
+}
+
+dict*
+rb_dict_new_pooled(dict_compare_func cmp_func)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = rb_tree_new_pooled(cmp_func))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &rb_tree_vtable;
+    }
+    return dct;
+}
+
+static void
+free_subtree(rb_tree* tree, rb_node* node)
+{
+    if (node != RB_NULL) {
+	free_subtree(tree, node->llink);
+	free_subtree(tree, RLINK(node));
+	node_free(tree, node);
+    }
+}
+
+static rb_node*
+from_sorted_build(rb_tree* tree, void* const* keys, void* const* datums,
+		  size_t n, unsigned depth, unsigned red_depth)
+{
+    if (!n)
+	return RB_NULL;
+    const size_t mid = n / 2;
+    rb_node* node = node_new(tree, keys[mid]);
+    if (!node)
+	return NULL;
+    if (datums)
+	node->datum = datums[mid];
+    /* Only the nodes on the bottom level are red; all paths to a leaf then
+     * pass the same number of black nodes. */
+    if (depth < red_depth)
+	SET_BLACK(node);
+    rb_node* l = from_sorted_build(tree, keys, datums, mid,
+				   depth + 1, red_depth);
+    rb_node* r = from_sorted_build(tree, keys + mid + 1,
+				   datums ? datums + mid + 1 : NULL,
+				   n - mid - 1, depth + 1, red_depth);
+    if (!l || !r) {
+	if (l && l != RB_NULL)
+	    free_subtree(tree, l);
+	if (r && r != RB_NULL)
+	    free_subtree(tree, r);
+	node_free(tree, node);
+	return NULL;
+    }
+    node->llink = l;
+    SET_RLINK(node, r);
+    if (l != RB_NULL)
+	l->parent = node;
+    if (r != RB_NULL)
+	r->parent = node;
+    return node;
+}
+
+rb_tree*
+rb_tree_from_sorted(dict_compare_func cmp_func, void* const* keys,
+		    void* const* datums, size_t nkeys)
+{
+    rb_tree* tree = rb_tree_new(cmp_func);
+    if (tree && nkeys) {
+	unsigned red_depth = 0;
+	for (size_t m = nkeys; m; m >>= 1)
+	    red_depth++;    /* Bottom level of the tree: floor(log2 n) + 1. */
+	tree->root = from_sorted_build(tree, keys, datums, nkeys, 1, red_depth);
+	if (!tree->root) {
+	    FREE(tree);
+	    return NULL;
+	}
+	SET_BLACK(tree->root);
+	tree->count = nkeys;
+    }
+    return tree;
+}
+
+dict*
+rb_dict_from_sorted(dict_compare_func cmp_func, void* const* keys,
+		    void* const* datums, size_t nkeys)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = rb_tree_from_sorted(cmp_func, keys, datums, nkeys))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &rb_tree_vtable;
+    }
+    return dct;
+}
+
+static void
+merge_snapshot(const rb_tree* tree, void** keys, void** datums)
+{
+    size_t i = 0;
+    if (tree->root != RB_NULL)
+	for (rb_node* node = node_min(tree->root); node != RB_NULL;
+	     node = node_next(node)) {
+	    keys[i] = node->key;
+	    datums[i] = node->datum;
+	    ++i;
+	}
+    ASSERT(i == tree->count);
+}
+
+static rb_node*
+merge_rebuild(rb_tree* tree, void* const* keys, void* const* datums, size_t n)
+{
+    unsigned red_depth = 0;
+    for (size_t m = n; m; m >>= 1)
+	red_depth++;
+    rb_node* root = from_sorted_build(tree, keys, datums, n, 1, red_depth);
+    if (root)
+	SET_BLACK(root);
+    return root;
+}
+
+size_t
+rb_tree_merge(rb_tree* tree, rb_tree* src)
+{
+    ASSERT(tree != NULL);
+    ASSERT(src != NULL);
+
+    /* The rebuild below frees every old node; for a pooled tree that would
+     * only grow the pool, so leave those to the generic fallback. */
+    if (tree->pool || src->pool || tree->cmp_func != src->cmp_func)
+	return DICT_MERGE_INCOMPATIBLE;
+    if (src->count == 0)
+	return 0;
+    /* In-order snapshots of both sides, plus room for the merged sequence.
+     * Until the rebuilds below have both succeeded neither tree is touched,
+     * so every failure exit can leave the merge to the generic fallback. */
+    const size_t n = tree->count;
+    const size_t m = src->count;
+    void** mem = MALLOC(4 * (n + m) * sizeof(void*));
+    if (!mem)
+	return DICT_MERGE_INCOMPATIBLE;
+    void** tkeys = mem;  void** tdata = tkeys + n;
+    void** skeys = tdata + n;  void** sdata = skeys + m;
+    void** mkeys = sdata + m;  void** mdata = mkeys + n + m;
+    merge_snapshot(tree, tkeys, tdata);
+    merge_snapshot(src, skeys, sdata);
+    /* Entries whose key |tree| already holds stay behind in |src|; compact
+     * them onto the front of the source snapshot, which never overtakes the
+     * read cursor. */
+    size_t i = 0, j = 0, k = 0, dups = 0;
+    while (i < n && j < m) {
+	const int cmp = dict_cmp(tree->cmp_func, tkeys[i], skeys[j]);
+	if (cmp > 0) {
+	    mkeys[k] = skeys[j];
+	    mdata[k] = sdata[j];
+	    ++j;
+	} else {
+	    if (cmp == 0) {
+		skeys[dups] = skeys[j];
+		sdata[dups] = sdata[j];
+		++dups, ++j;
+	    }
+	    mkeys[k] = tkeys[i];
+	    mdata[k] = tdata[i];
+	    ++i;
+	}
+	++k;
+    }
+    for (; i < n; ++i, ++k) {
+	mkeys[k] = tkeys[i];
+	mdata[k] = tdata[i];
+    }
+    for (; j < m; ++j, ++k) {
+	mkeys[k] = skeys[j];
+	mdata[k] = sdata[j];
+    }
+    rb_node* troot = merge_rebuild(tree, mkeys, mdata, k);
+    if (!troot) {
+	FREE(mem);
+	return DICT_MERGE_INCOMPATIBLE;
+    }
+    rb_node* sroot = RB_NULL;
+    if (dups && !(sroot = merge_rebuild(src, skeys, sdata, dups))) {
+	free_subtree(tree, troot);
+	FREE(mem);
+	return DICT_MERGE_INCOMPATIBLE;
+    }
+    free_subtree(tree, tree->root);
+    tree->root = troot;
+    tree->count = k;
+    free_subtree(src, src->root);
+    src->root = sroot;
+    src->count = dups;
+    FREE(mem);
+    return m - dups;
+}
+
 size_t
 rb_tree_free(rb_tree* tree, dict_delete_func delete_func)
 {
     ASSERT(tree != NULL);
 
     size_t count = rb_tree_clear(tree, delete_func);
+    if (tree->pool)
+	node_pool_free(tree->pool);
     FREE(tree);
     return count;
 }
 
+rb_tree*
+rb_tree_clone(rb_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    rb_tree* clone = tree->pool ? rb_tree_new_pooled(tree->cmp_func) :
+				  rb_tree_new(tree->cmp_func);
+    if (!clone)
+	return NULL;
+    clone->count = tree->count;
+    clone->rotation_count = tree->rotation_count;
+    if (tree->root == RB_NULL)
+	return clone;
+
+    rb_node* c = node_new(clone, tree->root->key);
+    if (!c) {
+	rb_tree_free(clone, NULL);
+	return NULL;
+    }
+    c->datum = tree->root->datum;
+    if (COLOR(tree->root) == RB_BLACK)
+	SET_BLACK(c);
+    clone->root = c;
+
+    /* Copy in preorder, backing out of finished subtrees through the parent
+     * pointers; an RB_NULL child in the copy marks a subtree not yet
+     * visited. The generic tree_clone cannot be used here because the node
+     * color lives in the low bit of rlink. */
+    const rb_node* o = tree->root;
+    for (;;) {
+	const rb_node* next;
+	if (o->llink != RB_NULL && c->llink == RB_NULL) {
+	    next = o->llink;
+	} else if (RLINK(o) != RB_NULL && RLINK(c) == RB_NULL) {
+	    next = RLINK(o);
+	} else if (o == tree->root) {
+	    break;
+	} else {
+	    o = o->parent;
+	    c = c->parent;
+	    continue;
+	}
+	rb_node* n = node_new(clone, next->key);
+	if (!n) {
+	    rb_tree_free(clone, NULL);
+	    return NULL;
+	}
+	n->datum = next->datum;
+	n->parent = c;
+	if (COLOR(next) == RB_BLACK)
+	    SET_BLACK(n);
+	if (next == o->llink)
+	    c->llink = n;
+	else
+	    SET_RLINK(c, n);
+	o = next;
+	c = n;
+    }
+    return clone;
+}
+
 static rb_node*
 rb_tree_search_node(rb_tree* tree, const void* key)
 {
     ASSERT(tree != NULL);
     rb_node* node = tree->root;
     while (node != RB_NULL) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    node = node->llink;
 	else if (cmp)
@@ -178,11 +472,51 @@ void**
 rb_tree_search(rb_tree* tree, const void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, search_count);
 
     rb_node* node = rb_tree_search_node(tree, key);
     return (node != RB_NULL) ? &node->datum : NULL;
 }
 
+/* Number of lookups whose tree descents are interleaved by
+ * rb_tree_search_batch, so that their memory accesses can overlap. */
+#define BATCH_WIDTH 8
+
+size_t
+rb_tree_search_batch(rb_tree* tree, const void* const* keys, size_t nkeys, void*** results)
+{
+    ASSERT(tree != NULL);
+
+    size_t found = 0;
+    for (size_t i = 0; i < nkeys; i += BATCH_WIDTH) {
+	const size_t n = MIN(nkeys - i, (size_t)BATCH_WIDTH);
+	rb_node* node[BATCH_WIDTH];
+	for (size_t j = 0; j < n; ++j) {
+	    results[i + j] = NULL;
+	    node[j] = tree->root;
+	}
+	/* Advance every descent one level per round; by the time a lookup
+	 * comes around again its prefetched node has usually arrived. */
+	for (bool active = (tree->root != RB_NULL); active;) {
+	    active = false;
+	    for (size_t j = 0; j < n; ++j) {
+		if (node[j] == RB_NULL)
+		    continue;
+		int cmp = dict_cmp(tree->cmp_func, keys[i + j], node[j]->key);
+		if (cmp == 0) {
+		    results[i + j] = &node[j]->datum;
+		    ++found;
+		    node[j] = RB_NULL;
+		} else if ((node[j] = cmp < 0 ? node[j]->llink : RLINK(node[j])) != RB_NULL) {
+		    PREFETCH(node[j]);
+		    active = true;
+		}
+	    }
+	}
+    }
+    return found;
+}
+
 static rb_node*
 rb_tree_search_le_node(rb_tree* tree, const void* key)
 {
@@ -190,7 +524,7 @@ rb_tree_search_le_node(rb_tree* tree, const void* key)
 
     rb_node* node = tree->root, *ret = RB_NULL;
     while (node != RB_NULL) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp == 0) {
 	    return node;
 	} else if (cmp < 0) {
@@ -219,7 +553,7 @@ rb_tree_search_lt_node(rb_tree* tree, const void* key)
 
     rb_node* node = tree->root, *ret = RB_NULL;
     while (node != RB_NULL) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp <= 0) {
 	    node = node->llink;
 	} else {
@@ -246,7 +580,7 @@ rb_tree_search_ge_node(rb_tree* tree, const void* key)
 
     rb_node* node = tree->root, *ret = RB_NULL;
     while (node != RB_NULL) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp == 0) {
 	    return node;
 	}
@@ -276,7 +610,7 @@ rb_tree_search_gt_node(rb_tree* tree, const void* key)
 
     rb_node* node = tree->root, *ret = RB_NULL;
     while (node != RB_NULL) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0) {
 	    ret = node;
 	    node = node->llink;
@@ -299,12 +633,13 @@ dict_insert_result
 rb_tree_insert(rb_tree* tree, void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, insert_count);
 
     int cmp = 0;	/* Quell GCC warning about uninitialized usage. */
     rb_node* node = tree->root;
     rb_node* parent = RB_NULL;
     while (node != RB_NULL) {
-	cmp = tree->cmp_func(key, node->key);
+	cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    parent = node, node = node->llink;
 	else if (cmp)
@@ -313,7 +648,7 @@ rb_tree_insert(rb_tree* tree, void* key)
 	    return (dict_insert_result) { &node->datum, false };
     }
 
-    if (!(node = node_new(key)))
+    if (!(node = node_new(tree, key)))
 	return (dict_insert_result) { NULL, false };
 
     if ((node->parent = parent) == RB_NULL) {
@@ -394,10 +729,11 @@ dict_remove_result
 rb_tree_remove(rb_tree* tree, const void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, remove_count);
 
     rb_node* node = tree->root;
     while (node != RB_NULL) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    node = node->llink;
 	else if (cmp)
@@ -434,7 +770,7 @@ rb_tree_remove(rb_tree* tree, const void* key)
     if (COLOR(out) == RB_BLACK)
 	tree->rotation_count += delete_fixup(tree, temp);
     dict_remove_result result = { out->key, out->datum, true };
-    FREE(out);
+    node_free(tree, out);
     tree->count--;
     return result;
 }
@@ -522,6 +858,19 @@ rb_tree_clear(rb_tree* tree, dict_delete_func delete_func)
     ASSERT(tree != NULL);
 
     const size_t count = tree->count;
+    if (tree->pool) {
+	/* The pool releases every node at once; only walk the tree if the
+	 * caller needs to see each key and datum. */
+	if (delete_func && tree->root != RB_NULL) {
+	    for (rb_node* node = node_min(tree->root); node != RB_NULL;
+		 node = node_next(node))
+		delete_func(node->key, node->datum);
+	}
+	node_pool_clear(tree->pool);
+	tree->root = RB_NULL;
+	tree->count = 0;
+	return count;
+    }
     rb_node* node = tree->root;
     while (node != RB_NULL) {
 	if (node->llink != RB_NULL) {
@@ -577,6 +926,23 @@ rb_tree_mheight(const rb_tree* tree)
     return tree->root != RB_NULL ? node_mheight(tree->root) : 0;
 }
 
+void
+rb_tree_get_stats(rb_tree* tree, dict_stats* stats)
+{
+    ASSERT(tree != NULL);
+    ASSERT(stats != NULL);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = tree->count;
+    stats->rotation_count = tree->rotation_count;
+    if (tree->root != RB_NULL) {
+	/* Heights count edges; leaf depths are one-based. */
+	stats->min_leaf_depth = node_mheight(tree->root) + 1;
+	stats->max_leaf_depth = node_height(tree->root) + 1;
+    }
+    STATS_EXPORT(tree, stats);
+}
+
 size_t
 rb_tree_pathlen(const rb_tree* tree)
 {
@@ -632,6 +998,43 @@ rb_tree_traverse(rb_tree* tree, dict_visit_func visit)
     return count;
 }
 
+static bool
+node_traverse_range(rb_tree* tree, rb_node* node, const void* lo,
+		    const void* hi, dict_visit_func visit, size_t* count)
+{
+    if (lo && dict_cmp(tree->cmp_func, lo, node->key) > 0) {
+	/* The node and everything in its left subtree precede the range. */
+	return RLINK(node) == RB_NULL ||
+	    node_traverse_range(tree, RLINK(node), lo, hi, visit, count);
+    }
+    if (hi && dict_cmp(tree->cmp_func, hi, node->key) < 0) {
+	/* The node and everything in its right subtree follow the range. */
+	return node->llink == RB_NULL ||
+	    node_traverse_range(tree, node->llink, lo, hi, visit, count);
+    }
+    if (node->llink != RB_NULL &&
+	!node_traverse_range(tree, node->llink, lo, hi, visit, count))
+	return false;
+    ++*count;
+    if (!visit(node->key, node->datum))
+	return false;
+    return RLINK(node) == RB_NULL ||
+	node_traverse_range(tree, RLINK(node), lo, hi, visit, count);
+}
+
+size_t
+rb_tree_traverse_range(rb_tree* tree, const void* lo, const void* hi,
+		       dict_visit_func visit)
+{
+    ASSERT(tree != NULL);
+    ASSERT(visit != NULL);
+
+    size_t count = 0;
+    if (tree->root != RB_NULL)
+	node_traverse_range(tree, tree->root, lo, hi, visit, &count);
+    return count;
+}
+
 static size_t
 node_height(const rb_node* node)
 {
@@ -710,9 +1113,10 @@ rot_right(rb_tree* tree, rb_node* node)
 }
 
 static rb_node*
-node_new(void* key)
+node_new(rb_tree* tree, void* key)
 {
-    rb_node* node = MALLOC(sizeof(*node));
+    rb_node* node = tree->pool ?
+	node_pool_alloc(tree->pool) : MALLOC(sizeof(*node));
     if (node) {
 	ASSERT((((intptr_t)node) & 1) == 0); /* Ensure malloc returns aligned result. */
 	node->key = key;
@@ -725,6 +1129,15 @@ node_new(void* key)
     return node;
 }
 
+static void
+node_free(rb_tree* tree, rb_node* node)
+{
+    if (tree->pool)
+	node_pool_dealloc(tree->pool, node);
+    else
+	FREE(node);
+}
+
 static rb_node*
 node_next(rb_node* node)
 {
@@ -839,6 +1252,19 @@ rb_itor_new(rb_tree* tree)
     return itor;
 }
 
+itor_vtable*
+rb_itor_init(rb_tree* tree, rb_itor* itor)
+{
+    ASSERT(tree != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(rb_itor) <= DICT_ITOR_STATE_MAX,
+		   "rb_itor must fit in dict_itor_storage");
+
+    itor->tree = tree;
+    itor->node = RB_NULL;
+    return &rb_tree_itor_vtable;
+}
+
 dict_itor*
 rb_dict_itor_new(rb_tree* tree)
 {
@@ -888,7 +1314,13 @@ rb_itor_next(rb_itor* itor)
 	rb_itor_first(itor);
     else
 	itor->node = node_next(itor->node);
-    return itor->node != RB_NULL;
+    if (itor->node != RB_NULL) {
+	/* Warm the lines the following advance dereferences first. */
+	PREFETCH(RLINK(itor->node));
+	PREFETCH(itor->node->parent);
+	return true;
+    }
+    return false;
 }
 
 bool
@@ -900,7 +1332,12 @@ rb_itor_prev(rb_itor* itor)
 	rb_itor_last(itor);
     else
 	itor->node = node_prev(itor->node);
-    return itor->node != RB_NULL;
+    if (itor->node != RB_NULL) {
+	PREFETCH(itor->node->llink);
+	PREFETCH(itor->node->parent);
+	return true;
+    }
+    return false;
 }
 
 bool
@@ -956,7 +1393,7 @@ rb_itor_search(rb_itor* itor, const void* key)
 
     rb_node* node = itor->tree->root;
     while (node != RB_NULL) {
-	int cmp = itor->tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(itor->tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    node = node->llink;
 	else if (cmp)
@@ -33,6 +33,7 @@
 
 #include <string.h>	    /* For memset() */
 #include "dict_private.h"
+#include "node_pool.h"
 
 typedef struct skip_node skip_node;
 
@@ -46,12 +47,20 @@ struct skip_node {
 
 #define MAX_LINK	    32
 
+/* Pooled nodes are segregated by link count into slabs aligned and sized in
+ * cache lines, so the towers walked during a descent sit packed together
+ * instead of one per heap allocation. */
+#define CACHELINE	    64
+
 struct skiplist {
+    OP_COUNTERS
     skip_node*		    head;
     unsigned		    max_link;
     unsigned		    top_link;
     dict_compare_func	    cmp_func;
     size_t		    count;
+    node_pool**		    pools;	/* One pool per link count, or NULL. */
+    uint64_t		    rand_state;	/* Private level generator state. */
 };
 
 struct skiplist_itor {
@@ -70,9 +79,16 @@ static dict_vtable skiplist_vtable = {
     (dict_search_func)	    NULL,/* TODO: implement search_gt */
     (dict_remove_func)	    skiplist_remove,
     (dict_clear_func)	    skiplist_clear,
+    (dict_clear_parallel_func) NULL,/* clear_parallel: not implemented */
     (dict_traverse_func)    skiplist_traverse,
     (dict_count_func)	    skiplist_count,
     (dict_verify_func)	    skiplist_verify,
+    (dict_search_batch_func) NULL,/* search_batch: generic fallback */
+    (dict_traverse_range_func) skiplist_traverse_range,
+    (dict_iinit_func)	    skiplist_itor_init,
+    (dict_get_stats_func)   skiplist_get_stats,
+    (dict_clone_func)	    NULL,/* TODO: implement clone */
+    (dict_merge_func)	    NULL,/* merge: generic fallback */
 };
 
 static itor_vtable skiplist_itor_vtable = {
@@ -96,12 +112,20 @@ static itor_vtable skiplist_itor_vtable = {
     (dict_icompare_func)    NULL,/* skiplist_itor_compare not implemented yet */
 };
 
-static skip_node*   node_new(void* key, unsigned link_count);
+static skip_node*   node_new(skiplist* list, void* key, unsigned link_count);
 static void**	    node_insert(skiplist* list, void* key, skip_node** update);
 static unsigned	    rand_link_count(skiplist* list);
 
-skiplist*
-skiplist_new(dict_compare_func cmp_func, unsigned max_link)
+static void
+free_pools(skiplist* list)
+{
+    for (unsigned k = 0; k < list->max_link; k++)
+	node_pool_free(list->pools[k]);
+    FREE(list->pools);
+}
+
+static skiplist*
+list_new(dict_compare_func cmp_func, unsigned max_link, bool pooled)
 {
     ASSERT(cmp_func != NULL);
     ASSERT(max_link > 0);
@@ -110,20 +134,65 @@ skiplist_new(dict_compare_func cmp_func, unsigned max_link)
 	max_link = MAX_LINK;
 
     skiplist* list = MALLOC(sizeof(*list));
-    if (list) {
-	if (!(list->head = node_new(NULL, max_link))) {
+    if (!list)
+	return NULL;
+    list->max_link = max_link;
+    /* The head is allocated before the pools so that it is never pooled;
+     * node_pool_clear can then release every element at once and leave the
+     * list usable. */
+    list->pools = NULL;
+    if (!(list->head = node_new(list, NULL, max_link))) {
+	FREE(list);
+	return NULL;
+    }
+    if (pooled) {
+	if (!(list->pools = MALLOC(sizeof(list->pools[0]) * max_link))) {
+	    FREE(list->head);
 	    FREE(list);
 	    return NULL;
 	}
-
-	list->max_link = max_link;
-	list->top_link = 0;
-	list->cmp_func = cmp_func;
-	list->count = 0;
+	for (unsigned k = 0; k < max_link; k++) {
+	    list->pools[k] = node_pool_new_aligned(
+		sizeof(skip_node) + sizeof(skip_node*) * (k + 1), CACHELINE);
+	    if (!list->pools[k]) {
+		while (k-- > 0)
+		    node_pool_free(list->pools[k]);
+		FREE(list->pools);
+		FREE(list->head);
+		FREE(list);
+		return NULL;
+	    }
+	}
     }
+    list->top_link = 0;
+    list->cmp_func = cmp_func;
+    list->count = 0;
+    skiplist_set_seed(list, ((uint64_t)dict_rand() << 32) | dict_rand());
+    STATS_RESET(list);
     return list;
 }
 
+skiplist*
+skiplist_new(dict_compare_func cmp_func, unsigned max_link)
+{
+    return list_new(cmp_func, max_link, false);
+}
+
+skiplist*
+skiplist_new_pooled(dict_compare_func cmp_func, unsigned max_link)
+{
+    return list_new(cmp_func, max_link, true);
+}
+
+void
+skiplist_set_seed(skiplist* list, uint64_t seed)
+{
+    ASSERT(list != NULL);
+
+    /* Zero is a fixed point of the generator; nudge it off. */
+    list->rand_state = seed ? seed : UINT64_C(0x9E3779B97F4A7C15);
+}
+
 dict*
 skiplist_dict_new(dict_compare_func cmp_func, unsigned max_link)
 {
@@ -138,12 +207,28 @@ skiplist_dict_new(dict_compare_func cmp_func, unsigned max_link)
     return dct;
 }
 
+dict*
+skiplist_dict_new_pooled(dict_compare_func cmp_func, unsigned max_link)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = skiplist_new_pooled(cmp_func, max_link))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &skiplist_vtable;
+    }
+    return dct;
+}
+
 size_t
 skiplist_free(skiplist* list, dict_delete_func delete_func)
 {
     ASSERT(list != NULL);
 
     size_t count = skiplist_clear(list, delete_func);
+    if (list->pools)
+	free_pools(list);
     FREE(list->head);
     FREE(list);
     return count;
@@ -154,7 +239,7 @@ node_insert(skiplist* list, void* key, skip_node** update)
 {
     const unsigned nlinks = rand_link_count(list);
     ASSERT(nlinks < list->max_link);
-    skip_node* x = node_new(key, nlinks);
+    skip_node* x = node_new(list, key, nlinks);
     if (!x)
 	return NULL;
 
@@ -182,17 +267,18 @@ dict_insert_result
 skiplist_insert(skiplist* list, void* key)
 {
     ASSERT(list != NULL);
+    STATS_INC(list, insert_count);
 
     skip_node* x = list->head;
     skip_node* update[MAX_LINK] = { 0 };
     for (unsigned k = list->top_link+1; k-->0; ) {
 	ASSERT(x->link_count > k);
-	while (x->link[k] && list->cmp_func(key, x->link[k]->key) > 0)
+	while (x->link[k] && dict_cmp(list->cmp_func, key, x->link[k]->key) > 0)
 	    x = x->link[k];
 	update[k] = x;
     }
     x = x->link[0];
-    if (x && list->cmp_func(key, x->key) == 0)
+    if (x && dict_cmp(list->cmp_func, key, x->key) == 0)
 	return (dict_insert_result) { &x->datum, false };
 
     void** datum = node_insert(list, key, update);
@@ -203,11 +289,12 @@ void**
 skiplist_search(skiplist* list, const void* key)
 {
     ASSERT(list != NULL);
+    STATS_INC(list, search_count);
 
     skip_node* x = list->head;
     for (unsigned k = list->top_link+1; k-->0;) {
 	while (x->link[k]) {
-	    int cmp = list->cmp_func(key, x->link[k]->key);
+	    int cmp = dict_cmp(list->cmp_func, key, x->link[k]->key);
 	    if (cmp < 0)
 		break;
 	    x = x->link[k];
@@ -222,17 +309,18 @@ dict_remove_result
 skiplist_remove(skiplist* list, const void* key)
 {
     ASSERT(list != NULL);
+    STATS_INC(list, remove_count);
 
     skip_node* x = list->head;
     skip_node* update[MAX_LINK] = { 0 };
     for (unsigned k = list->top_link+1; k-->0;) {
 	ASSERT(x->link_count > k);
-	while (x->link[k] && list->cmp_func(key, x->link[k]->key) > 0)
+	while (x->link[k] && dict_cmp(list->cmp_func, key, x->link[k]->key) > 0)
 	    x = x->link[k];
 	update[k] = x;
     }
     x = x->link[0];
-    if (!x || list->cmp_func(key, x->key) != 0)
+    if (!x || dict_cmp(list->cmp_func, key, x->key) != 0)
 	return (dict_remove_result) { NULL, NULL, false };
     for (unsigned k = 0; k <= list->top_link; k++) {
 	ASSERT(update[k] != NULL);
@@ -246,7 +334,10 @@ skiplist_remove(skiplist* list, const void* key)
     if (x->link[0])
 	x->link[0]->prev = x->prev;
     dict_remove_result result = { x->key, x->datum, true };
-    FREE(x);
+    if (list->pools)
+	node_pool_dealloc(list->pools[x->link_count - 1], x);
+    else
+	FREE(x);
     while (list->top_link > 0 && !list->head->link[list->top_link-1])
 	list->top_link--;
     list->count--;
@@ -258,14 +349,20 @@ skiplist_clear(skiplist* list, dict_delete_func delete_func)
 {
     ASSERT(list != NULL);
 
-    skip_node* node = list->head->link[0];
-    while (node) {
-	skip_node* next = node->link[0];
-	if (delete_func)
-	    delete_func(node->key, node->datum);
-	FREE(node);
-	node = next;
+    if (delete_func || !list->pools) {
+	skip_node* node = list->head->link[0];
+	while (node) {
+	    skip_node* next = node->link[0];
+	    if (delete_func)
+		delete_func(node->key, node->datum);
+	    if (!list->pools)
+		FREE(node);
+	    node = next;
+	}
     }
+    if (list->pools)
+	for (unsigned k = 0; k < list->max_link; k++)
+	    node_pool_clear(list->pools[k]);
 
     const size_t count = list->count;
     list->count = 0;
@@ -291,6 +388,32 @@ skiplist_traverse(skiplist* list, dict_visit_func visit)
     return count;
 }
 
+size_t
+skiplist_traverse_range(skiplist* list, const void* lo, const void* hi,
+			dict_visit_func visit)
+{
+    ASSERT(list != NULL);
+    ASSERT(visit != NULL);
+
+    skip_node* x = list->head;
+    if (lo) {
+	/* Descend to the last node with a key less than |lo|. */
+	for (unsigned k = list->top_link+1; k-->0;) {
+	    while (x->link[k] && dict_cmp(list->cmp_func, lo, x->link[k]->key) > 0)
+		x = x->link[k];
+	}
+    }
+    size_t count = 0;
+    for (skip_node* node = x->link[0]; node; node = node->link[0]) {
+	if (hi && dict_cmp(list->cmp_func, hi, node->key) < 0)
+	    break;
+	++count;
+	if (!visit(node->key, node->datum))
+	    break;
+    }
+    return count;
+}
+
 size_t
 skiplist_count(const skiplist* list)
 {
@@ -355,6 +478,18 @@ skiplist_link_count_histogram(const skiplist* list, size_t counts[], size_t ncou
     return max_num_links;
 }
 
+void
+skiplist_get_stats(skiplist* list, dict_stats* stats)
+{
+    ASSERT(list != NULL);
+    ASSERT(stats != NULL);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = list->count;
+    skiplist_link_count_histogram(list, stats->link_count, DICT_STATS_LINKS);
+    STATS_EXPORT(list, stats);
+}
+
 #define VALID(itor) ((itor)->node && (itor)->node != (itor)->list->head)
 
 skiplist_itor*
@@ -370,6 +505,19 @@ skiplist_itor_new(skiplist* list)
     return itor;
 }
 
+itor_vtable*
+skiplist_itor_init(skiplist* list, skiplist_itor* itor)
+{
+    ASSERT(list != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(skiplist_itor) <= DICT_ITOR_STATE_MAX,
+		   "skiplist_itor must fit in dict_itor_storage");
+
+    itor->list = list;
+    itor->node = NULL;
+    return &skiplist_itor_vtable;
+}
+
 dict_itor*
 skiplist_dict_itor_new(skiplist* list)
 {
@@ -419,7 +567,12 @@ skiplist_itor_next(skiplist_itor* itor)
 	return skiplist_itor_first(itor);
 
     itor->node = itor->node->link[0];
-    return VALID(itor);
+    if (VALID(itor)) {
+	/* Warm the node the following advance dereferences. */
+	PREFETCH(itor->node->link[0]);
+	return true;
+    }
+    return false;
 }
 
 bool
@@ -431,7 +584,11 @@ skiplist_itor_prev(skiplist_itor* itor)
 	return skiplist_itor_last(itor);
 
     itor->node = itor->node->prev;
-    return VALID(itor);
+    if (VALID(itor)) {
+	PREFETCH(itor->node->prev);
+	return true;
+    }
+    return false;
 }
 
 bool
@@ -493,7 +650,7 @@ skiplist_itor_search(skiplist_itor* itor, const void* key)
     skip_node* x = list->head;
     for (unsigned k = list->top_link+1; k-->0;) {
 	while (x->link[k]) {
-	    int cmp = list->cmp_func(key, x->link[k]->key);
+	    int cmp = dict_cmp(list->cmp_func, key, x->link[k]->key);
 	    if (cmp < 0)
 		break;
 	    x = x->link[k];
@@ -524,12 +681,13 @@ skiplist_itor_datum(skiplist_itor* itor)
 }
 
 skip_node*
-node_new(void* key, unsigned link_count)
+node_new(skiplist* list, void* key, unsigned link_count)
 {
     ASSERT(link_count >= 1);
 
-    skip_node* node = MALLOC(sizeof(*node) +
-			     sizeof(node->link[0]) * link_count);
+    skip_node* node = list->pools ?
+	node_pool_alloc(list->pools[link_count - 1]) :
+	MALLOC(sizeof(*node) + sizeof(node->link[0]) * link_count);
     if (node) {
 	node->key = key;
 	node->datum = NULL;
@@ -543,6 +701,15 @@ node_new(void* key, unsigned link_count)
 static unsigned
 rand_link_count(skiplist* list)
 {
-    unsigned count = (unsigned) __builtin_ctz(dict_rand()) / 2 + 1;
+    /* xorshift64*; each list carries its own state so that seeding a list
+     * makes the tower heights for an insertion sequence reproducible. The
+     * state is never zero, so neither is the output. */
+    uint64_t x = list->rand_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    list->rand_state = x;
+    x *= UINT64_C(0x2545F4914F6CDD1D);
+    unsigned count = (unsigned) __builtin_ctzll(x) / 2 + 1;
     return (count >= list->max_link) ? list->max_link - 1 : count;
 }
@@ -0,0 +1,674 @@
+/*
+ * libdict -- lock-free skiplist implementation.
+ *
+ * Copyright (c) 2001-2014, Farooq Mela
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * cf. [Pugh 1990], [Harris 2001], [Herlihy and Shavit 2008] ch. 14
+ */
+
+#include "skiplist_mt.h"
+
+#include <string.h>	    /* For memset() */
+#include "dict_private.h"
+
+typedef struct slmt_node slmt_node;
+
+/* A link is a successor pointer with a deletion mark in its low bit. A node
+ * is logically removed the instant its own bottom link is marked; marked
+ * links are never changed again, and any thread that finds one swings the
+ * predecessor's link past the dead node on its way by. */
+typedef uintptr_t slmt_link;
+
+#define NODE(link)	    ((slmt_node*)((link) & ~(slmt_link)1))
+#define MARKED(link)	    ((link) & 1)
+#define MARK(link)	    ((link) | 1)
+
+struct slmt_node {
+    void*		    key;
+    void*		    datum;
+    slmt_node*		    retired;	/* Next node on the retired list. */
+    unsigned		    link_count;
+    slmt_link		    link[];
+};
+
+#define MAX_LINK	    32
+
+struct skiplist_mt {
+    slmt_node*		    head;
+    slmt_node*		    retired;	/* Unlinked nodes awaiting quiescence. */
+    unsigned		    max_link;
+    dict_compare_func	    cmp_func;
+    size_t		    count;
+};
+
+struct skiplist_mt_itor {
+    skiplist_mt*	    list;
+    slmt_node*		    node;
+};
+
+static dict_vtable skiplist_mt_vtable = {
+    (dict_inew_func)	    skiplist_mt_dict_itor_new,
+    (dict_dfree_func)	    skiplist_mt_free,
+    (dict_insert_func)	    skiplist_mt_insert,
+    (dict_search_func)	    skiplist_mt_search,
+    (dict_search_func)	    NULL,/* TODO: implement search_le */
+    (dict_search_func)	    NULL,/* TODO: implement search_lt */
+    (dict_search_func)	    NULL,/* TODO: implement search_ge */
+    (dict_search_func)	    NULL,/* TODO: implement search_gt */
+    (dict_remove_func)	    skiplist_mt_remove,
+    (dict_clear_func)	    skiplist_mt_clear,
+    (dict_clear_parallel_func) NULL,/* clear_parallel: not implemented */
+    (dict_traverse_func)    skiplist_mt_traverse,
+    (dict_count_func)	    skiplist_mt_count,
+    (dict_verify_func)	    skiplist_mt_verify,
+    (dict_search_batch_func) NULL,/* search_batch: generic fallback */
+    (dict_traverse_range_func) skiplist_mt_traverse_range,
+    (dict_iinit_func)	    skiplist_mt_itor_init,
+    (dict_get_stats_func)   skiplist_mt_get_stats,
+    (dict_clone_func)	    NULL,/* TODO: implement clone */
+    (dict_merge_func)	    NULL,/* merge: generic fallback */
+};
+
+static itor_vtable skiplist_mt_itor_vtable = {
+    (dict_ifree_func)	    skiplist_mt_itor_free,
+    (dict_valid_func)	    skiplist_mt_itor_valid,
+    (dict_invalidate_func)  skiplist_mt_itor_invalidate,
+    (dict_next_func)	    skiplist_mt_itor_next,
+    (dict_prev_func)	    skiplist_mt_itor_prev,
+    (dict_nextn_func)	    skiplist_mt_itor_nextn,
+    (dict_prevn_func)	    skiplist_mt_itor_prevn,
+    (dict_first_func)	    skiplist_mt_itor_first,
+    (dict_last_func)	    skiplist_mt_itor_last,
+    (dict_key_func)	    skiplist_mt_itor_key,
+    (dict_datum_func)	    skiplist_mt_itor_datum,
+    (dict_isearch_func)	    skiplist_mt_itor_search,
+    (dict_isearch_func)	    NULL,/* itor_search_le: not implemented */
+    (dict_isearch_func)	    NULL,/* itor_search_lt: not implemented */
+    (dict_isearch_func)	    NULL,/* itor_search_ge: not implemented */
+    (dict_isearch_func)	    NULL,/* itor_search_gt: not implemented */
+    (dict_iremove_func)	    NULL,/* skiplist_mt_itor_remove not implemented yet */
+    (dict_icompare_func)    NULL,/* skiplist_mt_itor_compare not implemented yet */
+};
+
+static slmt_node*   node_new(void* key, unsigned link_count);
+static unsigned	    rand_link_count(skiplist_mt* list);
+
+static slmt_link
+load_link(const slmt_node* node, unsigned k)
+{
+    return __atomic_load_n(&node->link[k], __ATOMIC_ACQUIRE);
+}
+
+static bool
+cas_link(slmt_node* node, unsigned k, slmt_link expect, slmt_link desire)
+{
+    return __atomic_compare_exchange_n(&node->link[k], &expect, desire, false,
+				       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+skiplist_mt*
+skiplist_mt_new(dict_compare_func cmp_func, unsigned max_link)
+{
+    ASSERT(cmp_func != NULL);
+    ASSERT(max_link > 0);
+
+    if (max_link > MAX_LINK)
+	max_link = MAX_LINK;
+
+    skiplist_mt* list = MALLOC(sizeof(*list));
+    if (list) {
+	if (!(list->head = node_new(NULL, max_link))) {
+	    FREE(list);
+	    return NULL;
+	}
+
+	list->retired = NULL;
+	list->max_link = max_link;
+	list->cmp_func = cmp_func;
+	list->count = 0;
+    }
+    return list;
+}
+
+dict*
+skiplist_mt_dict_new(dict_compare_func cmp_func, unsigned max_link)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = skiplist_mt_new(cmp_func, max_link))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &skiplist_mt_vtable;
+    }
+    return dct;
+}
+
+size_t
+skiplist_mt_free(skiplist_mt* list, dict_delete_func delete_func)
+{
+    ASSERT(list != NULL);
+
+    size_t count = skiplist_mt_clear(list, delete_func);
+    FREE(list->head);
+    FREE(list);
+    return count;
+}
+
+/* Push a logically removed node onto the retired list. It stays allocated -
+ * so that searches and iterators overtaken by the removal can still read it -
+ * until the next clear or free. */
+static void
+retire_node(skiplist_mt* list, slmt_node* node)
+{
+    slmt_node* head = __atomic_load_n(&list->retired, __ATOMIC_RELAXED);
+    do {
+	node->retired = head;
+    } while (!__atomic_compare_exchange_n(&list->retired, &head, node, false,
+					  __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/* Record in |preds| and |succs| the nodes bracketing |key| on every level,
+ * physically unlinking any marked node met along the way. Returns true iff a
+ * live node with an equal key is present, in which case it is in succs[0]. */
+static bool
+find(skiplist_mt* list, const void* key, slmt_node** preds, slmt_node** succs)
+{
+restart:;
+    slmt_node* pred = list->head;
+    for (unsigned k = list->max_link; k-- > 0;) {
+	slmt_node* curr = NODE(load_link(pred, k));
+	for (;;) {
+	    if (!curr)
+		break;
+	    slmt_link next = load_link(curr, k);
+	    while (MARKED(next)) {
+		/* Swing the predecessor's link past the dead node; if the
+		 * CAS fails the neighborhood changed under us, so restart
+		 * from the head. */
+		if (!cas_link(pred, k, (slmt_link)curr, next & ~(slmt_link)1))
+		    goto restart;
+		curr = NODE(next);
+		if (!curr)
+		    break;
+		next = load_link(curr, k);
+	    }
+	    if (!curr || dict_cmp(list->cmp_func, key, curr->key) <= 0)
+		break;
+	    pred = curr;
+	    curr = NODE(next);
+	}
+	preds[k] = pred;
+	succs[k] = curr;
+    }
+    return succs[0] != NULL && dict_cmp(list->cmp_func, key, succs[0]->key) == 0;
+}
+
+/* Wait-free descent that steps over marked nodes without helping to unlink
+ * them. Returns the first live node whose key is not less than |key|, and
+ * optionally the last strictly smaller live node (the head if none). */
+static slmt_node*
+locate(const skiplist_mt* list, const void* key, slmt_node** pred_out)
+{
+    slmt_node* pred = list->head;
+    slmt_node* curr = NULL;
+    for (unsigned k = list->max_link; k-- > 0;) {
+	curr = NODE(load_link(pred, k));
+	for (;;) {
+	    while (curr && MARKED(load_link(curr, k)))
+		curr = NODE(load_link(curr, k));
+	    if (!curr || dict_cmp(list->cmp_func, key, curr->key) <= 0)
+		break;
+	    pred = curr;
+	    curr = NODE(load_link(curr, k));
+	}
+    }
+    if (pred_out)
+	*pred_out = pred;
+    return curr;
+}
+
+dict_insert_result
+skiplist_mt_insert(skiplist_mt* list, void* key)
+{
+    ASSERT(list != NULL);
+
+    slmt_node* preds[MAX_LINK];
+    slmt_node* succs[MAX_LINK];
+    slmt_node* node = NULL;
+    for (;;) {
+	if (find(list, key, preds, succs)) {
+	    if (node)
+		FREE(node);	/* Lost the race to an equal key. */
+	    return (dict_insert_result) { &succs[0]->datum, false };
+	}
+	if (!node && !(node = node_new(key, rand_link_count(list))))
+	    return (dict_insert_result) { NULL, false };
+	for (unsigned k = 0; k < node->link_count; k++)
+	    node->link[k] = (slmt_link)succs[k];
+	/* The node is in the dictionary from the moment this bottom-level
+	 * CAS succeeds; the upper links are built opportunistically. */
+	if (!cas_link(preds[0], 0, (slmt_link)succs[0], (slmt_link)node))
+	    continue;
+	__atomic_fetch_add(&list->count, 1, __ATOMIC_RELAXED);
+	for (unsigned k = 1; k < node->link_count; k++) {
+	    for (;;) {
+		const slmt_link expect = load_link(node, k);
+		if (MARKED(expect))
+		    return (dict_insert_result) { &node->datum, true };
+		if (NODE(expect) != succs[k] &&
+		    !cas_link(node, k, expect, (slmt_link)succs[k]))
+		    continue;	/* Our own link moved; re-read it. */
+		if (cas_link(preds[k], k, (slmt_link)succs[k], (slmt_link)node))
+		    break;
+		/* The predecessor changed; recompute the neighborhood. */
+		find(list, key, preds, succs);
+		if (succs[0] != node)
+		    return (dict_insert_result) { &node->datum, true };
+	    }
+	}
+	return (dict_insert_result) { &node->datum, true };
+    }
+}
+
+void**
+skiplist_mt_search(skiplist_mt* list, const void* key)
+{
+    ASSERT(list != NULL);
+
+    slmt_node* node = locate(list, key, NULL);
+    if (node && dict_cmp(list->cmp_func, key, node->key) == 0)
+	return &node->datum;
+    return NULL;
+}
+
+dict_remove_result
+skiplist_mt_remove(skiplist_mt* list, const void* key)
+{
+    ASSERT(list != NULL);
+
+    slmt_node* preds[MAX_LINK];
+    slmt_node* succs[MAX_LINK];
+    if (!find(list, key, preds, succs))
+	return (dict_remove_result) { NULL, NULL, false };
+    slmt_node* node = succs[0];
+    /* Mark the upper links first so no new predecessor can attach there. */
+    for (unsigned k = node->link_count; k-- > 1;) {
+	slmt_link next = load_link(node, k);
+	while (!MARKED(next)) {
+	    cas_link(node, k, next, MARK(next));
+	    next = load_link(node, k);
+	}
+    }
+    /* Whichever thread marks the bottom link owns the removal. */
+    slmt_link next = load_link(node, 0);
+    for (;;) {
+	if (MARKED(next))
+	    return (dict_remove_result) { NULL, NULL, false };
+	if (cas_link(node, 0, next, MARK(next)))
+	    break;
+	next = load_link(node, 0);
+    }
+    dict_remove_result result = { node->key, node->datum, true };
+    __atomic_fetch_sub(&list->count, 1, __ATOMIC_RELAXED);
+    find(list, key, preds, succs);	/* Physically unlink the node. */
+    retire_node(list, node);
+    return result;
+}
+
+size_t
+skiplist_mt_clear(skiplist_mt* list, dict_delete_func delete_func)
+{
+    ASSERT(list != NULL);
+
+    /* Requires quiescence: with no removal in flight, every dead node is on
+     * the retired list and the level-zero chain holds only live nodes. */
+    slmt_node* node = NODE(list->head->link[0]);
+    while (node) {
+	slmt_node* next = NODE(node->link[0]);
+	if (delete_func)
+	    delete_func(node->key, node->datum);
+	FREE(node);
+	node = next;
+    }
+    node = list->retired;
+    while (node) {
+	slmt_node* next = node->retired;
+	/* Keys and data were already handed back by remove. */
+	FREE(node);
+	node = next;
+    }
+    list->retired = NULL;
+
+    const size_t count = list->count;
+    list->count = 0;
+    memset(list->head->link, 0, sizeof(list->head->link[0]) * list->max_link);
+    return count;
+}
+
+size_t
+skiplist_mt_traverse(skiplist_mt* list, dict_visit_func visit)
+{
+    ASSERT(list != NULL);
+    ASSERT(visit != NULL);
+
+    size_t count = 0;
+    for (slmt_node* node = NODE(load_link(list->head, 0)); node;
+	 node = NODE(load_link(node, 0))) {
+	if (MARKED(load_link(node, 0)))
+	    continue;
+	++count;
+	if (!visit(node->key, node->datum))
+	    break;
+    }
+    return count;
+}
+
+size_t
+skiplist_mt_traverse_range(skiplist_mt* list, const void* lo, const void* hi,
+			   dict_visit_func visit)
+{
+    ASSERT(list != NULL);
+    ASSERT(visit != NULL);
+
+    slmt_node* node;
+    if (lo) {
+	node = locate(list, lo, NULL);
+    } else {
+	node = NODE(load_link(list->head, 0));
+    }
+    size_t count = 0;
+    for (; node; node = NODE(load_link(node, 0))) {
+	if (MARKED(load_link(node, 0)))
+	    continue;
+	if (hi && dict_cmp(list->cmp_func, hi, node->key) < 0)
+	    break;
+	++count;
+	if (!visit(node->key, node->datum))
+	    break;
+    }
+    return count;
+}
+
+size_t
+skiplist_mt_count(const skiplist_mt* list)
+{
+    ASSERT(list != NULL);
+
+    return __atomic_load_n(&list->count, __ATOMIC_RELAXED);
+}
+
+bool
+skiplist_mt_verify(const skiplist_mt* list)
+{
+    /* Requires quiescence; all reads here are plain. */
+    size_t count = 0;
+    const slmt_node* prev = NULL;
+    for (const slmt_node* node = NODE(list->head->link[0]); node;
+	 node = NODE(node->link[0])) {
+	VERIFY(!MARKED(node->link[0]));
+	VERIFY(node->link_count >= 1);
+	VERIFY(node->link_count < list->max_link);
+	if (prev) {
+	    VERIFY(dict_cmp(list->cmp_func, prev->key, node->key) < 0);
+	}
+	prev = node;
+	++count;
+    }
+    VERIFY(count == list->count);
+    for (unsigned k = 1; k < list->max_link; k++) {
+	for (const slmt_node* node = NODE(list->head->link[k]); node;
+	     node = NODE(node->link[k])) {
+	    VERIFY(node->link_count > k);
+	}
+    }
+    return true;
+}
+
+void
+skiplist_mt_get_stats(skiplist_mt* list, dict_stats* stats)
+{
+    ASSERT(list != NULL);
+    ASSERT(stats != NULL);
+
+    /* Operation counters are not collected for the lock-free list:
+     * unsynchronized increments on the hot paths would race. */
+    memset(stats, 0, sizeof(*stats));
+    for (slmt_node* node = NODE(load_link(list->head, 0)); node;
+	 node = NODE(load_link(node, 0))) {
+	if (MARKED(load_link(node, 0)))
+	    continue;
+	stats->count++;
+	if (node->link_count < DICT_STATS_LINKS)
+	    stats->link_count[node->link_count]++;
+    }
+}
+
+#define VALID(itor) ((itor)->node && (itor)->node != (itor)->list->head)
+
+skiplist_mt_itor*
+skiplist_mt_itor_new(skiplist_mt* list)
+{
+    ASSERT(list != NULL);
+
+    skiplist_mt_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	itor->list = list;
+	itor->node = NULL;
+    }
+    return itor;
+}
+
+itor_vtable*
+skiplist_mt_itor_init(skiplist_mt* list, skiplist_mt_itor* itor)
+{
+    ASSERT(list != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(skiplist_mt_itor) <= DICT_ITOR_STATE_MAX,
+		   "skiplist_mt_itor must fit in dict_itor_storage");
+
+    itor->list = list;
+    itor->node = NULL;
+    return &skiplist_mt_itor_vtable;
+}
+
+dict_itor*
+skiplist_mt_dict_itor_new(skiplist_mt* list)
+{
+    ASSERT(list != NULL);
+
+    dict_itor* itor = MALLOC(sizeof(*itor));
+    if (itor) {
+	if (!(itor->_itor = skiplist_mt_itor_new(list))) {
+	    FREE(itor);
+	    return NULL;
+	}
+	itor->_vtable = &skiplist_mt_itor_vtable;
+    }
+    return itor;
+}
+
+void
+skiplist_mt_itor_free(skiplist_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    FREE(itor);
+}
+
+bool
+skiplist_mt_itor_valid(const skiplist_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return VALID(itor);
+}
+
+void
+skiplist_mt_itor_invalidate(skiplist_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    itor->node = NULL;
+}
+
+bool
+skiplist_mt_itor_next(skiplist_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (!itor->node)
+	return skiplist_mt_itor_first(itor);
+
+    slmt_node* node = NODE(load_link(itor->node, 0));
+    while (node && MARKED(load_link(node, 0)))
+	node = NODE(load_link(node, 0));
+    itor->node = node;
+    return VALID(itor);
+}
+
+bool
+skiplist_mt_itor_prev(skiplist_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    if (!itor->node)
+	return skiplist_mt_itor_last(itor);
+
+    /* There are no usable back links in a lock-free list, so re-descend to
+     * the last live node before the current key. */
+    slmt_node* pred;
+    locate(itor->list, itor->node->key, &pred);
+    itor->node = (pred == itor->list->head) ? NULL : pred;
+    return VALID(itor);
+}
+
+bool
+skiplist_mt_itor_nextn(skiplist_mt_itor* itor, size_t count)
+{
+    ASSERT(itor != NULL);
+
+    while (count--)
+	if (!skiplist_mt_itor_next(itor))
+	    return false;
+    return VALID(itor);
+}
+
+bool
+skiplist_mt_itor_prevn(skiplist_mt_itor* itor, size_t count)
+{
+    ASSERT(itor != NULL);
+
+    while (count--)
+	if (!skiplist_mt_itor_prev(itor))
+	    return false;
+    return VALID(itor);
+}
+
+bool
+skiplist_mt_itor_first(skiplist_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    slmt_node* node = NODE(load_link(itor->list->head, 0));
+    while (node && MARKED(load_link(node, 0)))
+	node = NODE(load_link(node, 0));
+    itor->node = node;
+    return VALID(itor);
+}
+
+bool
+skiplist_mt_itor_last(skiplist_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    /* Descend keeping track of the last live node seen on each level. */
+    skiplist_mt* list = itor->list;
+    slmt_node* pred = list->head;
+    for (unsigned k = list->max_link; k-- > 0;) {
+	for (slmt_node* node = NODE(load_link(pred, k)); node;
+	     node = NODE(load_link(node, k))) {
+	    if (!MARKED(load_link(node, k)))
+		pred = node;
+	}
+    }
+    itor->node = (pred == list->head) ? NULL : pred;
+    return VALID(itor);
+}
+
+bool
+skiplist_mt_itor_search(skiplist_mt_itor* itor, const void* key)
+{
+    ASSERT(itor != NULL);
+
+    slmt_node* node = locate(itor->list, key, NULL);
+    if (node && dict_cmp(itor->list->cmp_func, key, node->key) == 0) {
+	itor->node = node;
+	return true;
+    }
+    itor->node = NULL;
+    return false;
+}
+
+const void*
+skiplist_mt_itor_key(const skiplist_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return itor->node ? itor->node->key : NULL;
+}
+
+void**
+skiplist_mt_itor_datum(skiplist_mt_itor* itor)
+{
+    ASSERT(itor != NULL);
+
+    return itor->node ? &itor->node->datum : NULL;
+}
+
+static slmt_node*
+node_new(void* key, unsigned link_count)
+{
+    ASSERT(link_count >= 1);
+
+    slmt_node* node = MALLOC(sizeof(*node) +
+			     sizeof(node->link[0]) * link_count);
+    if (node) {
+	node->key = key;
+	node->datum = NULL;
+	node->retired = NULL;
+	node->link_count = link_count;
+	memset(node->link, 0, sizeof(node->link[0]) * link_count);
+    }
+    return node;
+}
+
+static unsigned
+rand_link_count(skiplist_mt* list)
+{
+    unsigned count = (unsigned) __builtin_ctz(dict_rand()) / 2 + 1;
+    return (count >= list->max_link) ? list->max_link - 1 : count;
+}
@@ -57,6 +57,9 @@ struct sp_node {
 
 struct sp_tree {
     TREE_FIELDS(sp_node);
+    sp_splay_policy	    policy;	/* How searches restructure the tree. */
+    unsigned		    period;	/* Splay every |period|-th search. */
+    unsigned		    unsplayed;	/* Searches since the last splay. */
 };
 
 struct sp_itor {
@@ -74,9 +77,16 @@ static dict_vtable sp_tree_vtable = {
     (dict_search_func)	    tree_search_gt,
     (dict_remove_func)	    sp_tree_remove,
     (dict_clear_func)	    tree_clear,
+    (dict_clear_parallel_func) tree_clear_parallel,
     (dict_traverse_func)    tree_traverse,
     (dict_count_func)	    tree_count,
     (dict_verify_func)	    sp_tree_verify,
+    (dict_search_batch_func) NULL,/* search_batch: searching splays, so batching cannot help */
+    (dict_traverse_range_func) tree_traverse_range,
+    (dict_iinit_func)	    sp_itor_init,
+    (dict_get_stats_func)   tree_get_stats,
+    (dict_clone_func)	    sp_tree_clone,
+    (dict_merge_func)	    sp_tree_merge,
 };
 
 static itor_vtable sp_tree_itor_vtable = {
@@ -101,6 +111,8 @@ static itor_vtable sp_tree_itor_vtable = {
 };
 
 static sp_node*	node_new(void* key);
+static void	splay_for_search(sp_tree* t, sp_node* n);
+static void	semi_splay(sp_tree* t, sp_node* n);
 static size_t	node_height(const sp_node* node);
 static size_t	node_mheight(const sp_node* node);
 static size_t	node_pathlen(const sp_node* node, size_t level);
@@ -117,6 +129,23 @@ sp_tree_new(dict_compare_func cmp_func)
 	tree->count = 0;
 	tree->cmp_func = cmp_func;
 	tree->rotation_count = 0;
+	tree->policy = SP_SPLAY_ALWAYS;
+	tree->period = 0;
+	tree->unsplayed = 0;
+	STATS_RESET(tree);
+    }
+    return tree;
+}
+
+sp_tree*
+sp_tree_new_policy(dict_compare_func cmp_func, sp_splay_policy policy, unsigned period)
+{
+    ASSERT(policy != SP_SPLAY_PERIODIC || period > 0);
+
+    sp_tree* tree = sp_tree_new(cmp_func);
+    if (tree) {
+	tree->policy = policy;
+	tree->period = period;
     }
     return tree;
 }
@@ -135,6 +164,102 @@ sp_dict_new(dict_compare_func cmp_func)
     return dct;
 }
 
+dict*
+sp_dict_new_policy(dict_compare_func cmp_func, sp_splay_policy policy, unsigned period)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = sp_tree_new_policy(cmp_func, policy, period))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &sp_tree_vtable;
+    }
+    return dct;
+}
+
+static void
+free_subtree(sp_node* node)
+{
+    if (node) {
+	free_subtree(node->llink);
+	free_subtree(node->rlink);
+	FREE(node);
+    }
+}
+
+static sp_node*
+from_sorted_build(void* const* keys, void* const* datums, size_t n)
+{
+    if (!n)
+	return NULL;
+    const size_t mid = n / 2;
+    sp_node* node = node_new(keys[mid]);
+    if (!node)
+	return NULL;
+    if (datums)
+	node->datum = datums[mid];
+    node->llink = from_sorted_build(keys, datums, mid);
+    node->rlink = from_sorted_build(keys + mid + 1,
+				    datums ? datums + mid + 1 : NULL,
+				    n - mid - 1);
+    if ((mid && !node->llink) || (n - mid - 1 && !node->rlink)) {
+	free_subtree(node);
+	return NULL;
+    }
+    if (node->llink)
+	node->llink->parent = node;
+    if (node->rlink)
+	node->rlink->parent = node;
+    return node;
+}
+
+sp_tree*
+sp_tree_from_sorted(dict_compare_func cmp_func, void* const* keys,
+		    void* const* datums, size_t nkeys)
+{
+    sp_tree* tree = sp_tree_new(cmp_func);
+    if (tree && nkeys) {
+	if (!(tree->root = from_sorted_build(keys, datums, nkeys))) {
+	    FREE(tree);
+	    return NULL;
+	}
+	tree->count = nkeys;
+    }
+    return tree;
+}
+
+dict*
+sp_dict_from_sorted(dict_compare_func cmp_func, void* const* keys,
+		    void* const* datums, size_t nkeys)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = sp_tree_from_sorted(cmp_func, keys, datums, nkeys))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &sp_tree_vtable;
+    }
+    return dct;
+}
+
+static void*
+merge_rebuild(void* tree, void* const* keys, void* const* datums, size_t n)
+{
+    (void)tree;
+    return from_sorted_build(keys, datums, n);
+}
+
+size_t
+sp_tree_merge(sp_tree* tree, sp_tree* src)
+{
+    ASSERT(tree != NULL);
+    ASSERT(src != NULL);
+
+    return tree_merge(tree, src, merge_rebuild);
+}
+
 size_t
 sp_tree_free(sp_tree* tree, dict_delete_func delete_func)
 {
@@ -145,6 +270,14 @@ sp_tree_free(sp_tree* tree, dict_delete_func delete_func)
     return count;
 }
 
+sp_tree*
+sp_tree_clone(sp_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    return tree_clone(tree, sizeof(*tree), sizeof(sp_node));
+}
+
 size_t
 sp_tree_clear(sp_tree* tree, dict_delete_func delete_func)
 {
@@ -285,16 +418,80 @@ splay(sp_tree* t, sp_node* n)
     t->rotation_count += rotations;
 }
 
+/* Semi-splay after Sleator and Tarjan: in the zig-zig case only the
+ * grandparent is rotated and splaying continues from the parent, so the
+ * accessed path's depth is roughly halved with about half the pointer writes
+ * of a full splay, and the accessed node does not move all the way to the
+ * root. The zig-zag case restructures exactly as a full splay does. */
+static void
+semi_splay(sp_tree* t, sp_node* n)
+{
+    unsigned rotations = 0;
+    while (n->parent) {
+	sp_node* p = n->parent;
+	sp_node* pp = p->parent;
+	if (!pp) {
+	    if (p->llink == n)
+		tree_node_rot_right(t, p);
+	    else
+		tree_node_rot_left(t, p);
+	    rotations += 1;
+	    break;
+	}
+	if ((pp->llink == p) == (p->llink == n)) {
+	    /* Zig-zig: lift the parent and continue from it. */
+	    if (pp->llink == p)
+		tree_node_rot_right(t, pp);
+	    else
+		tree_node_rot_left(t, pp);
+	    rotations += 1;
+	    n = p;
+	} else if (p->llink == n) {
+	    tree_node_rot_right(t, p);
+	    tree_node_rot_left(t, pp);
+	    rotations += 2;
+	} else {
+	    tree_node_rot_left(t, p);
+	    tree_node_rot_right(t, pp);
+	    rotations += 2;
+	}
+    }
+    t->rotation_count += rotations;
+}
+
+/* Restructure (or not) after a search reached |n|, per the tree's policy. */
+static void
+splay_for_search(sp_tree* t, sp_node* n)
+{
+    switch (t->policy) {
+    case SP_SPLAY_ALWAYS:
+	splay(t, n);
+	break;
+    case SP_SPLAY_SEMI:
+	semi_splay(t, n);
+	break;
+    case SP_SPLAY_PERIODIC:
+	if (++t->unsplayed >= t->period) {
+	    t->unsplayed = 0;
+	    splay(t, n);
+	}
+	break;
+    case SP_SPLAY_NEVER:
+	break;
+    }
+}
+
 dict_insert_result
 sp_tree_insert(sp_tree* tree, void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, insert_count);
 
     int cmp = 0;
     sp_node* node = tree->root;
     sp_node* parent = NULL;
     while (node) {
-	cmp = tree->cmp_func(key, node->key);
+	cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    parent = node, node = node->llink;
 	else if (cmp)
@@ -327,25 +524,24 @@ void**
 sp_tree_search(sp_tree* tree, const void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, search_count);
 
     sp_node* node = tree->root;
     sp_node* parent = NULL;
     while (node) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    parent = node, node = node->llink;
 	else if (cmp)
 	    parent = node, node = node->rlink;
 	else {
-	    splay(tree, node);
-	    ASSERT(tree->root == node);
+	    splay_for_search(tree, node);
 	    return &node->datum;
 	}
     }
     if (parent) {
 	/* XXX Splay last node seen until it becomes the new root. */
-	splay(tree, parent);
-	ASSERT(tree->root == parent);
+	splay_for_search(tree, parent);
     }
     return NULL;
 }
@@ -354,10 +550,11 @@ dict_remove_result
 sp_tree_remove(sp_tree* tree, const void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, remove_count);
 
     sp_node* node = tree->root;
     while (node) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    node = node->llink;
 	else if (cmp)
@@ -578,6 +775,19 @@ sp_itor_new(sp_tree* tree)
     return itor;
 }
 
+itor_vtable*
+sp_itor_init(sp_tree* tree, sp_itor* itor)
+{
+    ASSERT(tree != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(sp_itor) <= DICT_ITOR_STATE_MAX,
+		   "sp_itor must fit in dict_itor_storage");
+
+    itor->tree = tree;
+    itor->node = NULL;
+    return &sp_tree_itor_vtable;
+}
+
 dict_itor*
 sp_dict_itor_new(sp_tree* tree)
 {
@@ -72,9 +72,16 @@ static dict_vtable tr_tree_vtable = {
     (dict_search_func)	    tree_search_gt,
     (dict_remove_func)	    tr_tree_remove,
     (dict_clear_func)	    tree_clear,
+    (dict_clear_parallel_func) tree_clear_parallel,
     (dict_traverse_func)    tree_traverse,
     (dict_count_func)	    tree_count,
     (dict_verify_func)	    tr_tree_verify,
+    (dict_search_batch_func) tree_search_batch,
+    (dict_traverse_range_func) tree_traverse_range,
+    (dict_iinit_func)	    tr_itor_init,
+    (dict_get_stats_func)   tree_get_stats,
+    (dict_clone_func)	    tr_tree_clone,
+    (dict_merge_func)	    tr_tree_merge,
 };
 
 static itor_vtable tr_tree_itor_vtable = {
@@ -114,6 +121,7 @@ tr_tree_new(dict_compare_func cmp_func, dict_prio_func prio_func)
 	tree->count = 0;
 	tree->cmp_func = cmp_func;
 	tree->rotation_count = 0;
+	STATS_RESET(tree);
 	tree->prio_func = prio_func;
     }
     return tree;
@@ -133,6 +141,81 @@ tr_dict_new(dict_compare_func cmp_func, dict_prio_func prio_func)
     return dct;
 }
 
+static void
+free_subtree(tr_node* node)
+{
+    if (node) {
+	free_subtree(node->llink);
+	free_subtree(node->rlink);
+	FREE(node);
+    }
+}
+
+static tr_node*
+from_sorted_build(const tr_tree* tree, void* const* keys, void* const* datums,
+		  size_t n)
+{
+    if (!n)
+	return NULL;
+    const size_t mid = n / 2;
+    tr_node* node = node_new(keys[mid]);
+    if (!node)
+	return NULL;
+    if (datums)
+	node->datum = datums[mid];
+    node->llink = from_sorted_build(tree, keys, datums, mid);
+    node->rlink = from_sorted_build(tree, keys + mid + 1,
+				    datums ? datums + mid + 1 : NULL,
+				    n - mid - 1);
+    if ((mid && !node->llink) || (n - mid - 1 && !node->rlink)) {
+	free_subtree(node);
+	return NULL;
+    }
+    /* Raise the priority to that of the larger child where needed, so that
+     * the heap property holds without any rotations. */
+    node->prio = tree->prio_func ? tree->prio_func(node->key) : dict_rand();
+    if (node->llink) {
+	node->llink->parent = node;
+	node->prio = MAX(node->prio, node->llink->prio);
+    }
+    if (node->rlink) {
+	node->rlink->parent = node;
+	node->prio = MAX(node->prio, node->rlink->prio);
+    }
+    return node;
+}
+
+tr_tree*
+tr_tree_from_sorted(dict_compare_func cmp_func, dict_prio_func prio_func,
+		    void* const* keys, void* const* datums, size_t nkeys)
+{
+    tr_tree* tree = tr_tree_new(cmp_func, prio_func);
+    if (tree && nkeys) {
+	if (!(tree->root = from_sorted_build(tree, keys, datums, nkeys))) {
+	    FREE(tree);
+	    return NULL;
+	}
+	tree->count = nkeys;
+    }
+    return tree;
+}
+
+dict*
+tr_dict_from_sorted(dict_compare_func cmp_func, dict_prio_func prio_func,
+		    void* const* keys, void* const* datums, size_t nkeys)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = tr_tree_from_sorted(cmp_func, prio_func, keys,
+						 datums, nkeys))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &tr_tree_vtable;
+    }
+    return dct;
+}
+
 size_t
 tr_tree_free(tr_tree* tree, dict_delete_func delete_func)
 {
@@ -143,6 +226,14 @@ tr_tree_free(tr_tree* tree, dict_delete_func delete_func)
     return count;
 }
 
+tr_tree*
+tr_tree_clone(tr_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    return tree_clone(tree, sizeof(*tree), sizeof(tr_node));
+}
+
 size_t
 tr_tree_clear(tr_tree* tree, dict_delete_func delete_func)
 {
@@ -155,12 +246,13 @@ dict_insert_result
 tr_tree_insert(tr_tree* tree, void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, insert_count);
 
     int cmp = 0;
     tr_node* node = tree->root;
     tr_node* parent = NULL;
     while (node) {
-	cmp = tree->cmp_func(key, node->key);
+	cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    parent = node, node = node->llink;
 	else if (cmp)
@@ -203,10 +295,11 @@ dict_remove_result
 tr_tree_remove(tr_tree* tree, const void* key)
 {
     ASSERT(tree != NULL);
+    STATS_INC(tree, remove_count);
 
     tr_node* node = tree->root;
     while (node) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    node = node->llink;
 	else if (cmp)
@@ -245,6 +338,127 @@ tr_tree_remove(tr_tree* tree, const void* key)
     return result;
 }
 
+/* Split |node|'s subtree into a tree of keys less than |key| and a tree of
+ * keys greater than |key|. A node whose key equals |key| is pushed onto the
+ * |dups| list, chained through its rlink. The parent pointers of the pieces'
+ * roots are fixed up by the caller. */
+static void
+split_subtree(tr_tree* tree, tr_node* node, const void* key,
+	      tr_node** lo, tr_node** hi, tr_node** dups)
+{
+    if (!node) {
+	*lo = *hi = NULL;
+	return;
+    }
+    const int cmp = dict_cmp(tree->cmp_func, key, node->key);
+    if (cmp == 0) {
+	*lo = node->llink;
+	*hi = node->rlink;
+	node->llink = NULL;
+	node->rlink = *dups;
+	*dups = node;
+    } else if (cmp < 0) {
+	split_subtree(tree, node->llink, key, lo, &node->llink, dups);
+	if (node->llink)
+	    node->llink->parent = node;
+	*hi = node;
+    } else {
+	split_subtree(tree, node->rlink, key, &node->rlink, hi, dups);
+	if (node->rlink)
+	    node->rlink->parent = node;
+	*lo = node;
+    }
+}
+
+/* Meld two treaps: the higher-priority root stays on top and the other tree
+ * is split around its key, cf. [Blelloch and Reid-Miller 1998]. For treaps
+ * of m and n keys with m <= n this does O(m log(n/m)) comparisons in
+ * expectation. */
+static tr_node*
+meld_subtrees(tr_tree* tree, tr_node* a, tr_node* b, tr_node** dups)
+{
+    if (!a)
+	return b;
+    if (!b)
+	return a;
+    if (a->prio < b->prio) {
+	tr_node* t = a;
+	a = b;
+	b = t;
+    }
+    tr_node* lo;
+    tr_node* hi;
+    split_subtree(tree, b, a->key, &lo, &hi, dups);
+    if ((a->llink = meld_subtrees(tree, a->llink, lo, dups)) != NULL)
+	a->llink->parent = a;
+    if ((a->rlink = meld_subtrees(tree, a->rlink, hi, dups)) != NULL)
+	a->rlink->parent = a;
+    return a;
+}
+
+/* Link an existing node, keeping its key and priority, into |tree|, whose
+ * keys must all differ from the node's. */
+static void
+insert_node(tr_tree* tree, tr_node* node)
+{
+    int cmp = 0;
+    tr_node* parent = NULL;
+    for (tr_node* where = tree->root; where;) {
+	cmp = dict_cmp(tree->cmp_func, node->key, where->key);
+	ASSERT(cmp != 0);
+	parent = where;
+	where = cmp < 0 ? where->llink : where->rlink;
+    }
+    node->parent = parent;
+    node->llink = node->rlink = NULL;
+    if (!parent) {
+	tree->root = node;
+    } else {
+	if (cmp < 0)
+	    parent->llink = node;
+	else
+	    parent->rlink = node;
+	while (parent->prio < node->prio) {
+	    if (parent->llink == node)
+		tree_node_rot_right(tree, parent);
+	    else
+		tree_node_rot_left(tree, parent);
+	    if (!(parent = node->parent))
+		break;
+	}
+    }
+    tree->count++;
+}
+
+size_t
+tr_tree_merge(tr_tree* tree, tr_tree* src)
+{
+    ASSERT(tree != NULL);
+    ASSERT(src != NULL);
+    ASSERT(tree != src);
+
+    if (tree->cmp_func != src->cmp_func)
+	return DICT_MERGE_INCOMPATIBLE;
+    if (!src->root)
+	return 0;
+    const size_t src_count = src->count;
+    tr_node* dups = NULL;
+    tree->root = meld_subtrees(tree, tree->root, src->root, &dups);
+    tree->root->parent = NULL;
+    /* When both trees stored a key, the melded tree kept one of the two
+     * nodes and the other was set aside; rebuild |src| from the leftovers. */
+    src->root = NULL;
+    src->count = 0;
+    while (dups) {
+	tr_node* node = dups;
+	dups = node->rlink;
+	insert_node(src, node);
+    }
+    const size_t moved = src_count - src->count;
+    tree->count += moved;
+    return moved;
+}
+
 void**
 tr_tree_search(tr_tree* tree, const void* key)
 {
@@ -406,6 +620,19 @@ tr_itor_new(tr_tree* tree)
     return itor;
 }
 
+itor_vtable*
+tr_itor_init(tr_tree* tree, tr_itor* itor)
+{
+    ASSERT(tree != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(tr_itor) <= DICT_ITOR_STATE_MAX,
+		   "tr_itor must fit in dict_itor_storage");
+
+    itor->tree = tree;
+    itor->node = NULL;
+    return &tr_tree_itor_vtable;
+}
+
 dict_itor*
 tr_dict_itor_new(tr_tree* tree)
 {
@@ -25,8 +25,12 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+/* For pthread_create under -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
 #include "tree_common.h"
 
+#include <pthread.h>
 #include <string.h>
 #include "dict_private.h"
 
@@ -151,7 +155,7 @@ tree_search_node(void* Tree, const void* key)
 
     tree* t = Tree;
     for (tree_node* node = t->root; node;) {
-	int cmp = t->cmp_func(key, node->key);
+	int cmp = dict_cmp(t->cmp_func, key, node->key);
 	if (cmp < 0)
 	    node = node->llink;
 	else if (cmp)
@@ -165,11 +169,52 @@ tree_search_node(void* Tree, const void* key)
 void**
 tree_search(void* Tree, const void* key)
 {
+    STATS_INC((tree*)Tree, search_count);
     tree_node* node = tree_search_node(Tree, key);
 
     return node ? &node->datum : NULL;
 }
 
+/* Number of lookups whose tree descents are interleaved by
+ * tree_search_batch, so that their memory accesses can overlap. */
+#define BATCH_WIDTH 8
+
+size_t
+tree_search_batch(void* Tree, const void* const* keys, size_t nkeys, void*** results)
+{
+    ASSERT(Tree != NULL);
+
+    tree* t = Tree;
+    size_t found = 0;
+    for (size_t i = 0; i < nkeys; i += BATCH_WIDTH) {
+	const size_t n = MIN(nkeys - i, (size_t)BATCH_WIDTH);
+	tree_node* node[BATCH_WIDTH];
+	for (size_t j = 0; j < n; ++j) {
+	    results[i + j] = NULL;
+	    node[j] = t->root;
+	}
+	/* Advance every descent one level per round; by the time a lookup
+	 * comes around again its prefetched node has usually arrived. */
+	for (bool active = (t->root != NULL); active;) {
+	    active = false;
+	    for (size_t j = 0; j < n; ++j) {
+		if (!node[j])
+		    continue;
+		int cmp = dict_cmp(t->cmp_func, keys[i + j], node[j]->key);
+		if (cmp == 0) {
+		    results[i + j] = &node[j]->datum;
+		    ++found;
+		    node[j] = NULL;
+		} else if ((node[j] = cmp < 0 ? node[j]->llink : node[j]->rlink) != NULL) {
+		    PREFETCH(node[j]);
+		    active = true;
+		}
+	    }
+	}
+    }
+    return found;
+}
+
 void*
 tree_search_le_node(void* Tree, const void* key)
 {
@@ -177,7 +222,7 @@ tree_search_le_node(void* Tree, const void* key)
     ASSERT(t != NULL);
     tree_node* node = t->root, *ret = NULL;
     while (node) {
-	int cmp = t->cmp_func(key, node->key);
+	int cmp = dict_cmp(t->cmp_func, key, node->key);
 	if (cmp == 0)
 	    return node;
 	if (cmp < 0) {
@@ -205,7 +250,7 @@ tree_search_lt_node(void* Tree, const void* key)
     ASSERT(t != NULL);
     tree_node* node = t->root, *ret = NULL;
     while (node) {
-	int cmp = t->cmp_func(key, node->key);
+	int cmp = dict_cmp(t->cmp_func, key, node->key);
 	if (cmp <= 0) {
 	    node = node->llink;
 	} else {
@@ -231,7 +276,7 @@ tree_search_ge_node(void* Tree, const void* key)
     ASSERT(t != NULL);
     tree_node* node = t->root, *ret = NULL;
     while (node) {
-	int cmp = t->cmp_func(key, node->key);
+	int cmp = dict_cmp(t->cmp_func, key, node->key);
 	if (cmp == 0) {
 	    return node;
 	}
@@ -260,7 +305,7 @@ tree_search_gt_node(void* Tree, const void* key)
     ASSERT(t != NULL);
     tree_node* node = t->root, *ret = NULL;
     while (node) {
-	int cmp = t->cmp_func(key, node->key);
+	int cmp = dict_cmp(t->cmp_func, key, node->key);
 	if (cmp < 0) {
 	    ret = node;
 	    node = node->llink;
@@ -327,6 +372,44 @@ tree_traverse(void* Tree, dict_visit_func visit)
     return count;
 }
 
+static bool
+tree_node_traverse_range(tree* t, tree_node* node, const void* lo,
+			 const void* hi, dict_visit_func visit, size_t* count)
+{
+    if (lo && dict_cmp(t->cmp_func, lo, node->key) > 0) {
+	/* The node and everything in its left subtree precede the range. */
+	return !node->rlink ||
+	    tree_node_traverse_range(t, node->rlink, lo, hi, visit, count);
+    }
+    if (hi && dict_cmp(t->cmp_func, hi, node->key) < 0) {
+	/* The node and everything in its right subtree follow the range. */
+	return !node->llink ||
+	    tree_node_traverse_range(t, node->llink, lo, hi, visit, count);
+    }
+    if (node->llink &&
+	!tree_node_traverse_range(t, node->llink, lo, hi, visit, count))
+	return false;
+    ++*count;
+    if (!visit(node->key, node->datum))
+	return false;
+    return !node->rlink ||
+	tree_node_traverse_range(t, node->rlink, lo, hi, visit, count);
+}
+
+size_t
+tree_traverse_range(void* Tree, const void* lo, const void* hi,
+		    dict_visit_func visit)
+{
+    ASSERT(Tree != NULL);
+    ASSERT(visit != NULL);
+
+    tree* t = Tree;
+    size_t count = 0;
+    if (t->root)
+	tree_node_traverse_range(t, t->root, lo, hi, visit, &count);
+    return count;
+}
+
 static void
 tree_node_free(tree_node* node, dict_delete_func delete_func)
 {
@@ -375,6 +458,253 @@ tree_free(void* Tree, dict_delete_func delete_func)
     return count;
 }
 
+typedef struct {
+    tree_node**		roots;
+    unsigned		begin;
+    unsigned		end;
+    dict_delete_func	delete_func;
+} clear_worker_args;
+
+static void*
+clear_worker(void* Args)
+{
+    const clear_worker_args* args = Args;
+    for (unsigned i = args->begin; i < args->end; ++i)
+	tree_node_free(args->roots[i], args->delete_func);
+    return NULL;
+}
+
+size_t
+tree_clear_parallel(void* Tree, dict_delete_func delete_func, unsigned nthreads)
+{
+    ASSERT(Tree != NULL);
+    ASSERT(nthreads > 1);
+
+    tree* t = Tree;
+    const size_t count = t->count;
+    if (!t->root)
+	return count;
+
+    /* Cut the tree into a work list of disjoint subtrees, several per
+     * worker so that lopsided subtrees even out. The frontier is grown
+     * breadth-first; an expanded node stays on the list as a singleton with
+     * its links severed, since everything is being destroyed anyway. */
+    const unsigned target = nthreads * 8;
+    tree_node** roots = MALLOC((target + 2) * sizeof(roots[0]));
+    if (!roots)
+	return tree_clear(t, delete_func);
+    roots[0] = t->root;
+    unsigned nroots = 1;
+    for (unsigned i = 0; i < nroots && nroots < target; ++i) {
+	tree_node* node = roots[i];
+	if (node->llink) {
+	    roots[nroots++] = node->llink;
+	    node->llink = NULL;
+	}
+	if (node->rlink) {
+	    roots[nroots++] = node->rlink;
+	    node->rlink = NULL;
+	}
+    }
+    t->root = NULL;
+    t->count = 0;
+
+    if (nthreads > nroots)
+	nthreads = nroots;
+    pthread_t* threads = MALLOC((nthreads - 1) * sizeof(threads[0]));
+    clear_worker_args* args = MALLOC(nthreads * sizeof(args[0]));
+    if (!threads || !args) {
+	FREE(threads);
+	FREE(args);
+	for (unsigned i = 0; i < nroots; ++i)
+	    tree_node_free(roots[i], delete_func);
+	FREE(roots);
+	return count;
+    }
+    for (unsigned k = 0; k < nthreads; ++k) {
+	args[k].roots = roots;
+	args[k].begin = (unsigned)((uint64_t)nroots * k / nthreads);
+	args[k].end = (unsigned)((uint64_t)nroots * (k + 1) / nthreads);
+	args[k].delete_func = delete_func;
+    }
+    unsigned started = 0;
+    while (started + 1 < nthreads &&
+	   pthread_create(&threads[started], NULL, clear_worker,
+			  &args[started + 1]) == 0)
+	started++;
+    /* The caller's thread takes the first range, plus any ranges whose
+     * worker could not be started. */
+    clear_worker(&args[0]);
+    for (unsigned k = started + 1; k < nthreads; ++k)
+	clear_worker(&args[k]);
+    for (unsigned k = 0; k < started; ++k)
+	pthread_join(threads[k], NULL);
+    FREE(threads);
+    FREE(args);
+    FREE(roots);
+    return count;
+}
+
+void*
+tree_clone(const void* Tree, size_t tree_size, size_t node_size)
+{
+    ASSERT(Tree != NULL);
+    ASSERT(tree_size >= sizeof(tree));
+    ASSERT(node_size >= sizeof(tree_node));
+
+    const tree* t = Tree;
+    tree* clone = MALLOC(tree_size);
+    if (!clone)
+	return NULL;
+    memcpy(clone, t, tree_size);
+    STATS_RESET(clone);
+    clone->root = NULL;
+    if (!t->root)
+	return clone;
+
+    tree_node* croot = MALLOC(node_size);
+    if (!croot) {
+	FREE(clone);
+	return NULL;
+    }
+    memcpy(croot, t->root, node_size);
+    croot->parent = croot->llink = croot->rlink = NULL;
+    clone->root = croot;
+
+    /* Copy in preorder, using the parent pointers to back out of finished
+     * subtrees; a NULL child link in the copy marks a subtree not yet
+     * visited. */
+    const tree_node* o = t->root;
+    tree_node* c = croot;
+    for (;;) {
+	const tree_node* next;
+	if (o->llink && !c->llink) {
+	    next = o->llink;
+	} else if (o->rlink && !c->rlink) {
+	    next = o->rlink;
+	} else if (o == t->root) {
+	    break;
+	} else {
+	    o = o->parent;
+	    c = c->parent;
+	    continue;
+	}
+	tree_node* n = MALLOC(node_size);
+	if (!n) {
+	    tree_free(clone, NULL);
+	    return NULL;
+	}
+	memcpy(n, next, node_size);
+	n->parent = c;
+	n->llink = n->rlink = NULL;
+	if (next == o->llink)
+	    c->llink = n;
+	else
+	    c->rlink = n;
+	o = next;
+	c = n;
+    }
+    return clone;
+}
+
+static void
+snapshot_in_order(const tree* t, void** keys, void** datums)
+{
+    size_t i = 0;
+    for (tree_node* node = t->root ? tree_node_min(t->root) : NULL; node;
+	 node = tree_node_next(node)) {
+	keys[i] = node->key;
+	datums[i] = node->datum;
+	++i;
+    }
+    ASSERT(i == t->count);
+}
+
+size_t
+tree_merge(void* Tree, void* Src, tree_rebuild_func rebuild)
+{
+    ASSERT(Tree != NULL);
+    ASSERT(Src != NULL);
+
+    tree* t = Tree;
+    tree* s = Src;
+    if (t->cmp_func != s->cmp_func)
+	return DICT_MERGE_INCOMPATIBLE;
+    if (s->count == 0)
+	return 0;
+
+    /* In-order snapshots of both sides, plus room for the merged sequence.
+     * Until the rebuilds below have both succeeded neither tree is touched,
+     * so every failure exit can leave the merge to the generic fallback. */
+    const size_t n = t->count;
+    const size_t m = s->count;
+    void** mem = MALLOC(4 * (n + m) * sizeof(void*));
+    if (!mem)
+	return DICT_MERGE_INCOMPATIBLE;
+    void** tkeys = mem;
+    void** tdata = tkeys + n;
+    void** skeys = tdata + n;
+    void** sdata = skeys + m;
+    void** mkeys = sdata + m;
+    void** mdata = mkeys + n + m;
+    snapshot_in_order(t, tkeys, tdata);
+    snapshot_in_order(s, skeys, sdata);
+
+    /* Entries whose key |tree| already holds stay behind in |src|; compact
+     * them onto the front of the source snapshot, which never overtakes the
+     * read cursor. */
+    size_t i = 0, j = 0, k = 0, dups = 0;
+    while (i < n && j < m) {
+	const int cmp = dict_cmp(t->cmp_func, tkeys[i], skeys[j]);
+	if (cmp > 0) {
+	    mkeys[k] = skeys[j];
+	    mdata[k] = sdata[j];
+	    ++j;
+	} else {
+	    if (cmp == 0) {
+		skeys[dups] = skeys[j];
+		sdata[dups] = sdata[j];
+		++dups, ++j;
+	    }
+	    mkeys[k] = tkeys[i];
+	    mdata[k] = tdata[i];
+	    ++i;
+	}
+	++k;
+    }
+    for (; i < n; ++i, ++k) {
+	mkeys[k] = tkeys[i];
+	mdata[k] = tdata[i];
+    }
+    for (; j < m; ++j, ++k) {
+	mkeys[k] = skeys[j];
+	mdata[k] = sdata[j];
+    }
+
+    tree_node* troot = rebuild(t, mkeys, mdata, k);
+    if (!troot) {
+	FREE(mem);
+	return DICT_MERGE_INCOMPATIBLE;
+    }
+    tree_node* sroot = NULL;
+    if (dups && !(sroot = rebuild(s, skeys, sdata, dups))) {
+	tree_node_free(troot, NULL);
+	FREE(mem);
+	return DICT_MERGE_INCOMPATIBLE;
+    }
+
+    if (t->root)
+	tree_node_free(t->root, NULL);
+    t->root = troot;
+    t->count = k;
+    if (s->root)
+	tree_node_free(s->root, NULL);
+    s->root = sroot;
+    s->count = dups;
+    FREE(mem);
+    return m - dups;
+}
+
 static size_t
 node_min_leaf_depth(const tree_node* node, size_t depth)
 {
@@ -425,6 +755,21 @@ tree_max_leaf_depth(const void* Tree)
     return t->root ? node_max_leaf_depth(t->root, 1) : 0;
 }
 
+void
+tree_get_stats(void* Tree, dict_stats* stats)
+{
+    tree* t = Tree;
+    ASSERT(t != NULL);
+    ASSERT(stats != NULL);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = t->count;
+    stats->rotation_count = t->rotation_count;
+    stats->min_leaf_depth = tree_min_leaf_depth(t);
+    stats->max_leaf_depth = tree_max_leaf_depth(t);
+    STATS_EXPORT(t, stats);
+}
+
 bool
 tree_iterator_valid(const void* Iterator)
 {
@@ -459,8 +804,16 @@ tree_iterator_next(void* Iterator)
     ASSERT(Iterator != NULL);
     tree_iterator* iterator = Iterator;
     ASSERT(iterator->tree != NULL);
-    if (iterator->node)
-	return (iterator->node = tree_node_next(iterator->node)) != NULL;
+    if (iterator->node) {
+	if ((iterator->node = tree_node_next(iterator->node)) != NULL) {
+	    /* Warm the lines the following advance dereferences first, so a
+	     * full scan overlaps each node's memory latency with the caller's
+	     * work on the current entry. */
+	    PREFETCH(iterator->node->rlink);
+	    PREFETCH(iterator->node->parent);
+	    return true;
+	}
+    }
     return false;
 }
 
@@ -470,8 +823,13 @@ tree_iterator_prev(void* Iterator)
     ASSERT(Iterator != NULL);
     tree_iterator* iterator = Iterator;
     ASSERT(iterator->tree != NULL);
-    if (iterator->node)
-	return (iterator->node = tree_node_prev(iterator->node)) != NULL;
+    if (iterator->node) {
+	if ((iterator->node = tree_node_prev(iterator->node)) != NULL) {
+	    PREFETCH(iterator->node->llink);
+	    PREFETCH(iterator->node->parent);
+	    return true;
+	}
+    }
     return false;
 }
 
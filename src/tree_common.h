@@ -29,6 +29,7 @@
 #define LIBDICT_TREE_COMMON_H__
 
 #include "dict.h"
+#include "dict_private.h"	/* For OP_COUNTERS. */
 
 #define TREE_NODE_FIELDS(node_type) \
     void*		key; \
@@ -42,6 +43,7 @@ typedef struct tree_node_base {
 } tree_node_base;
 
 #define TREE_FIELDS(node_type) \
+    OP_COUNTERS \
     node_type*		root; \
     size_t		count; \
     dict_compare_func	cmp_func; \
@@ -75,6 +77,10 @@ void*	    tree_node_min(void *node);
 void*	    tree_node_max(void *node);
 /* Return the address of the data for the given the key, or NULL if not found. */
 void**	    tree_search(void *tree, const void *key);
+/* Look up |nkeys| keys with their tree descents interleaved, storing the
+ * address of each datum (or NULL) in |results|. Returns the number found. */
+size_t	    tree_search_batch(void *tree, const void* const* keys, size_t nkeys,
+			      void*** results);
 /* Return the node has the key, or NULL if not found. */
 void*	    tree_search_node(void *tree, const void *key);
 /* Return the data/node associated with the first key less than or
@@ -101,16 +107,45 @@ const void* tree_max(const void *tree);
  * stopping if |visit| returns false. Returns the number of times |visit| was
  * called. */
 size_t	    tree_traverse(void *tree, dict_visit_func visit);
+/* Traverses the keys in [lo,hi] in order, pruning subtrees which lie wholly
+ * outside the range; a NULL bound leaves that end of the range open. Same
+ * visitation contract as tree_traverse. */
+size_t	    tree_traverse_range(void *tree, const void *lo, const void *hi,
+				dict_visit_func visit);
 /* Return a count of the elements in |tree|. */
 size_t	    tree_count(const void *tree);
 /* Remove all elements from |tree|. */
 size_t	    tree_clear(void *tree, dict_delete_func delete_func);
+/* As tree_clear, but free the subtrees on |nthreads| threads; |delete_func|
+ * must be thread-safe. |nthreads| must be at least 2. */
+size_t	    tree_clear_parallel(void *tree, dict_delete_func delete_func,
+				unsigned nthreads);
 /* Remove all elements from |tree| and free its memory. */
 size_t	    tree_free(void *tree, dict_delete_func delete_func);
 /* Returns the depth of the leaf with minimal depth, or 0 for an empty tree. */
 size_t	    tree_min_leaf_depth(const void *tree);
 /* Returns the depth of the leaf with maximal depth, or 0 for an empty tree. */
 size_t	    tree_max_leaf_depth(const void *tree);
+/* Fill |stats| with the tree's element count, rotation count and leaf
+ * depths. */
+void	    tree_get_stats(void *tree, dict_stats *stats);
+/* Return a structurally identical copy of |tree|, sharing the original's
+ * keys and data pointers, or NULL on allocation failure. |tree_size| and
+ * |node_size| give the full size of the backend's tree and node structs,
+ * whose extra fields are copied verbatim. */
+void*	    tree_clone(const void *tree, size_t tree_size, size_t node_size);
+/* Callback used by tree_merge to rebuild a tree's contents from a sorted
+ * key/datum sequence; returns the new root, or NULL on allocation failure.
+ * |n| is never zero. */
+typedef void* (*tree_rebuild_func)(void *tree, void* const* keys,
+				   void* const* datums, size_t n);
+/* Merge |src|'s elements into |tree| in linear time: snapshot both trees in
+ * order, merge the two sorted streams, and rebuild each side with |rebuild| -
+ * |tree| from the union, |src| from the duplicate entries it keeps; see
+ * dict_merge for the contract. Returns the number of elements moved, or
+ * DICT_MERGE_INCOMPATIBLE when the compare functions differ or memory is
+ * exhausted before anything has been modified. */
+size_t	    tree_merge(void *tree, void *src, tree_rebuild_func rebuild);
 
 bool	    tree_iterator_valid(const void *iterator);
 void	    tree_iterator_invalidate(void *iterator);
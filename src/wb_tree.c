@@ -90,9 +90,16 @@ static dict_vtable wb_tree_vtable = {
     (dict_search_func)	    tree_search_gt,
     (dict_remove_func)	    wb_tree_remove,
     (dict_clear_func)	    tree_clear,
+    (dict_clear_parallel_func) tree_clear_parallel,
     (dict_traverse_func)    tree_traverse,
     (dict_count_func)	    tree_count,
     (dict_verify_func)	    wb_tree_verify,
+    (dict_search_batch_func) tree_search_batch,
+    (dict_traverse_range_func) tree_traverse_range,
+    (dict_iinit_func)	    wb_itor_init,
+    (dict_get_stats_func)   tree_get_stats,
+    (dict_clone_func)	    wb_tree_clone,
+    (dict_merge_func)	    wb_tree_merge,
 };
 
 static itor_vtable wb_tree_itor_vtable = {
@@ -132,6 +139,7 @@ wb_tree_new(dict_compare_func cmp_func)
 	tree->count = 0;
 	tree->cmp_func = cmp_func;
 	tree->rotation_count = 0;
+	STATS_RESET(tree);
     }
     return tree;
 }
@@ -150,6 +158,89 @@ wb_dict_new(dict_compare_func cmp_func)
     return dct;
 }
 
+static void
+free_subtree(wb_node* node)
+{
+    if (node) {
+	free_subtree(node->llink);
+	free_subtree(node->rlink);
+	FREE(node);
+    }
+}
+
+static wb_node*
+from_sorted_build(void* const* keys, void* const* datums, size_t n)
+{
+    if (!n)
+	return NULL;
+    const size_t mid = n / 2;
+    wb_node* node = node_new(keys[mid]);
+    if (!node)
+	return NULL;
+    if (datums)
+	node->datum = datums[mid];
+    node->llink = from_sorted_build(keys, datums, mid);
+    node->rlink = from_sorted_build(keys + mid + 1,
+				    datums ? datums + mid + 1 : NULL,
+				    n - mid - 1);
+    if ((mid && !node->llink) || (n - mid - 1 && !node->rlink)) {
+	free_subtree(node);
+	return NULL;
+    }
+    if (node->llink)
+	node->llink->parent = node;
+    if (node->rlink)
+	node->rlink->parent = node;
+    node->weight = WEIGHT(node->llink) + WEIGHT(node->rlink);
+    return node;
+}
+
+wb_tree*
+wb_tree_from_sorted(dict_compare_func cmp_func, void* const* keys,
+		    void* const* datums, size_t nkeys)
+{
+    wb_tree* tree = wb_tree_new(cmp_func);
+    if (tree && nkeys) {
+	if (!(tree->root = from_sorted_build(keys, datums, nkeys))) {
+	    FREE(tree);
+	    return NULL;
+	}
+	tree->count = nkeys;
+    }
+    return tree;
+}
+
+dict*
+wb_dict_from_sorted(dict_compare_func cmp_func, void* const* keys,
+		    void* const* datums, size_t nkeys)
+{
+    dict* dct = MALLOC(sizeof(*dct));
+    if (dct) {
+	if (!(dct->_object = wb_tree_from_sorted(cmp_func, keys, datums, nkeys))) {
+	    FREE(dct);
+	    return NULL;
+	}
+	dct->_vtable = &wb_tree_vtable;
+    }
+    return dct;
+}
+
+static void*
+merge_rebuild(void* tree, void* const* keys, void* const* datums, size_t n)
+{
+    (void)tree;
+    return from_sorted_build(keys, datums, n);
+}
+
+size_t
+wb_tree_merge(wb_tree* tree, wb_tree* src)
+{
+    ASSERT(tree != NULL);
+    ASSERT(src != NULL);
+
+    return tree_merge(tree, src, merge_rebuild);
+}
+
 size_t
 wb_tree_free(wb_tree* tree, dict_delete_func delete_func)
 {
@@ -160,6 +251,14 @@ wb_tree_free(wb_tree* tree, dict_delete_func delete_func)
     return count;
 }
 
+wb_tree*
+wb_tree_clone(wb_tree* tree)
+{
+    ASSERT(tree != NULL);
+
+    return tree_clone(tree, sizeof(*tree), sizeof(wb_node));
+}
+
 void**
 wb_tree_search(wb_tree* tree, const void* key)
 {
@@ -262,11 +361,12 @@ wb_tree_insert(wb_tree* tree, void* key)
     int cmp = 0;
 
     ASSERT(tree != NULL);
+    STATS_INC(tree, insert_count);
 
     wb_node* node = tree->root;
     wb_node* parent = NULL;
     while (node) {
-	cmp = tree->cmp_func(key, node->key);
+	cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0)
 	    parent = node, node = node->llink;
 	else if (cmp)
@@ -306,10 +406,11 @@ wb_tree_remove(wb_tree* tree, const void* key)
 {
     ASSERT(tree != NULL);
     ASSERT(key != NULL);
+    STATS_INC(tree, remove_count);
 
     wb_node* node = tree->root;
     while (node) {
-	int cmp = tree->cmp_func(key, node->key);
+	int cmp = dict_cmp(tree->cmp_func, key, node->key);
 	if (cmp < 0) {
 	    node = node->llink;
 	} else if (cmp) {
@@ -400,6 +501,57 @@ wb_tree_max(const wb_tree* tree)
     return node->key;
 }
 
+bool
+wb_tree_select(const wb_tree* tree, size_t rank, const void** key, void** datum)
+{
+    ASSERT(tree != NULL);
+    ASSERT(key != NULL);
+    ASSERT(datum != NULL);
+
+    if (rank >= tree->count)
+	return false;
+
+    /* The weight of a subtree exceeds its number of keys by one, so the
+     * left subtree holds WEIGHT(llink)-1 keys, all with lesser ranks. */
+    const wb_node* node = tree->root;
+    for (;;) {
+	const size_t lcount = WEIGHT(node->llink) - 1;
+	if (rank < lcount) {
+	    node = node->llink;
+	} else if (rank > lcount) {
+	    rank -= lcount + 1;
+	    node = node->rlink;
+	} else
+	    break;
+    }
+    *key = node->key;
+    *datum = node->datum;
+    return true;
+}
+
+bool
+wb_tree_rank(const wb_tree* tree, const void* key, size_t* rank)
+{
+    ASSERT(tree != NULL);
+    ASSERT(rank != NULL);
+
+    size_t below = 0;
+    const wb_node* node = tree->root;
+    while (node) {
+	const int cmp = dict_cmp(tree->cmp_func, key, node->key);
+	if (cmp < 0) {
+	    node = node->llink;
+	} else if (cmp > 0) {
+	    below += WEIGHT(node->llink);
+	    node = node->rlink;
+	} else {
+	    *rank = below + WEIGHT(node->llink) - 1;
+	    return true;
+	}
+    }
+    return false;
+}
+
 size_t
 wb_tree_traverse(wb_tree* tree, dict_visit_func visit)
 {
@@ -512,6 +664,19 @@ wb_itor_new(wb_tree* tree)
     return itor;
 }
 
+itor_vtable*
+wb_itor_init(wb_tree* tree, wb_itor* itor)
+{
+    ASSERT(tree != NULL);
+    ASSERT(itor != NULL);
+    _Static_assert(sizeof(wb_itor) <= DICT_ITOR_STATE_MAX,
+		   "wb_itor must fit in dict_itor_storage");
+
+    itor->tree = tree;
+    itor->node = NULL;
+    return &wb_tree_itor_vtable;
+}
+
 dict_itor*
 wb_dict_itor_new(wb_tree* tree)
 {
@@ -1,19 +1,26 @@
 /* unit_tests.c
  * Copyright (C) 2012 Farooq Mela. All rights reserved. */
 
+/* For mkstemp() and pthreads under -std=c11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
 #include <float.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 
 #include "dict.h"
+#include "dict_typed.h"
 #include "src/hashtable_common.h"   /* For dict_prime_geq() */
 
 #define TEST_FUNC(func) { (char *)#func, func }
@@ -32,17 +39,49 @@ struct closest_lookup_info {
 
 void test_basic(dict *dct, const struct key_info *keys, const unsigned nkeys,
 		const struct closest_lookup_info *cl_infos, unsigned n_cl_infos);
+void test_basic_bp_tree(void);
 void test_basic_hashtable_1bucket(void);
 void test_basic_hashtable2_1bucket(void);
+void test_basic_hashtable3_1bucket(void);
 void test_basic_hashtable_nbuckets(void);
 void test_basic_hashtable2_nbuckets(void);
+void test_basic_hashtable3_nbuckets(void);
+void test_basic_hashtable_incremental(void);
+void test_basic_hashtable2_incremental(void);
+void test_basic_hashtable_pooled(void);
+void test_basic_hashtable_filtered(void);
+void test_basic_hashtable_pow2(void);
+void test_basic_hashtable2_pow2(void);
+void test_basic_hashtable_mt(void);
 void test_basic_height_balanced_tree(void);
 void test_basic_path_reduction_tree(void);
 void test_basic_red_black_tree(void);
+void test_basic_red_black_tree_pooled(void);
 void test_basic_skiplist(void);
+void test_basic_skiplist_pooled(void);
+void test_skiplist_seeded(void);
+void test_basic_skiplist_mt(void);
+void test_hashtable_mt_threads(void);
+void test_skiplist_mt_threads(void);
 void test_basic_splay_tree(void);
 void test_basic_treap(void);
 void test_basic_weight_balanced_tree(void);
+void test_from_sorted(void);
+void test_wb_order_statistics(void);
+void test_traverse_range(void);
+void test_itor_init(void);
+void test_typed_containers(void);
+void test_snapshot(void);
+void test_stats(void);
+void test_clone(void);
+void test_hashtable2_shrink(void);
+void test_ptr_keys(void);
+void test_splay_policy(void);
+void test_merge(void);
+void test_itor_next_batch(void);
+void test_str_funcs(void);
+void test_clear_parallel(void);
+void test_hashtable_itor_remove(void);
 void test_search(dict *dct, dict_itor *itor, const char *key, const char *value);
 void test_closest_lookup(dict *dct, const struct closest_lookup_info *cl_infos, unsigned n_cl_infos);
 void test_primes_geq(void);
@@ -51,17 +90,49 @@ void shuffle(char **p, unsigned size);
 bool is_prime(unsigned n);
 
 static CU_TestInfo basic_tests[] = {
+    TEST_FUNC(test_basic_bp_tree),
     TEST_FUNC(test_basic_hashtable_1bucket),
     TEST_FUNC(test_basic_hashtable2_1bucket),
+    TEST_FUNC(test_basic_hashtable3_1bucket),
     TEST_FUNC(test_basic_hashtable_nbuckets),
     TEST_FUNC(test_basic_hashtable2_nbuckets),
+    TEST_FUNC(test_basic_hashtable3_nbuckets),
+    TEST_FUNC(test_basic_hashtable_incremental),
+    TEST_FUNC(test_basic_hashtable2_incremental),
+    TEST_FUNC(test_basic_hashtable_pooled),
+    TEST_FUNC(test_basic_hashtable_filtered),
+    TEST_FUNC(test_basic_hashtable_pow2),
+    TEST_FUNC(test_basic_hashtable2_pow2),
+    TEST_FUNC(test_basic_hashtable_mt),
     TEST_FUNC(test_basic_height_balanced_tree),
     TEST_FUNC(test_basic_path_reduction_tree),
     TEST_FUNC(test_basic_red_black_tree),
+    TEST_FUNC(test_basic_red_black_tree_pooled),
     TEST_FUNC(test_basic_skiplist),
+    TEST_FUNC(test_basic_skiplist_pooled),
+    TEST_FUNC(test_skiplist_seeded),
+    TEST_FUNC(test_basic_skiplist_mt),
+    TEST_FUNC(test_hashtable_mt_threads),
+    TEST_FUNC(test_skiplist_mt_threads),
     TEST_FUNC(test_basic_splay_tree),
     TEST_FUNC(test_basic_treap),
     TEST_FUNC(test_basic_weight_balanced_tree),
+    TEST_FUNC(test_from_sorted),
+    TEST_FUNC(test_wb_order_statistics),
+    TEST_FUNC(test_traverse_range),
+    TEST_FUNC(test_itor_init),
+    TEST_FUNC(test_typed_containers),
+    TEST_FUNC(test_snapshot),
+    TEST_FUNC(test_stats),
+    TEST_FUNC(test_clone),
+    TEST_FUNC(test_hashtable2_shrink),
+    TEST_FUNC(test_ptr_keys),
+    TEST_FUNC(test_splay_policy),
+    TEST_FUNC(test_merge),
+    TEST_FUNC(test_itor_next_batch),
+    TEST_FUNC(test_str_funcs),
+    TEST_FUNC(test_clear_parallel),
+    TEST_FUNC(test_hashtable_itor_remove),
     TEST_FUNC(test_primes_geq),
     TEST_FUNC(test_version_string),
     CU_TEST_INFO_NULL
@@ -324,13 +395,16 @@ void test_basic(dict *dct, const struct key_info *keys, const unsigned nkeys,
     CU_ASSERT_EQUAL(dict_count(dct), nkeys);
 
     if (dct->_vtable->insert == (dict_insert_func)hashtable_insert ||
-	dct->_vtable->insert == (dict_insert_func)hashtable2_insert) {
+	dct->_vtable->insert == (dict_insert_func)hashtable2_insert ||
+	dct->_vtable->insert == (dict_insert_func)hashtable3_insert) {
 	/* Verify that hashtable_resize works as expected. */
 	if (dct->_vtable->insert == (dict_insert_func)hashtable_insert) {
 	    CU_ASSERT_TRUE(hashtable_resize(dict_private(dct), 3));
-	} else {
+	} else if (dct->_vtable->insert == (dict_insert_func)hashtable2_insert) {
 	    CU_ASSERT_TRUE(hashtable2_resize(dict_private(dct),
 					     dict_prime_geq(nkeys * 5)));
+	} else {
+	    CU_ASSERT_TRUE(hashtable3_resize(dict_private(dct), nkeys * 5));
 	}
 	CU_ASSERT_TRUE(dict_verify(dct));
 	CU_ASSERT_EQUAL(dict_count(dct), nkeys);
@@ -341,6 +415,21 @@ void test_basic(dict *dct, const struct key_info *keys, const unsigned nkeys,
     for (unsigned i = 0; i < nkeys; ++i)
 	test_search(dct, itor, keys[i].key, keys[i].value);
 
+    /* Batched lookup must agree with single-key searches. */
+    const void** batch_keys = malloc(nkeys * sizeof(batch_keys[0]));
+    void*** batch_results = malloc(nkeys * sizeof(batch_results[0]));
+    for (unsigned i = 0; i < nkeys; ++i)
+	batch_keys[i] = keys[i].key;
+    CU_ASSERT_EQUAL(dict_search_batch(dct, batch_keys, nkeys, batch_results),
+		    nkeys);
+    for (unsigned i = 0; i < nkeys; ++i) {
+	CU_ASSERT_PTR_NOT_NULL(batch_results[i]);
+	CU_ASSERT_EQUAL(*batch_results[i], keys[i].value);
+    }
+    free(batch_results);
+    free(batch_keys);
+    CU_ASSERT_TRUE(dict_verify(dct));
+
     for (unsigned i = 0; i < nkeys; ++i) {
 	dict_insert_result result = dict_insert(dct, keys[i].key);
 	CU_ASSERT_FALSE(result.inserted);
@@ -372,7 +461,9 @@ void test_basic(dict *dct, const struct key_info *keys, const unsigned nkeys,
 	CU_ASSERT_EQUAL(keys_matched, 1);
 
 	if (dct->_vtable->insert != (dict_insert_func)hashtable_insert &&
-	    dct->_vtable->insert != (dict_insert_func)hashtable2_insert) {
+	    dct->_vtable->insert != (dict_insert_func)hashtable2_insert &&
+	    dct->_vtable->insert != (dict_insert_func)hashtable3_insert &&
+	    dct->_vtable->insert != (dict_insert_func)hashtable_mt_insert) {
 	    if (last_key) {
 		CU_ASSERT_TRUE(strcmp(last_key, dict_itor_key(itor)) < 0);
 	    }
@@ -402,7 +493,9 @@ void test_basic(dict *dct, const struct key_info *keys, const unsigned nkeys,
 	CU_ASSERT_EQUAL(keys_matched, 1);
 
 	if (dct->_vtable->insert != (dict_insert_func)hashtable_insert &&
-	    dct->_vtable->insert != (dict_insert_func)hashtable2_insert) {
+	    dct->_vtable->insert != (dict_insert_func)hashtable2_insert &&
+	    dct->_vtable->insert != (dict_insert_func)hashtable3_insert &&
+	    dct->_vtable->insert != (dict_insert_func)hashtable_mt_insert) {
 	    if (last_key) {
 		CU_ASSERT_TRUE(strcmp(last_key, dict_itor_key(itor)) > 0);
 	    }
@@ -491,6 +584,14 @@ void test_basic_hashtable2_1bucket()
 	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
 }
 
+void test_basic_hashtable3_1bucket()
+{
+    test_basic(hashtable3_dict_new(dict_str_cmp, dict_str_hash, 1),
+	       keys1, NKEYS1, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(hashtable3_dict_new(dict_str_cmp, dict_str_hash, 1),
+	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
 void test_basic_hashtable_nbuckets()
 {
     test_basic(hashtable_dict_new(dict_str_cmp, dict_str_hash, 7),
@@ -507,6 +608,70 @@ void test_basic_hashtable2_nbuckets()
 	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
 }
 
+void test_basic_hashtable3_nbuckets()
+{
+    test_basic(hashtable3_dict_new(dict_str_cmp, dict_str_hash, 64),
+	       keys1, NKEYS1, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(hashtable3_dict_new(dict_str_cmp, dict_str_hash, 64),
+	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
+void test_basic_hashtable_incremental()
+{
+    test_basic(hashtable_dict_new_incremental(dict_str_cmp, dict_str_hash, 1),
+	       keys1, NKEYS1, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(hashtable_dict_new_incremental(dict_str_cmp, dict_str_hash, 1),
+	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
+void test_basic_hashtable2_incremental()
+{
+    test_basic(hashtable2_dict_new_incremental(dict_str_cmp, dict_str_hash, 1),
+	       keys1, NKEYS1, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(hashtable2_dict_new_incremental(dict_str_cmp, dict_str_hash, 1),
+	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
+void test_basic_hashtable_pooled()
+{
+    test_basic(hashtable_dict_new_pooled(dict_str_cmp, dict_str_hash, 1),
+	       keys1, NKEYS1, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(hashtable_dict_new_pooled(dict_str_cmp, dict_str_hash, 1),
+	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
+void test_basic_hashtable_filtered()
+{
+    test_basic(hashtable_dict_new_filtered(dict_str_cmp, dict_str_hash, 1),
+	       keys1, NKEYS1, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(hashtable_dict_new_filtered(dict_str_cmp, dict_str_hash, 1),
+	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
+void test_basic_hashtable_pow2()
+{
+    test_basic(hashtable_dict_new_pow2(dict_str_cmp, dict_str_hash, 1),
+	       keys1, NKEYS1, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(hashtable_dict_new_pow2(dict_str_cmp, dict_str_hash, 1),
+	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
+void test_basic_hashtable2_pow2()
+{
+    test_basic(hashtable2_dict_new_pow2(dict_str_cmp, dict_str_hash, 1),
+	       keys1, NKEYS1, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(hashtable2_dict_new_pow2(dict_str_cmp, dict_str_hash, 1),
+	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
+void test_basic_hashtable_mt()
+{
+    test_basic(hashtable_mt_dict_new(dict_str_cmp, dict_str_hash, 1),
+	       keys1, NKEYS1, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(hashtable_mt_dict_new(dict_str_cmp, dict_str_hash, 1),
+	       keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
 void test_basic_height_balanced_tree()
 {
     test_basic(hb_dict_new(dict_str_cmp), keys1, NKEYS1,
@@ -531,6 +696,14 @@ void test_basic_red_black_tree()
 	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
 }
 
+void test_basic_red_black_tree_pooled()
+{
+    test_basic(rb_dict_new_pooled(dict_str_cmp), keys1, NKEYS1,
+	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(rb_dict_new_pooled(dict_str_cmp), keys2, NKEYS2,
+	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
 void test_basic_skiplist()
 {
     test_basic(skiplist_dict_new(dict_str_cmp, 13), keys1, NKEYS1,
@@ -539,6 +712,49 @@ void test_basic_skiplist()
 	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
 }
 
+void test_basic_skiplist_pooled()
+{
+    test_basic(skiplist_dict_new_pooled(dict_str_cmp, 13), keys1, NKEYS1,
+	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(skiplist_dict_new_pooled(dict_str_cmp, 13), keys2, NKEYS2,
+	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
+void test_skiplist_seeded()
+{
+    skiplist* lists[2] = {
+	skiplist_new(dict_str_cmp, 12),
+	skiplist_new_pooled(dict_str_cmp, 12),
+    };
+    for (int i = 0; i < 2; ++i) {
+	CU_ASSERT_PTR_NOT_NULL(lists[i]);
+	skiplist_set_seed(lists[i], 0xC0FFEE);
+	for (unsigned j = 0; j < NKEYS1; ++j)
+	    CU_ASSERT_TRUE(skiplist_insert(lists[i],
+					   (void*)keys1[j].key).inserted);
+	CU_ASSERT_TRUE(skiplist_verify(lists[i]));
+	CU_ASSERT_EQUAL(skiplist_count(lists[i]), NKEYS1);
+    }
+
+    /* Same seed and insertion order, so identical tower heights. */
+    size_t counts[2][16];
+    CU_ASSERT_EQUAL(skiplist_link_count_histogram(lists[0], counts[0], 16),
+		    skiplist_link_count_histogram(lists[1], counts[1], 16));
+    for (size_t i = 0; i < 16; ++i)
+	CU_ASSERT_EQUAL(counts[0][i], counts[1][i]);
+
+    for (int i = 0; i < 2; ++i)
+	CU_ASSERT_EQUAL(skiplist_free(lists[i], NULL), NKEYS1);
+}
+
+void test_basic_skiplist_mt()
+{
+    test_basic(skiplist_mt_dict_new(dict_str_cmp, 13), keys1, NKEYS1,
+	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(skiplist_mt_dict_new(dict_str_cmp, 13), keys2, NKEYS2,
+	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
 void test_basic_splay_tree()
 {
     test_basic(sp_dict_new(dict_str_cmp), keys1, NKEYS1,
@@ -547,6 +763,124 @@ void test_basic_splay_tree()
 	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
 }
 
+#define MT_THREADS	    4
+#define MT_KEYS_PER_THREAD  1500
+#define MT_SHARED_KEYS	    64
+#define MT_ROUNDS	    3000
+
+struct mt_stress_arg {
+    dict*	dct;
+    unsigned	id;
+    unsigned	seed;
+    long	net_shared;	/* Successful shared inserts minus removes. */
+    unsigned	errors;
+};
+
+static char mt_own_keys[MT_THREADS][MT_KEYS_PER_THREAD][16];
+static char mt_shared_keys[MT_SHARED_KEYS][16];
+
+/* CUnit assertions are not thread-safe, so workers only count failures;
+ * the spawning test asserts on the totals after joining. */
+static void* mt_stress_worker(void* ptr)
+{
+    struct mt_stress_arg* arg = ptr;
+    dict* dct = arg->dct;
+
+    /* Keys in this thread's own range are touched by no one else, so their
+     * data can be stored and asserted on even while other threads run. */
+    for (unsigned i = 0; i < MT_KEYS_PER_THREAD; ++i) {
+	char* key = mt_own_keys[arg->id][i];
+	dict_insert_result ins = dict_insert(dct, key);
+	if (!ins.inserted || !ins.datum_ptr)
+	    arg->errors++;
+	else
+	    *ins.datum_ptr = key;
+	char* old_key = mt_own_keys[arg->id][i / 2];
+	void** datum = dict_search(dct, old_key);
+	if (!datum || *datum != old_key)
+	    arg->errors++;
+    }
+
+    /* Hammer a small shared key range from every thread at once. The data
+     * are never dereferenced here: a racing remove may free the slot an
+     * insert or search returned a pointer to. */
+    unsigned rand_state = arg->seed;
+    for (unsigned r = 0; r < MT_ROUNDS; ++r) {
+	rand_state = rand_state * 1103515245 + 12345;
+	char* key = mt_shared_keys[(rand_state >> 16) % MT_SHARED_KEYS];
+	if (rand_state & 1) {
+	    if (dict_insert(dct, key).inserted)
+		arg->net_shared++;
+	} else {
+	    dict_remove_result rem = dict_remove(dct, key);
+	    if (rem.removed) {
+		if (rem.key != key)
+		    arg->errors++;
+		arg->net_shared--;
+	    }
+	}
+    }
+
+    for (unsigned i = 0; i < MT_KEYS_PER_THREAD; ++i) {
+	char* key = mt_own_keys[arg->id][i];
+	dict_remove_result rem = dict_remove(dct, key);
+	if (!rem.removed || rem.key != key)
+	    arg->errors++;
+    }
+    return NULL;
+}
+
+static void mt_stress(dict* dct)
+{
+    CU_ASSERT_PTR_NOT_NULL(dct);
+
+    for (unsigned t = 0; t < MT_THREADS; ++t)
+	for (unsigned i = 0; i < MT_KEYS_PER_THREAD; ++i)
+	    snprintf(mt_own_keys[t][i], sizeof(mt_own_keys[t][i]),
+		     "t%u-%04u", t, i);
+    for (unsigned i = 0; i < MT_SHARED_KEYS; ++i)
+	snprintf(mt_shared_keys[i], sizeof(mt_shared_keys[i]), "c%03u", i);
+
+    pthread_t threads[MT_THREADS];
+    struct mt_stress_arg args[MT_THREADS];
+    for (unsigned t = 0; t < MT_THREADS; ++t) {
+	args[t] = (struct mt_stress_arg) {
+	    .dct = dct, .id = t, .seed = 0x9E3779B9u * (t + 1),
+	};
+	CU_ASSERT_EQUAL(pthread_create(&threads[t], NULL, mt_stress_worker,
+				       &args[t]), 0);
+    }
+
+    long remaining = 0;
+    for (unsigned t = 0; t < MT_THREADS; ++t) {
+	CU_ASSERT_EQUAL(pthread_join(threads[t], NULL), 0);
+	CU_ASSERT_EQUAL(args[t].errors, 0);
+	remaining += args[t].net_shared;
+    }
+
+    /* Every thread removed its own keys, so only the net survivors of the
+     * contended range are left, and the threads' tallies must agree with
+     * what the table actually holds. */
+    CU_ASSERT_TRUE(remaining >= 0);
+    CU_ASSERT_EQUAL(dict_count(dct), (size_t)remaining);
+    long present = 0;
+    for (unsigned i = 0; i < MT_SHARED_KEYS; ++i)
+	present += dict_search(dct, mt_shared_keys[i]) != NULL;
+    CU_ASSERT_EQUAL(present, remaining);
+    CU_ASSERT_TRUE(dict_verify(dct));
+    CU_ASSERT_EQUAL(dict_free(dct, NULL), (size_t)remaining);
+}
+
+void test_hashtable_mt_threads()
+{
+    mt_stress(hashtable_mt_dict_new(dict_str_cmp, dict_str_hash, 64));
+}
+
+void test_skiplist_mt_threads()
+{
+    mt_stress(skiplist_mt_dict_new(dict_str_cmp, 12));
+}
+
 void test_basic_treap()
 {
     test_basic(tr_dict_new(dict_str_cmp, NULL), keys1, NKEYS1,
@@ -555,6 +889,14 @@ void test_basic_treap()
 	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
 }
 
+void test_basic_bp_tree()
+{
+    test_basic(bp_dict_new(dict_str_cmp), keys1, NKEYS1,
+	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    test_basic(bp_dict_new(dict_str_cmp), keys2, NKEYS2,
+	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+}
+
 void test_basic_weight_balanced_tree()
 {
     test_basic(wb_dict_new(dict_str_cmp), keys1, NKEYS1,
@@ -563,6 +905,755 @@ void test_basic_weight_balanced_tree()
 	       closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
 }
 
+void test_from_sorted()
+{
+    enum { N = 64 };
+    static char storage[N][8];
+    void* skeys[N];
+    void* vals[N];
+    for (unsigned i = 0; i < N; ++i) {
+	snprintf(storage[i], sizeof(storage[i]), "k%02u", i);
+	skeys[i] = storage[i];
+	vals[i] = &storage[i];
+    }
+
+    for (unsigned n = 0; n <= N; n += (n < 8 ? 1 : 19)) {
+	dict* dcts[] = {
+	    rb_dict_from_sorted(dict_str_cmp, skeys, vals, n),
+	    hb_dict_from_sorted(dict_str_cmp, skeys, vals, n),
+	    pr_dict_from_sorted(dict_str_cmp, skeys, vals, n),
+	    sp_dict_from_sorted(dict_str_cmp, skeys, vals, n),
+	    wb_dict_from_sorted(dict_str_cmp, skeys, vals, n),
+	    tr_dict_from_sorted(dict_str_cmp, NULL, skeys, vals, n),
+	};
+	for (unsigned d = 0; d < sizeof(dcts) / sizeof(dcts[0]); ++d) {
+	    dict* dct = dcts[d];
+	    CU_ASSERT_PTR_NOT_NULL(dct);
+	    CU_ASSERT_TRUE(dict_verify(dct));
+	    CU_ASSERT_EQUAL(dict_count(dct), n);
+	    for (unsigned i = 0; i < n; ++i) {
+		void** search = dict_search(dct, skeys[i]);
+		CU_ASSERT_PTR_NOT_NULL(search);
+		CU_ASSERT_EQUAL(*search, vals[i]);
+	    }
+	    dict_itor* itor = dict_itor_new(dct);
+	    unsigned count = 0;
+	    char* last_key = NULL;
+	    for (dict_itor_first(itor); dict_itor_valid(itor);
+		 dict_itor_next(itor)) {
+		if (last_key)
+		    CU_ASSERT_TRUE(strcmp(last_key, dict_itor_key(itor)) < 0);
+		last_key = dict_itor_key(itor);
+		++count;
+	    }
+	    CU_ASSERT_EQUAL(count, n);
+	    dict_itor_free(itor);
+	    dict_free(dct, NULL);
+	}
+    }
+}
+
+void test_wb_order_statistics()
+{
+    enum { N = 100 };
+    static char storage[N][8];
+    for (unsigned i = 0; i < N; ++i)
+	snprintf(storage[i], sizeof(storage[i]), "k%03u", i);
+
+    wb_tree* tree = wb_tree_new(dict_str_cmp);
+    CU_ASSERT_PTR_NOT_NULL(tree);
+    for (unsigned i = 0; i < N; ++i)
+	CU_ASSERT_TRUE(wb_tree_insert(tree, storage[(i * 37 + 11) % N]).inserted);
+
+    const void* key = NULL;
+    void* datum = NULL;
+    size_t rank = ~(size_t)0;
+    for (unsigned i = 0; i < N; ++i) {
+	CU_ASSERT_TRUE(wb_tree_select(tree, i, &key, &datum));
+	CU_ASSERT_EQUAL(key, storage[i]);
+	CU_ASSERT_TRUE(wb_tree_rank(tree, storage[i], &rank));
+	CU_ASSERT_EQUAL(rank, i);
+    }
+    CU_ASSERT_FALSE(wb_tree_select(tree, N, &key, &datum));
+    CU_ASSERT_FALSE(wb_tree_rank(tree, "missing", &rank));
+
+    /* Ranks must shift down as earlier keys are removed. */
+    for (unsigned i = 0; i < N; i += 2)
+	CU_ASSERT_TRUE(wb_tree_remove(tree, storage[i]).removed);
+    for (unsigned i = 1; i < N; i += 2) {
+	CU_ASSERT_TRUE(wb_tree_rank(tree, storage[i], &rank));
+	CU_ASSERT_EQUAL(rank, i / 2);
+	CU_ASSERT_TRUE(wb_tree_select(tree, i / 2, &key, &datum));
+	CU_ASSERT_EQUAL(key, storage[i]);
+    }
+    CU_ASSERT_FALSE(wb_tree_rank(tree, storage[0], &rank));
+    wb_tree_free(tree, NULL);
+}
+
+static char range_keys[100][8];
+static unsigned range_base, range_visited;
+static bool range_stop;
+
+static bool range_visit(const void* key, void* datum)
+{
+    (void)datum;
+    CU_ASSERT_EQUAL(key, range_keys[range_base + range_visited]);
+    ++range_visited;
+    return !range_stop || range_visited < 3;
+}
+
+void test_traverse_range()
+{
+    enum { N = 100 };
+    for (unsigned i = 0; i < N; ++i)
+	snprintf(range_keys[i], sizeof(range_keys[i]), "k%03u", i);
+
+    dict* dcts[8];
+    dcts[0] = hb_dict_new(dict_str_cmp);
+    dcts[1] = pr_dict_new(dict_str_cmp);
+    dcts[2] = rb_dict_new(dict_str_cmp);
+    dcts[3] = sp_dict_new(dict_str_cmp);
+    dcts[4] = tr_dict_new(dict_str_cmp, NULL);
+    dcts[5] = wb_dict_new(dict_str_cmp);
+    dcts[6] = bp_dict_new(dict_str_cmp);
+    dcts[7] = skiplist_dict_new(dict_str_cmp, 10);
+    for (unsigned d = 0; d < sizeof(dcts) / sizeof(dcts[0]); ++d) {
+	dict* dct = dcts[d];
+	CU_ASSERT_PTR_NOT_NULL(dct);
+	CU_ASSERT_TRUE(dict_has_traverse_range(dct));
+	for (unsigned i = 0; i < N; ++i)
+	    CU_ASSERT_TRUE(dict_insert(dct, range_keys[(i * 37 + 11) % N]).inserted);
+
+	range_base = 20; range_visited = 0; range_stop = false;
+	CU_ASSERT_EQUAL(dict_traverse_range(dct, range_keys[20], range_keys[39],
+					    range_visit), 20);
+	CU_ASSERT_EQUAL(range_visited, 20);
+
+	/* A NULL bound leaves that end of the range open. */
+	range_base = 0; range_visited = 0;
+	CU_ASSERT_EQUAL(dict_traverse_range(dct, NULL, range_keys[9],
+					    range_visit), 10);
+	range_base = 90; range_visited = 0;
+	CU_ASSERT_EQUAL(dict_traverse_range(dct, range_keys[90], NULL,
+					    range_visit), 10);
+	range_base = 0; range_visited = 0;
+	CU_ASSERT_EQUAL(dict_traverse_range(dct, NULL, NULL, range_visit), N);
+
+	/* Bounds need not be present: "k0395" lies between k039 and k040. */
+	range_base = 40; range_visited = 0;
+	CU_ASSERT_EQUAL(dict_traverse_range(dct, "k0395", "k0595",
+					    range_visit), 20);
+
+	CU_ASSERT_EQUAL(dict_traverse_range(dct, range_keys[60], range_keys[50],
+					    range_visit), 0);
+
+	/* The visit where |range_visit| returns false is still counted. */
+	range_base = 10; range_visited = 0; range_stop = true;
+	CU_ASSERT_EQUAL(dict_traverse_range(dct, range_keys[10], NULL,
+					    range_visit), 3);
+	range_stop = false;
+
+	dict_free(dct, NULL);
+    }
+
+    dict* dct = hashtable_dict_new(dict_str_cmp, dict_str_hash, 11);
+    CU_ASSERT_FALSE(dict_has_traverse_range(dct));
+    dict_free(dct, NULL);
+}
+
+void test_itor_init()
+{
+    enum { N = 50 };
+    static char keys[N][8];
+    for (unsigned i = 0; i < N; ++i)
+	snprintf(keys[i], sizeof(keys[i]), "k%02u", i);
+
+    dict* dcts[12];
+    dcts[0] = hb_dict_new(dict_str_cmp);
+    dcts[1] = pr_dict_new(dict_str_cmp);
+    dcts[2] = rb_dict_new(dict_str_cmp);
+    dcts[3] = sp_dict_new(dict_str_cmp);
+    dcts[4] = tr_dict_new(dict_str_cmp, NULL);
+    dcts[5] = wb_dict_new(dict_str_cmp);
+    dcts[6] = bp_dict_new(dict_str_cmp);
+    dcts[7] = skiplist_dict_new(dict_str_cmp, 10);
+    dcts[8] = hashtable_dict_new(dict_str_cmp, dict_str_hash, 11);
+    dcts[9] = hashtable2_dict_new(dict_str_cmp, dict_str_hash, 11);
+    dcts[10] = hashtable3_dict_new(dict_str_cmp, dict_str_hash, 11);
+    dcts[11] = hashtable_mt_dict_new(dict_str_cmp, dict_str_hash, 64);
+    for (unsigned d = 0; d < sizeof(dcts) / sizeof(dcts[0]); ++d) {
+	dict* dct = dcts[d];
+	CU_ASSERT_PTR_NOT_NULL(dct);
+	for (unsigned i = 0; i < N; ++i)
+	    CU_ASSERT_TRUE(dict_insert(dct, keys[i]).inserted);
+
+	dict_itor_storage storage;
+	dict_itor* itor = dict_itor_init(dct, &storage);
+	CU_ASSERT_PTR_EQUAL(itor, &storage);
+	CU_ASSERT_FALSE(dict_itor_valid(itor));
+	unsigned count = 0;
+	for (dict_itor_first(itor); dict_itor_valid(itor); dict_itor_next(itor)) {
+	    CU_ASSERT_PTR_NOT_NULL(dict_itor_key(itor));
+	    ++count;
+	}
+	CU_ASSERT_EQUAL(count, N);
+	CU_ASSERT_TRUE(dict_itor_search(itor, keys[N / 2]));
+	CU_ASSERT_PTR_EQUAL(dict_itor_key(itor), keys[N / 2]);
+	/* No dict_itor_free: the iterator lives in |storage|. */
+	dict_free(dct, NULL);
+    }
+}
+
+#define test_intcmp(a, b) (((a) > (b)) - ((a) < (b)))
+static uint64_t test_inthash(int k)
+{
+    return (14695981039346656037ULL ^ (uint64_t)(unsigned)k) *
+	1099511628211ULL;
+}
+DICT_TYPED_TREE(test_int_tree, int, int, test_intcmp)
+DICT_TYPED_HASHTABLE(test_int_table, int, int, test_inthash, test_intcmp)
+
+void test_typed_containers()
+{
+    enum { N = 1000 };
+    test_int_tree tree;
+    test_int_tree_init(&tree);
+    test_int_table tbl;
+    CU_ASSERT_TRUE(test_int_table_init(&tbl, 16));
+
+    for (int i = 0; i < N; ++i) {
+	const int k = (i * 37 + 11) % N;
+	bool inserted = false;
+	int* datum = test_int_tree_insert(&tree, k, &inserted);
+	CU_ASSERT_PTR_NOT_NULL(datum);
+	CU_ASSERT_TRUE(inserted);
+	*datum = k * 3;
+	datum = test_int_table_insert(&tbl, k, &inserted);
+	CU_ASSERT_PTR_NOT_NULL(datum);
+	CU_ASSERT_TRUE(inserted);
+	*datum = k * 3;
+    }
+    CU_ASSERT_EQUAL(test_int_tree_count(&tree), N);
+    CU_ASSERT_EQUAL(test_int_table_count(&tbl), N);
+    CU_ASSERT_TRUE(test_int_tree_verify(&tree));
+    CU_ASSERT_TRUE(test_int_table_verify(&tbl));
+
+    bool inserted = true;
+    CU_ASSERT_PTR_NOT_NULL(test_int_tree_insert(&tree, 7, &inserted));
+    CU_ASSERT_FALSE(inserted);
+
+    for (int k = 0; k < N; ++k) {
+	int* datum = test_int_tree_search(&tree, k);
+	CU_ASSERT_PTR_NOT_NULL(datum);
+	CU_ASSERT_EQUAL(*datum, k * 3);
+	datum = test_int_table_search(&tbl, k);
+	CU_ASSERT_PTR_NOT_NULL(datum);
+	CU_ASSERT_EQUAL(*datum, k * 3);
+    }
+    CU_ASSERT_PTR_NULL(test_int_tree_search(&tree, N));
+    CU_ASSERT_PTR_NULL(test_int_table_search(&tbl, -1));
+
+    for (int k = 0; k < N; k += 2) {
+	CU_ASSERT_TRUE(test_int_tree_remove(&tree, k));
+	CU_ASSERT_TRUE(test_int_table_remove(&tbl, k));
+    }
+    CU_ASSERT_FALSE(test_int_tree_remove(&tree, 0));
+    CU_ASSERT_FALSE(test_int_table_remove(&tbl, 0));
+    CU_ASSERT_EQUAL(test_int_tree_count(&tree), N / 2);
+    CU_ASSERT_EQUAL(test_int_table_count(&tbl), N / 2);
+    CU_ASSERT_TRUE(test_int_tree_verify(&tree));
+    CU_ASSERT_TRUE(test_int_table_verify(&tbl));
+    CU_ASSERT_PTR_NULL(test_int_tree_search(&tree, 2));
+    CU_ASSERT_PTR_NOT_NULL(test_int_tree_search(&tree, 3));
+
+    CU_ASSERT_EQUAL(test_int_tree_clear(&tree), N / 2);
+    CU_ASSERT_EQUAL(test_int_table_clear(&tbl), N / 2);
+    CU_ASSERT_EQUAL(test_int_tree_count(&tree), 0);
+    test_int_table_free(&tbl);
+}
+
+static size_t test_snapshot_len(const void* s)
+{
+    return strlen(s) + 1;
+}
+
+void test_snapshot()
+{
+    enum { N = 200 };
+    static char keys[N][8], vals[N][8];
+    dict* src = rb_dict_new(dict_str_cmp);
+    CU_ASSERT_PTR_NOT_NULL(src);
+    for (unsigned i = 0; i < N; ++i) {
+	snprintf(keys[i], sizeof(keys[i]), "k%03u", (i * 37 + 11) % N);
+	snprintf(vals[i], sizeof(vals[i]), "v%03u", (i * 37 + 11) % N);
+	*dict_insert(src, keys[i]).datum_ptr = vals[i];
+    }
+
+    char path[] = "/tmp/libdict_snap_XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_TRUE(fd >= 0);
+    CU_ASSERT_TRUE(dict_snapshot_save(src, fd, test_snapshot_len,
+				      test_snapshot_len, dict_str_cmp));
+    close(fd);
+    dict_free(src, NULL);
+
+    fd = open(path, O_RDONLY);
+    CU_ASSERT_TRUE(fd >= 0);
+    dict* snap = dict_snapshot_dict_load(fd, dict_str_cmp);
+    close(fd);
+    unlink(path);
+    CU_ASSERT_PTR_NOT_NULL(snap);
+    CU_ASSERT_EQUAL(dict_count(snap), N);
+    CU_ASSERT_TRUE(dict_verify(snap));
+    for (unsigned i = 0; i < N; ++i) {
+	void** datum = dict_search(snap, keys[i]);
+	CU_ASSERT_PTR_NOT_NULL(datum);
+	CU_ASSERT_STRING_EQUAL(*datum, vals[i]);
+    }
+    CU_ASSERT_PTR_NULL(dict_search(snap, "missing"));
+    CU_ASSERT_TRUE(dict_has_near_search(snap));
+    void** datum = dict_search_ge(snap, "k0005");
+    CU_ASSERT_PTR_NOT_NULL(datum);
+    CU_ASSERT_STRING_EQUAL(*datum, "v001");
+
+    /* Snapshots are read-only. */
+    CU_ASSERT_FALSE(dict_insert(snap, keys[0]).inserted);
+    CU_ASSERT_FALSE(dict_remove(snap, keys[0]).removed);
+    CU_ASSERT_EQUAL(dict_clear(snap, NULL), 0);
+    CU_ASSERT_EQUAL(dict_count(snap), N);
+
+    dict_itor* itor = dict_itor_new(snap);
+    unsigned count = 0;
+    char* last_key = NULL;
+    for (dict_itor_first(itor); dict_itor_valid(itor); dict_itor_next(itor)) {
+	if (last_key)
+	    CU_ASSERT_TRUE(strcmp(last_key, dict_itor_key(itor)) < 0);
+	last_key = dict_itor_key(itor);
+	++count;
+    }
+    CU_ASSERT_EQUAL(count, N);
+    dict_itor_free(itor);
+    CU_ASSERT_EQUAL(dict_free(snap, NULL), N);
+}
+
+void test_stats()
+{
+    enum { N = 500 };
+    static char keys[N][8];
+    for (unsigned i = 0; i < N; ++i)
+	snprintf(keys[i], sizeof(keys[i]), "k%03u", (i * 151 + 7) % N);
+
+    dict_stats stats;
+    dict* dct = rb_dict_new(dict_str_cmp);
+    for (unsigned i = 0; i < N; ++i)
+	*dict_insert(dct, keys[i]).datum_ptr = keys[i];
+    dict_get_stats(dct, &stats);
+    CU_ASSERT_EQUAL(stats.count, N);
+    CU_ASSERT_TRUE(stats.rotation_count > 0);
+    CU_ASSERT_TRUE(stats.min_leaf_depth > 0);
+    CU_ASSERT_TRUE(stats.min_leaf_depth <= stats.max_leaf_depth);
+    /* A red-black tree's deepest leaf is at most twice as deep as its
+     * shallowest. */
+    CU_ASSERT_TRUE(stats.max_leaf_depth <= 2 * stats.min_leaf_depth);
+    CU_ASSERT_EQUAL(stats.table_size, 0);
+    dict_free(dct, NULL);
+
+    dct = hashtable_dict_new(dict_str_cmp, dict_str_hash, 11);
+    for (unsigned i = 0; i < N; ++i)
+	*dict_insert(dct, keys[i]).datum_ptr = keys[i];
+    dict_get_stats(dct, &stats);
+    CU_ASSERT_EQUAL(stats.count, N);
+    CU_ASSERT_TRUE(stats.table_size >= 11);
+    CU_ASSERT_TRUE(stats.resize_count > 0);
+    CU_ASSERT_TRUE(stats.max_probe_length >= 1);
+    CU_ASSERT_TRUE(stats.mean_probe_length >= 1.0);
+    CU_ASSERT_TRUE(stats.mean_probe_length <= (double)stats.max_probe_length);
+    CU_ASSERT_EQUAL(stats.rotation_count, 0);
+    dict_free(dct, NULL);
+
+    dct = skiplist_dict_new(dict_str_cmp, 10);
+    for (unsigned i = 0; i < N; ++i)
+	*dict_insert(dct, keys[i]).datum_ptr = keys[i];
+    dict_get_stats(dct, &stats);
+    CU_ASSERT_EQUAL(stats.count, N);
+    size_t nodes = 0;
+    for (unsigned i = 0; i < DICT_STATS_LINKS; ++i)
+	nodes += stats.link_count[i];
+    CU_ASSERT_EQUAL(nodes, N);
+    CU_ASSERT_TRUE(stats.link_count[1] > 0);
+    dict_free(dct, NULL);
+}
+
+void test_clone()
+{
+    dict* originals[7];
+    originals[0] = hb_dict_new(dict_str_cmp);
+    originals[1] = pr_dict_new(dict_str_cmp);
+    originals[2] = rb_dict_new(dict_str_cmp);
+    originals[3] = rb_dict_new_pooled(dict_str_cmp);
+    originals[4] = sp_dict_new(dict_str_cmp);
+    originals[5] = tr_dict_new(dict_str_cmp, NULL);
+    originals[6] = wb_dict_new(dict_str_cmp);
+    for (unsigned i = 0; i < sizeof(originals) / sizeof(originals[0]); ++i) {
+	dict* dct = originals[i];
+	CU_ASSERT_TRUE(dict_has_clone(dct));
+	for (unsigned j = 0; j < NKEYS1; ++j)
+	    *dict_insert(dct, keys1[j].key).datum_ptr = keys1[j].value;
+	dict* clone = dict_clone(dct);
+	CU_ASSERT_PTR_NOT_NULL(clone);
+	CU_ASSERT_TRUE(dict_verify(clone));
+	CU_ASSERT_EQUAL(dict_count(clone), dict_count(dct));
+	for (unsigned j = 0; j < NKEYS1; ++j) {
+	    void** datum = dict_search(clone, keys1[j].key);
+	    CU_ASSERT_PTR_NOT_NULL(datum);
+	    CU_ASSERT_PTR_EQUAL(*datum, keys1[j].value);
+	}
+	/* Mutating the original must not disturb the clone. */
+	CU_ASSERT_TRUE(dict_remove(dct, keys1[0].key).removed);
+	CU_ASSERT_PTR_NOT_NULL(dict_search(clone, keys1[0].key));
+	CU_ASSERT_EQUAL(dict_count(clone), dict_count(dct) + 1);
+	CU_ASSERT_TRUE(dict_verify(clone));
+	dict_free(clone, NULL);
+	dict_free(dct, NULL);
+    }
+
+    /* Backends without clone support report it and return NULL. */
+    dict* dct = hashtable_dict_new(dict_str_cmp, dict_str_hash, 11);
+    CU_ASSERT_FALSE(dict_has_clone(dct));
+    CU_ASSERT_PTR_NULL(dict_clone(dct));
+    dict_free(dct, NULL);
+}
+
+void test_hashtable2_shrink()
+{
+    enum { N = 1000 };
+    static char keys[N][8];
+    for (unsigned i = 0; i < N; ++i)
+	snprintf(keys[i], sizeof(keys[i]), "s%04u", i);
+
+    hashtable2* table = hashtable2_new_shrinking(dict_str_cmp, dict_str_hash, 11);
+    for (unsigned i = 0; i < N; ++i)
+	*hashtable2_insert(table, keys[i]).datum_ptr = keys[i];
+    const size_t peak = hashtable2_size(table);
+    CU_ASSERT_TRUE(peak > N);
+    for (unsigned i = 0; i < N - 10; ++i)
+	CU_ASSERT_TRUE(hashtable2_remove(table, keys[i]).removed);
+    CU_ASSERT_TRUE(hashtable2_size(table) < peak);
+    CU_ASSERT_TRUE(hashtable2_verify(table));
+    for (unsigned i = N - 10; i < N; ++i)
+	CU_ASSERT_PTR_NOT_NULL(hashtable2_search(table, keys[i]));
+    /* The table never shrinks below its initial size. */
+    hashtable2_clear(table, NULL);
+    CU_ASSERT_EQUAL(hashtable2_size(table), 11);
+    hashtable2_free(table, NULL);
+
+    /* Manual compaction for tables without the automatic policy. */
+    table = hashtable2_new(dict_str_cmp, dict_str_hash, 11);
+    for (unsigned i = 0; i < N; ++i)
+	*hashtable2_insert(table, keys[i]).datum_ptr = keys[i];
+    for (unsigned i = 0; i < N; i += 2)
+	CU_ASSERT_TRUE(hashtable2_remove(table, keys[i]).removed);
+    const size_t grown = hashtable2_size(table);
+    CU_ASSERT_TRUE(hashtable2_shrink_to_fit(table));
+    CU_ASSERT_TRUE(hashtable2_size(table) < grown);
+    CU_ASSERT_TRUE(hashtable2_verify(table));
+    CU_ASSERT_EQUAL(hashtable2_count(table), N / 2);
+    hashtable2_free(table, NULL);
+}
+
+void test_ptr_keys()
+{
+    /* With dict_ptr_cmp the key slot holds the key's value, not its address,
+     * and the backends compare the values inline. */
+    enum { N = 500 };
+    dict* dicts[] = {
+	hb_dict_new(dict_ptr_cmp),
+	pr_dict_new(dict_ptr_cmp),
+	rb_dict_new(dict_ptr_cmp),
+	sp_dict_new(dict_ptr_cmp),
+	tr_dict_new(dict_ptr_cmp, NULL),
+	wb_dict_new(dict_ptr_cmp),
+	skiplist_dict_new(dict_ptr_cmp, 12),
+    };
+    for (unsigned i = 0; i < sizeof(dicts) / sizeof(dicts[0]); ++i) {
+	dict* dct = dicts[i];
+	CU_ASSERT_PTR_NOT_NULL(dct);
+	for (uintptr_t k = N; k > 0; --k) {
+	    dict_insert_result result = dict_insert(dct, (void*)(k * 3));
+	    CU_ASSERT_TRUE(result.inserted);
+	    *result.datum_ptr = (void*)(k * 3 + 1);
+	}
+	CU_ASSERT_EQUAL(dict_count(dct), N);
+	CU_ASSERT_TRUE(dict_verify(dct));
+	for (uintptr_t k = 1; k <= N; ++k) {
+	    void** datum = dict_search(dct, (void*)(k * 3));
+	    CU_ASSERT_PTR_NOT_NULL(datum);
+	    CU_ASSERT_PTR_EQUAL(*datum, (void*)(k * 3 + 1));
+	    CU_ASSERT_PTR_NULL(dict_search(dct, (void*)(k * 3 + 2)));
+	}
+	dict_itor* itor = dict_itor_new(dct);
+	uintptr_t prev = 0;
+	for (dict_itor_first(itor); dict_itor_valid(itor); dict_itor_next(itor)) {
+	    const uintptr_t key = (uintptr_t)dict_itor_key(itor);
+	    CU_ASSERT_TRUE(key > prev);
+	    prev = key;
+	}
+	dict_itor_free(itor);
+	for (uintptr_t k = 1; k <= N; k += 2)
+	    CU_ASSERT_TRUE(dict_remove(dct, (void*)(k * 3)).removed);
+	CU_ASSERT_EQUAL(dict_count(dct), N / 2);
+	CU_ASSERT_TRUE(dict_verify(dct));
+	dict_free(dct, NULL);
+    }
+}
+
+void test_splay_policy()
+{
+    /* Every policy must agree with the classic splay tree on contents. */
+    const sp_splay_policy policies[] = {
+	SP_SPLAY_ALWAYS, SP_SPLAY_SEMI, SP_SPLAY_PERIODIC, SP_SPLAY_NEVER,
+    };
+    for (unsigned i = 0; i < sizeof(policies) / sizeof(policies[0]); ++i) {
+	test_basic(sp_dict_new_policy(dict_str_cmp, policies[i], 4),
+		   keys1, NKEYS1, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+	test_basic(sp_dict_new_policy(dict_str_cmp, policies[i], 4),
+		   keys2, NKEYS2, closest_lookup_infos, NUM_CLOSEST_LOOKUP_INFOS);
+    }
+
+    /* No-splay searches must not rotate. */
+    dict* dct = sp_dict_new_policy(dict_str_cmp, SP_SPLAY_NEVER, 0);
+    for (unsigned j = 0; j < NKEYS1; ++j)
+	*dict_insert(dct, keys1[j].key).datum_ptr = keys1[j].value;
+    dict_stats stats;
+    dict_get_stats(dct, &stats);
+    const size_t rotations = stats.rotation_count;
+    for (unsigned pass = 0; pass < 10; ++pass)
+	for (unsigned j = 0; j < NKEYS1; ++j)
+	    CU_ASSERT_PTR_NOT_NULL(dict_search(dct, keys1[j].key));
+    dict_get_stats(dct, &stats);
+    CU_ASSERT_EQUAL(stats.rotation_count, rotations);
+    CU_ASSERT_TRUE(dict_verify(dct));
+    dict_free(dct, NULL);
+}
+
+static void
+test_merge_pair(dict* dst, dict* src)
+{
+    /* |dst| gets the first 25 keys, |src| the last 25; they overlap in 12. */
+    enum { FIRST = 25, OVERLAP = 12 };
+    for (unsigned j = 0; j < FIRST; ++j)
+	*dict_insert(dst, keys1[j].key).datum_ptr = keys1[j].value;
+    for (unsigned j = FIRST - OVERLAP; j < NKEYS1; ++j)
+	*dict_insert(src, keys1[j].key).datum_ptr = keys1[j].alt;
+
+    const size_t moved = dict_merge(dst, src);
+    CU_ASSERT_EQUAL(moved, NKEYS1 - FIRST);
+    CU_ASSERT_EQUAL(dict_count(dst), NKEYS1);
+    CU_ASSERT_EQUAL(dict_count(src), OVERLAP);
+    CU_ASSERT_TRUE(dict_verify(dst));
+    CU_ASSERT_TRUE(dict_verify(src));
+    for (unsigned j = 0; j < NKEYS1; ++j) {
+	void** datum = dict_search(dst, keys1[j].key);
+	CU_ASSERT_PTR_NOT_NULL(datum);
+	if (datum) {
+	    /* Which of two entries with equal keys wins is unspecified. */
+	    CU_ASSERT_TRUE(*datum == keys1[j].value || *datum == keys1[j].alt);
+	}
+	const bool overlapping = j >= FIRST - OVERLAP && j < FIRST;
+	CU_ASSERT_EQUAL(dict_search(src, keys1[j].key) != NULL, overlapping);
+    }
+    dict_free(dst, NULL);
+    dict_free(src, NULL);
+}
+
+void test_merge()
+{
+    /* Native paths: treap meld and hashtable chain splicing. */
+    test_merge_pair(tr_dict_new(dict_str_cmp, NULL),
+		    tr_dict_new(dict_str_cmp, NULL));
+    test_merge_pair(hashtable_dict_new(dict_str_cmp, dict_str_hash, 11),
+		    hashtable_dict_new(dict_str_cmp, dict_str_hash, 31));
+    test_merge_pair(hashtable_dict_new_filtered(dict_str_cmp, dict_str_hash, 11),
+		    hashtable_dict_new_filtered(dict_str_cmp, dict_str_hash, 11));
+    /* Native paths: the balanced trees merge the sorted streams and rebuild. */
+    test_merge_pair(hb_dict_new(dict_str_cmp), hb_dict_new(dict_str_cmp));
+    test_merge_pair(pr_dict_new(dict_str_cmp), pr_dict_new(dict_str_cmp));
+    test_merge_pair(rb_dict_new(dict_str_cmp), rb_dict_new(dict_str_cmp));
+    test_merge_pair(sp_dict_new(dict_str_cmp), sp_dict_new(dict_str_cmp));
+    test_merge_pair(wb_dict_new(dict_str_cmp), wb_dict_new(dict_str_cmp));
+    /* Pooled nodes cannot be spliced or rebuilt in place, so these exercise
+     * the fallback, as does merging across backend types. */
+    test_merge_pair(hashtable_dict_new(dict_str_cmp, dict_str_hash, 11),
+		    hashtable_dict_new_pooled(dict_str_cmp, dict_str_hash, 11));
+    test_merge_pair(rb_dict_new(dict_str_cmp),
+		    rb_dict_new_pooled(dict_str_cmp));
+    test_merge_pair(hb_dict_new(dict_str_cmp),
+		    skiplist_dict_new(dict_str_cmp, 10));
+}
+
+void test_itor_next_batch()
+{
+    dict* dicts[] = {
+	hb_dict_new(dict_str_cmp),
+	rb_dict_new(dict_str_cmp),
+	bp_dict_new(dict_str_cmp),
+	skiplist_dict_new(dict_str_cmp, 10),
+	hashtable_dict_new(dict_str_cmp, dict_str_hash, 11),
+    };
+    for (unsigned i = 0; i < sizeof(dicts) / sizeof(dicts[0]); ++i) {
+	dict* dct = dicts[i];
+	for (unsigned j = 0; j < NKEYS1; ++j)
+	    *dict_insert(dct, keys1[j].key).datum_ptr = keys1[j].value;
+	/* Batched reads must see the same sequence as one-at-a-time reads. */
+	dict_itor* itor = dict_itor_new(dct);
+	dict_itor* ref = dict_itor_new(dct);
+	dict_itor_first(itor);
+	dict_itor_first(ref);
+	size_t total = 0;
+	for (;;) {
+	    const void* keys[7];
+	    void** datums[7];
+	    const size_t read = dict_itor_next_batch(itor, keys, datums, 7);
+	    for (size_t k = 0; k < read; ++k) {
+		CU_ASSERT_TRUE(dict_itor_valid(ref));
+		CU_ASSERT_PTR_EQUAL(keys[k], dict_itor_key(ref));
+		CU_ASSERT_PTR_EQUAL(datums[k], dict_itor_datum(ref));
+		dict_itor_next(ref);
+	    }
+	    total += read;
+	    if (read < 7)
+		break;
+	}
+	CU_ASSERT_EQUAL(total, NKEYS1);
+	CU_ASSERT_FALSE(dict_itor_valid(itor));
+	CU_ASSERT_FALSE(dict_itor_valid(ref));
+	dict_itor_free(itor);
+	dict_itor_free(ref);
+	dict_free(dct, NULL);
+    }
+}
+
+void test_str_funcs()
+{
+    /* Exercise the word-at-a-time string compare and hash at every small
+     * length and alignment, against strcmp and the hash's own documented
+     * identity with its length-aware variant. */
+    char buf1[80], buf2[80];
+    for (unsigned off1 = 0; off1 < 8; ++off1) {
+	for (unsigned off2 = 0; off2 < 8; ++off2) {
+	    for (unsigned len = 0; len < 48; ++len) {
+		char* s1 = buf1 + off1;
+		char* s2 = buf2 + off2;
+		for (unsigned i = 0; i < len; ++i)
+		    s1[i] = s2[i] = 'a' + (char)(i % 26);
+		s1[len] = s2[len] = '\0';
+		CU_ASSERT_EQUAL(dict_str_cmp(s1, s2), 0);
+		CU_ASSERT_EQUAL(dict_str_hash(s1),
+				dict_str_hash_len(s1, strlen(s1)));
+		CU_ASSERT_EQUAL(dict_str_hash(s1), dict_str_hash(s2));
+		if (len > 0) {
+		    /* Differ in the last byte only. */
+		    s2[len - 1] = (s1[len - 1] == 'z') ? 'y' : 'z';
+		    const int c = strcmp(s1, s2);
+		    const int d = dict_str_cmp(s1, s2);
+		    CU_ASSERT_TRUE((c > 0) == (d > 0) && (c < 0) == (d < 0));
+		    CU_ASSERT_TRUE((dict_str_cmp(s2, s1) > 0) == (d < 0));
+		    CU_ASSERT_NOT_EQUAL(dict_str_hash(s1), dict_str_hash(s2));
+		    /* A proper prefix orders before the longer string. */
+		    s2[len - 1] = '\0';
+		    CU_ASSERT_TRUE(dict_str_cmp(s1, s2) > 0);
+		    CU_ASSERT_TRUE(dict_str_cmp(s2, s1) < 0);
+		    CU_ASSERT_NOT_EQUAL(dict_str_hash(s1), dict_str_hash(s2));
+		}
+	    }
+	}
+    }
+    CU_ASSERT_EQUAL(dict_str_hash_len("abcdef", 3),
+		    dict_str_hash_len("abcxyz", 3));
+    CU_ASSERT_NOT_EQUAL(dict_str_hash_len("abcdef", 3),
+			dict_str_hash_len("abcdef", 4));
+}
+
+void test_clear_parallel()
+{
+    dict* dicts[] = {
+	hb_dict_new(dict_str_cmp),
+	sp_dict_new(dict_str_cmp),
+	tr_dict_new(dict_str_cmp, NULL),
+	wb_dict_new(dict_str_cmp),
+	hashtable_dict_new(dict_str_cmp, dict_str_hash, 11),
+	/* No parallel path: must fall back to the serial clear. */
+	rb_dict_new(dict_str_cmp),
+    };
+    for (unsigned i = 0; i < sizeof(dicts) / sizeof(dicts[0]); ++i) {
+	dict* dct = dicts[i];
+	CU_ASSERT_PTR_NOT_NULL(dct);
+	for (unsigned j = 0; j < NKEYS1; ++j)
+	    *dict_insert(dct, keys1[j].key).datum_ptr = keys1[j].value;
+	CU_ASSERT_EQUAL(dict_clear_parallel(dct, NULL, 4), NKEYS1);
+	CU_ASSERT_EQUAL(dict_count(dct), 0);
+	CU_ASSERT_TRUE(dict_verify(dct));
+	/* The emptied structure must still accept and find keys. */
+	for (unsigned j = 0; j < NKEYS1; ++j)
+	    *dict_insert(dct, keys1[j].key).datum_ptr = keys1[j].value;
+	CU_ASSERT_EQUAL(dict_count(dct), NKEYS1);
+	for (unsigned j = 0; j < NKEYS1; ++j)
+	    CU_ASSERT_PTR_NOT_NULL(dict_search(dct, keys1[j].key));
+	CU_ASSERT_TRUE(dict_verify(dct));
+	CU_ASSERT_EQUAL(dict_free(dct, NULL), NKEYS1);
+    }
+}
+
+void test_hashtable_itor_remove()
+{
+    dict* dicts[] = {
+	hashtable_dict_new(dict_str_cmp, dict_str_hash, 3),
+	hashtable_dict_new_pooled(dict_str_cmp, dict_str_hash, 3),
+	hashtable_dict_new_filtered(dict_str_cmp, dict_str_hash, 3),
+	hashtable2_dict_new(dict_str_cmp, dict_str_hash, 3),
+    };
+    for (unsigned i = 0; i < sizeof(dicts) / sizeof(dicts[0]); ++i) {
+	dict* dct = dicts[i];
+	CU_ASSERT_PTR_NOT_NULL(dct);
+	for (unsigned j = 0; j < NKEYS1; ++j)
+	    *dict_insert(dct, keys1[j].key).datum_ptr = keys1[j].value;
+	/* Delete-during-scan: remove entries whose value starts 'a'..'m',
+	 * keep the rest, without restarting the iteration. */
+	unsigned removed = 0;
+	dict_itor* itor = dict_itor_new(dct);
+	dict_itor_first(itor);
+	while (dict_itor_valid(itor)) {
+	    const char* value = *dict_itor_datum(itor);
+	    if (value[0] <= 'm') {
+		++removed;
+		dict_itor_remove(itor);
+	    } else {
+		dict_itor_next(itor);
+	    }
+	}
+	dict_itor_free(itor);
+	CU_ASSERT_EQUAL(dict_count(dct), NKEYS1 - removed);
+	CU_ASSERT_TRUE(dict_verify(dct));
+	for (unsigned j = 0; j < NKEYS1; ++j) {
+	    void** datum = dict_search(dct, keys1[j].key);
+	    if (keys1[j].value[0] <= 'm')
+		CU_ASSERT_PTR_NULL(datum);
+	    else
+		CU_ASSERT_PTR_NOT_NULL(datum);
+	}
+	/* Removing the last remaining entries invalidates the iterator. */
+	itor = dict_itor_new(dct);
+	dict_itor_first(itor);
+	while (dict_itor_valid(itor))
+	    dict_itor_remove(itor);
+	CU_ASSERT_FALSE(dict_itor_remove(itor));
+	dict_itor_free(itor);
+	CU_ASSERT_EQUAL(dict_count(dct), 0);
+	CU_ASSERT_TRUE(dict_verify(dct));
+	dict_free(dct, NULL);
+    }
+}
+
 bool is_prime(unsigned n)
 {
     if (n <= 0)
@@ -0,0 +1,490 @@
+/* workload.c
+ * Synthetic mixed-workload benchmark with percentile latency reporting.
+ * Copyright (C) 2001-2014 Farooq Mela */
+
+#define _POSIX_C_SOURCE 200809L	    /* For clock_gettime() under -std=c11. */
+
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dict.h"
+
+static const char appname[] = "workload";
+
+#ifdef __GNUC__
+# define NORETURN	__attribute__((__noreturn__))
+#else
+# define NORETURN
+#endif
+static void quit(const char *, ...) NORETURN;
+static void *xmalloc(size_t size);
+
+/* Operation classes making up the workload mix. */
+enum op_class {
+    OP_READ,
+    OP_UPDATE,
+    OP_INSERT,
+    OP_DELETE,
+    OP_SCAN,
+    OP_CLASSES
+};
+
+static const char *op_names[OP_CLASSES] = {
+    "read", "update", "insert", "delete", "scan"
+};
+
+/* Per-class latency samples, in nanoseconds. */
+struct op_stats {
+    uint32_t	*lat;
+    size_t	count;
+    size_t	hits;
+    uint64_t	total_ns;
+};
+
+struct options {
+    char	type;
+    size_t	nkeys;
+    size_t	nops;
+    size_t	warmup;
+    unsigned	mix[OP_CLASSES];    /* Percentages summing to 100. */
+    unsigned	scan_len;
+    unsigned	preload;	    /* Percent of keys inserted up front. */
+    bool	zipfian;
+    double	theta;
+    bool	csv;
+    uint64_t	seed;
+};
+
+/* Gray et al.'s Zipfian generator, as popularized by YCSB: item ranks are
+ * drawn so that the i-th most popular key is requested with probability
+ * proportional to 1/i^theta. */
+struct zipf_gen {
+    size_t	n;
+    double	theta;
+    double	alpha;
+    double	zetan;
+    double	eta;
+};
+
+static uint64_t rand_state;
+
+static uint64_t
+rand_u64(void)
+{
+    /* xorshift64*; deterministic across runs for a given seed. */
+    rand_state ^= rand_state >> 12;
+    rand_state ^= rand_state << 25;
+    rand_state ^= rand_state >> 27;
+    return rand_state * 2685821657736338717ULL;
+}
+
+static double
+rand_unit(void)
+{
+    return (rand_u64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void
+zipf_init(struct zipf_gen *gen, size_t n, double theta)
+{
+    gen->n = n;
+    gen->theta = theta;
+    gen->zetan = 0.0;
+    for (size_t i = 1; i <= n; ++i)
+	gen->zetan += 1.0 / pow((double)i, theta);
+    gen->alpha = 1.0 / (1.0 - theta);
+    const double zeta2 = 1.0 + pow(0.5, theta);
+    gen->eta = (1.0 - pow(2.0 / (double)n, 1.0 - theta)) /
+	(1.0 - zeta2 / gen->zetan);
+}
+
+static size_t
+zipf_next(const struct zipf_gen *gen)
+{
+    const double u = rand_unit();
+    const double uz = u * gen->zetan;
+    if (uz < 1.0)
+	return 0;
+    if (uz < 1.0 + pow(0.5, gen->theta))
+	return 1;
+    size_t rank = (size_t)((double)gen->n *
+			   pow(gen->eta * u - gen->eta + 1.0, gen->alpha));
+    return rank < gen->n ? rank : gen->n - 1;
+}
+
+static dict *
+create_dictionary(char type, const char **container_name)
+{
+    dict_compare_func cmp_func = dict_str_cmp;
+    dict_hash_func hash_func = dict_str_hash;
+
+    switch (type) {
+	case 'h':
+	    *container_name = "hb";
+	    return hb_dict_new(cmp_func);
+
+	case 'p':
+	    *container_name = "pr";
+	    return pr_dict_new(cmp_func);
+
+	case 'r':
+	    *container_name = "rb";
+	    return rb_dict_new(cmp_func);
+
+	case 't':
+	    *container_name = "tr";
+	    return tr_dict_new(cmp_func, NULL);
+
+	case 's':
+	    *container_name = "sp";
+	    return sp_dict_new(cmp_func);
+
+	case 'S':
+	    *container_name = "sk";
+	    return skiplist_dict_new(cmp_func, 12);
+
+	case 'w':
+	    *container_name = "wb";
+	    return wb_dict_new(cmp_func);
+
+	case 'b':
+	    *container_name = "bp";
+	    return bp_dict_new(cmp_func);
+
+	case 'H':
+	    *container_name = "ht";
+	    return hashtable_dict_new(cmp_func, hash_func, 97);
+
+	case '2':
+	    *container_name = "h2";
+	    return hashtable2_dict_new(cmp_func, hash_func, 97);
+
+	case '3':
+	    *container_name = "h3";
+	    return hashtable3_dict_new(cmp_func, hash_func, 97);
+
+	case 'M':
+	    *container_name = "mt";
+	    return hashtable_mt_dict_new(cmp_func, hash_func, 97);
+
+	case 'L':
+	    *container_name = "sl";
+	    return skiplist_mt_dict_new(cmp_func, 12);
+
+	default:
+	    quit("type must be one of b, h, p, r, t, s, w, S, H, M, L, 2 or 3");
+    }
+}
+
+static void
+usage(void)
+{
+    fprintf(stderr,
+	    "usage: %s [options] type\n"
+	    "type: dictionary type letter, as in benchmark and demo:\n"
+	    "   b: B+ tree             h: height-balanced tree\n"
+	    "   p: path-reduction tree r: red-black tree\n"
+	    "   t: treap               s: splay tree\n"
+	    "   w: weight-balanced     S: skiplist\n"
+	    "   H: hashtable           2: hashtable 2\n"
+	    "   3: hashtable 3         M: hashtable_mt\n"
+	    "   L: skiplist_mt\n"
+	    "options:\n"
+	    "   -n keys    distinct keys in the key space (default 100000)\n"
+	    "   -o ops     measured operations (default 1000000)\n"
+	    "   -W ops     untimed warmup operations (default 10000)\n"
+	    "   -m r,u,i,d,s\n"
+	    "              percentage mix of read,update,insert,delete,scan\n"
+	    "              summing to 100 (default 95,0,5,0,0)\n"
+	    "   -l len     entries per scan (default 100)\n"
+	    "   -P pct     percent of keys preloaded (default 50)\n"
+	    "   -z         Zipfian key distribution (default uniform)\n"
+	    "   -T theta   Zipfian skew parameter (default 0.99)\n"
+	    "   -c         CSV output: one row per operation class\n"
+	    "   -s seed    random seed (default 1)\n",
+	    appname);
+    exit(EXIT_FAILURE);
+}
+
+static void
+parse_options(int argc, char **argv, struct options *opts)
+{
+    memset(opts, 0, sizeof(*opts));
+    opts->nkeys = 100000;
+    opts->nops = 1000000;
+    opts->warmup = 10000;
+    opts->mix[OP_READ] = 95;
+    opts->mix[OP_INSERT] = 5;
+    opts->scan_len = 100;
+    opts->preload = 50;
+    opts->theta = 0.99;
+    opts->seed = 1;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+	const char opt = argv[i][1];
+	if (opt == 'z') {
+	    opts->zipfian = true;
+	    continue;
+	}
+	if (opt == 'c') {
+	    opts->csv = true;
+	    continue;
+	}
+	if (++i >= argc)
+	    usage();
+	const char *arg = argv[i];
+	switch (opt) {
+	    case 'n': opts->nkeys = strtoul(arg, NULL, 10); break;
+	    case 'o': opts->nops = strtoul(arg, NULL, 10); break;
+	    case 'W': opts->warmup = strtoul(arg, NULL, 10); break;
+	    case 'l': opts->scan_len = (unsigned)strtoul(arg, NULL, 10); break;
+	    case 'P': opts->preload = (unsigned)strtoul(arg, NULL, 10); break;
+	    case 'T': opts->theta = strtod(arg, NULL); break;
+	    case 's': opts->seed = strtoull(arg, NULL, 10); break;
+	    case 'm':
+		if (sscanf(arg, "%u,%u,%u,%u,%u",
+			   &opts->mix[OP_READ], &opts->mix[OP_UPDATE],
+			   &opts->mix[OP_INSERT], &opts->mix[OP_DELETE],
+			   &opts->mix[OP_SCAN]) != 5)
+		    usage();
+		break;
+	    default:
+		usage();
+	}
+    }
+    if (i + 1 != argc)
+	usage();
+    opts->type = argv[i][0];
+
+    unsigned mix_sum = 0;
+    for (unsigned c = 0; c < OP_CLASSES; ++c)
+	mix_sum += opts->mix[c];
+    if (mix_sum != 100)
+	quit("operation mix must sum to 100");
+    if (!opts->nkeys || !opts->nops)
+	quit("key space and operation count must be nonzero");
+    if (opts->preload > 100)
+	quit("preload percentage must not exceed 100");
+    if (opts->zipfian && (opts->theta <= 0.0 || opts->theta >= 1.0))
+	quit("theta must lie in (0,1)");
+}
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int
+lat_cmp(const void *a, const void *b)
+{
+    const uint32_t la = *(const uint32_t *)a, lb = *(const uint32_t *)b;
+    return (la > lb) - (la < lb);
+}
+
+static uint32_t
+percentile(const uint32_t *lat, size_t count, double pct)
+{
+    size_t index = (size_t)((double)count * pct);
+    if (index >= count)
+	index = count - 1;
+    return lat[index];
+}
+
+/* Run one operation of class |c| against a key chosen by |key_index|,
+ * returning whether it hit (found, inserted, or removed something). */
+static bool
+run_op(dict *dct, enum op_class c, char *key, unsigned scan_len)
+{
+    switch (c) {
+	case OP_READ:
+	    return dict_search(dct, key) != NULL;
+
+	case OP_UPDATE: {
+	    void **datum = dict_search(dct, key);
+	    if (!datum)
+		return false;
+	    *datum = key;
+	    return true;
+	}
+
+	case OP_INSERT: {
+	    dict_insert_result result = dict_insert(dct, key);
+	    if (result.datum_ptr)
+		*result.datum_ptr = key;
+	    return result.inserted;
+	}
+
+	case OP_DELETE:
+	    return dict_remove(dct, key).removed;
+
+	case OP_SCAN: {
+	    /* Seek to the key and walk forward. Hash tables have no order to
+	     * scan in, so the seek falls back to an exact search there. */
+	    dict_itor_storage storage;
+	    dict_itor *itor = dict_itor_init(dct, &storage);
+	    bool ok = dict_has_near_search(dct) ?
+		dict_itor_search_ge(itor, key) : dict_itor_search(itor, key);
+	    unsigned scanned = 0;
+	    while (ok && scanned < scan_len) {
+		if (!dict_itor_key(itor))
+		    break;
+		++scanned;
+		ok = dict_itor_next(itor);
+	    }
+	    return scanned > 0;
+	}
+
+	default:
+	    break;
+    }
+    return false;
+}
+
+int
+main(int argc, char **argv)
+{
+    struct options opts;
+    parse_options(argc, argv, &opts);
+
+    rand_state = opts.seed | 1;
+
+    const char *container_name = NULL;
+    dict *dct = create_dictionary(opts.type, &container_name);
+    if (!dct)
+	quit("can't create container");
+
+    /* Synthesize the key space up front so key generation is not timed. */
+    char **keys = xmalloc(opts.nkeys * sizeof(*keys));
+    for (size_t i = 0; i < opts.nkeys; ++i) {
+	char buf[24];
+	const int len = snprintf(buf, sizeof(buf), "key%016zu", i);
+	keys[i] = memcpy(xmalloc((size_t)len + 1), buf, (size_t)len + 1);
+    }
+
+    struct zipf_gen zipf;
+    if (opts.zipfian)
+	zipf_init(&zipf, opts.nkeys, opts.theta);
+
+    const size_t npreload = opts.nkeys * opts.preload / 100;
+    for (size_t i = 0; i < npreload; ++i) {
+	/* Insert in shuffled order so trees do not degenerate. */
+	const size_t j = i + rand_u64() % (opts.nkeys - i);
+	char *tmp = keys[i]; keys[i] = keys[j]; keys[j] = tmp;
+	dict_insert_result result = dict_insert(dct, keys[i]);
+	if (result.datum_ptr)
+	    *result.datum_ptr = keys[i];
+    }
+
+    /* Map a percentage roll onto an operation class. */
+    enum op_class roll_to_class[100];
+    for (unsigned c = 0, roll = 0; c < OP_CLASSES; ++c)
+	for (unsigned j = 0; j < opts.mix[c]; ++j)
+	    roll_to_class[roll++] = (enum op_class)c;
+
+    struct op_stats stats[OP_CLASSES];
+    memset(stats, 0, sizeof(stats));
+    for (unsigned c = 0; c < OP_CLASSES; ++c)
+	if (opts.mix[c])
+	    stats[c].lat = xmalloc(opts.nops * sizeof(uint32_t));
+
+    for (size_t i = 0; i < opts.warmup; ++i) {
+	const enum op_class c = roll_to_class[rand_u64() % 100];
+	const size_t index = opts.zipfian ? zipf_next(&zipf)
+					  : rand_u64() % opts.nkeys;
+	run_op(dct, c, keys[index], opts.scan_len);
+    }
+
+    const uint64_t bench_start = now_ns();
+    for (size_t i = 0; i < opts.nops; ++i) {
+	const enum op_class c = roll_to_class[rand_u64() % 100];
+	const size_t index = opts.zipfian ? zipf_next(&zipf)
+					  : rand_u64() % opts.nkeys;
+	const uint64_t op_start = now_ns();
+	const bool hit = run_op(dct, c, keys[index], opts.scan_len);
+	uint64_t elapsed = now_ns() - op_start;
+	if (elapsed > UINT32_MAX)
+	    elapsed = UINT32_MAX;
+	stats[c].lat[stats[c].count++] = (uint32_t)elapsed;
+	stats[c].total_ns += elapsed;
+	stats[c].hits += hit;
+    }
+    const uint64_t bench_ns = now_ns() - bench_start;
+
+    if (opts.csv) {
+	printf("container,class,ops,hits,mean_ns,p50_ns,p90_ns,p99_ns,"
+	       "p999_ns,max_ns\n");
+    } else {
+	printf("%s: %zu ops in %.3fs (%.0f ops/sec), %zu keys, %s keys%s\n",
+	       container_name, opts.nops, bench_ns * 1e-9,
+	       opts.nops / (bench_ns * 1e-9), opts.nkeys,
+	       opts.zipfian ? "zipfian" : "uniform",
+	       opts.csv ? "" : ":");
+	printf("%8s %9s %9s %8s %8s %8s %8s %8s %8s\n",
+	       "class", "ops", "hits", "mean", "p50", "p90", "p99", "p999",
+	       "max");
+    }
+    for (unsigned c = 0; c < OP_CLASSES; ++c) {
+	if (!stats[c].count)
+	    continue;
+	qsort(stats[c].lat, stats[c].count, sizeof(uint32_t), lat_cmp);
+	const uint32_t p50 = percentile(stats[c].lat, stats[c].count, 0.50);
+	const uint32_t p90 = percentile(stats[c].lat, stats[c].count, 0.90);
+	const uint32_t p99 = percentile(stats[c].lat, stats[c].count, 0.99);
+	const uint32_t p999 = percentile(stats[c].lat, stats[c].count, 0.999);
+	const uint32_t max = stats[c].lat[stats[c].count - 1];
+	const double mean = (double)stats[c].total_ns / stats[c].count;
+	if (opts.csv)
+	    printf("%s,%s,%zu,%zu,%.0f,%u,%u,%u,%u,%u\n",
+		   container_name, op_names[c], stats[c].count, stats[c].hits,
+		   mean, p50, p90, p99, p999, max);
+	else
+	    printf("%8s %9zu %9zu %8.0f %8u %8u %8u %8u %8u\n",
+		   op_names[c], stats[c].count, stats[c].hits, mean,
+		   p50, p90, p99, p999, max);
+    }
+
+    if (!dict_verify(dct))
+	quit("verify failed after workload");
+    dict_free(dct, NULL);
+    for (unsigned c = 0; c < OP_CLASSES; ++c)
+	free(stats[c].lat);
+    for (size_t i = 0; i < opts.nkeys; ++i)
+	free(keys[i]);
+    free(keys);
+
+    exit(EXIT_SUCCESS);
+}
+
+static void
+quit(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", appname);
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+
+    exit(EXIT_FAILURE);
+}
+
+static void *
+xmalloc(size_t size)
+{
+    void *p = malloc(size);
+    if (!p)
+	quit("out of memory");
+    return p;
+}